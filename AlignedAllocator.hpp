@@ -0,0 +1,140 @@
+#ifndef MATRIX_ALIGNEDALLOCATOR_HPP
+#define MATRIX_ALIGNEDALLOCATOR_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include "Matrix.hpp"
+
+/**
+ * @def MATRIX_ALIGNMENT 64
+ * @brief the default alignment of the aligned matrix storage, a cache line and an AVX-512 vector
+ */
+#define MATRIX_ALIGNMENT 64
+
+/**
+ * @brief an allocator of Alignment aligned storage
+ * With PadRows set, a Matrix using the allocator also pads every row to a multiple of Alignment
+ * bytes, so every row starts aligned too and the vector kernels never load across a cache line
+ * at a row start. The padding is only added when sizeof(T) divides Alignment.
+ * @tparam Alignment the storage alignment in bytes, a power of 2 multiple of sizeof(void*)
+ * @tparam PadRows true to pad the rows of the matrices using the allocator
+ */
+template <typename T, std::size_t Alignment = MATRIX_ALIGNMENT, bool PadRows = false>
+class AlignedAllocator
+{
+	static_assert((Alignment & (Alignment - 1)) == 0 && Alignment % sizeof(void*) == 0,
+				  "the alignment should be a power of 2 multiple of sizeof(void*)");
+	static_assert(Alignment >= alignof(T), "the alignment should be at least the alignment of T");
+
+public:
+
+	/**
+	 * @brief the allocated type
+	 */
+	typedef T value_type;
+
+	/**
+	 * @brief every aligned allocator can free the buffers of every other
+	 */
+	typedef std::true_type is_always_equal;
+
+	/**
+	 * @brief the aligned allocator of another type, with the same alignment and padding
+	 */
+	template <typename U>
+	struct rebind
+	{
+		typedef AlignedAllocator<U, Alignment, PadRows> other;
+	};
+
+	/**
+	 * @brief creates an allocator
+	 */
+	AlignedAllocator() noexcept {};
+
+	/**
+	 * @brief creates an allocator of T from an allocator of another type
+	 */
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment, PadRows>&) noexcept {};
+
+	/**
+	 * @brief allocates Alignment aligned storage for n elements
+	 * @param n the number of elements
+	 * @return the storage
+	 * @throw std::bad_alloc if the storage can't be allocated
+	 */
+	T* allocate(std::size_t n)
+	{
+		void* block = nullptr;
+		if (n > (std::size_t) -1 / sizeof(T) || posix_memalign(&block, Alignment, n * sizeof(T)) != 0)
+		{
+			throw std::bad_alloc();
+		}
+		return static_cast<T*>(block);
+	}
+
+	/**
+	 * @brief frees the storage of n elements
+	 * @param block the storage
+	 */
+	void deallocate(T* block, std::size_t) noexcept
+	{
+		std::free(block);
+	}
+};
+
+/**
+ * @brief aligned allocators with the same parameters are interchangeable
+ * @return true
+ */
+template <typename T, typename U, std::size_t Alignment, bool PadRows>
+bool operator==(const AlignedAllocator<T, Alignment, PadRows>&, const AlignedAllocator<U, Alignment, PadRows>&)
+{
+	return true;
+}
+
+/**
+ * @brief aligned allocators with the same parameters are interchangeable
+ * @return false
+ */
+template <typename T, typename U, std::size_t Alignment, bool PadRows>
+bool operator!=(const AlignedAllocator<T, Alignment, PadRows>&, const AlignedAllocator<U, Alignment, PadRows>&)
+{
+	return false;
+}
+
+/**
+ * @brief the rows of matrices using a padding aligned allocator are padded to a multiple of
+ * Alignment bytes
+ */
+template <typename T, std::size_t Alignment>
+struct MatrixLayout<AlignedAllocator<T, Alignment, true>>
+{
+	/**
+	 * @brief returns the number of elements between the starts of two consecutive rows
+	 * @param cols the number of columns
+	 * @return cols rounded up to a multiple of Alignment / sizeof(T) elements
+	 */
+	static unsigned int stride(unsigned int cols)
+	{
+		const unsigned int lane = Alignment % sizeof(T) == 0 ? (unsigned int) (Alignment / sizeof(T)) : 1;
+		return cols % lane == 0 ? cols : cols + (lane - cols % lane);
+	}
+};
+
+/**
+ * @brief a matrix whose storage starts on a cache line
+ */
+template <typename T>
+using AlignedMatrix = Matrix<T, AlignedAllocator<T>>;
+
+/**
+ * @brief a matrix whose rows all start on a cache line
+ */
+template <typename T>
+using PaddedMatrix = Matrix<T, AlignedAllocator<T, MATRIX_ALIGNMENT, true>>;
+
+#endif //MATRIX_ALIGNEDALLOCATOR_HPP
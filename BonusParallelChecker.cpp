@@ -9,15 +9,19 @@
 #include <stack>
 #include <ctime>
 #include <chrono>
+#include <cmath>
+#include <algorithm>
 #include "Complex.h"
 #include "Matrix.hpp"
+#include "MatrixFile.hpp"
+#include "MatrixParser.hpp"
 
 //std::stack<clock_t> tictoc_stack;
-std::stack<std::chrono::time_point<std::chrono::system_clock>> tictoc_stack;
+std::stack<std::chrono::steady_clock::time_point> tictoc_stack;
 
 void tic() {
 	//tictoc_stack.push(clock());
-	tictoc_stack.push(std::chrono::system_clock::now());
+	tictoc_stack.push(std::chrono::steady_clock::now());
 }
 
 void toc() {
@@ -25,44 +29,22 @@ void toc() {
 	// 		<< ((double)(clock() - tictoc_stack.top())) / CLOCKS_PER_SEC
 	// 		<< std::endl;
 	// tictoc_stack.pop();
-	std::chrono::duration<double> elapsed_seconds = std::chrono::system_clock::now() - tictoc_stack.top();
+	std::chrono::duration<double> elapsed_seconds = std::chrono::steady_clock::now() - tictoc_stack.top();
 	std::cout << "Time elapsed: " << elapsed_seconds.count() << "sec\n";
 	tictoc_stack.pop();
 }
 
 Matrix<Complex> readComplexMatrix(const std::string &FileName)
 {
-	std::ifstream instream(FileName.c_str());
-	if (!instream.is_open())
+	try
 	{
-		std::cerr<<"Error! Can't open file: "<<FileName<<"."<<std::endl;
+		return readMatrixText<Complex>(FileName);
 	}
-
-	int rowsNum, colsNum;
-	
-	instream >> rowsNum >> colsNum;
-	//std::cout << rowsNum << "," << colsNum << std::endl;
-	//colsNum = 10; // THIS SETS THE NUMBER OF THREADS
-	//rowsNum = 1000000;
-
-	std::vector<Complex> cells(rowsNum*colsNum);
-	unsigned int i=0;
-	double real, img;
-	while(instream.good())
+	catch (const std::exception& e)
 	{
-		instream >> real >> img;
-		if (!instream.eof()) {
-			//        	std::cout << real << "," << img << std::endl;
-			if (i >= cells.size()) {
-				break;
-			}
-			cells[i]=(Complex(real,img));
-			i++;
-		}
+		std::cerr<<"Error! Can't read file: "<<FileName<<". "<<e.what()<<std::endl;
+		exit(-1);
 	}
-	instream.close();
-
-	return Matrix<Complex>(rowsNum, colsNum, cells);
 }
 
 Matrix<Complex> doPlus(const Matrix<Complex>& A, const Matrix<Complex>& B) {
@@ -73,21 +55,52 @@ Matrix<Complex> doMult(const Matrix<Complex>& A, const Matrix<Complex>& B) {
 	return (A * B);
 }
 
+Complex sumChecked(const Matrix<Complex>& A) {
+	Complex sum;
+	for (unsigned int i = 0; i < A.rows(); ++i) {
+		for (unsigned int j = 0; j < A.cols(); ++j) {
+			sum += A(i, j);
+		}
+	}
+	return sum;
+}
+
+Complex sumUnchecked(const Matrix<Complex>& A) {
+	Complex sum;
+	for (unsigned int i = 0; i < A.rows(); ++i) {
+		for (unsigned int j = 0; j < A.cols(); ++j) {
+			sum += A.unchecked(i, j);
+		}
+	}
+	return sum;
+}
+
+double maxAbsDiff(const Matrix<Complex>& A, const Matrix<Complex>& B) {
+	double maxDiff = 0;
+	Matrix<Complex>::const_iterator a = A.begin(), b = B.begin();
+	for (; a != A.end(); ++a, ++b) {
+		maxDiff = std::max(maxDiff, std::fabs(a->getReal() - b->getReal()));
+		maxDiff = std::max(maxDiff, std::fabs(a->getImaginary() - b->getImaginary()));
+	}
+	return maxDiff;
+}
+
 int main(int argc, char *argv[])
 {
 	//
 	if (argc != 2)
 	{
 		std::cerr<<"Usage: ParalelChecker <matrix_file>"<<std::endl;
+		std::cerr<<"matrix_file is a text matrix or a binary matrix file (see MatrixFileConverter)"<<std::endl;
 		exit(-1);
 	}
 	Matrix<Complex>::setParallel(false);
 
 	std::string matrix(argv[1]);
 
-	Matrix<Complex> A = readComplexMatrix(matrix);
+	Matrix<Complex> A = isMatrixFile(matrix) ? readMatrixFile<Complex>(matrix) : readComplexMatrix(matrix);
 	Matrix<Complex> B = A.trans();
-	Matrix<Complex> Ra,Rm,Pa,Pm;
+	Matrix<Complex> Ra,Rm,Pa,Pm,Sm,Gm,Vm;
 
 	// REG
 
@@ -112,8 +125,57 @@ int main(int argc, char *argv[])
 	toc();
 	
 
+	//strassen
+	std::cout << "strassen timing" << std::endl << std::flush;
+	Matrix<Complex>::setStrassen(true);
+
+	tic();
+	Sm = doMult(B,A);
+	toc();
+
+	Matrix<Complex>::setStrassen(false);
+
+	//gauss
+	std::cout << "gauss timing" << std::endl << std::flush;
+	Matrix<Complex>::setGaussMultiply(true);
+
+	tic();
+	Gm = doMult(B,A);
+	toc();
+
+	Matrix<Complex>::setGaussMultiply(false);
+
+	//transposed view, B is never formed
+	std::cout << "transposed view timing" << std::endl << std::flush;
+
+	tic();
+	Vm = A.transView() * A;
+	toc();
+
+	//element access, operator() checks its indexes unless MATRIX_CHECKED_ACCESS is 0
+	std::cout << "operator() access timing (checked=" << MATRIX_CHECKED_ACCESS << ")" << std::endl << std::flush;
+	Complex checkedSum, uncheckedSum;
+
+	tic();
+	for (int k = 0; k < 10; ++k) {
+		checkedSum += sumChecked(A);
+	}
+	toc();
+
+	std::cout << "unchecked access timing" << std::endl << std::flush;
+
+	tic();
+	for (int k = 0; k < 10; ++k) {
+		uncheckedSum += sumUnchecked(A);
+	}
+	toc();
+
 	std::cout << "plus (parl==reg) = " << std::boolalpha << (Pa==Ra) << std::endl;
 	std::cout << "mult (parl==reg) = " << std::boolalpha << (Pm==Rm) << std::endl;
+	std::cout << "mult (view==reg) = " << std::boolalpha << (Vm==Rm) << std::endl;
+	std::cout << "access (checked==unchecked) = " << std::boolalpha << (checkedSum == uncheckedSum) << std::endl;
+	std::cout << "mult (strassen-reg) max abs diff = " << maxAbsDiff(Sm, Rm) << std::endl;
+	std::cout << "mult (gauss-reg) max abs diff = " << maxAbsDiff(Gm, Rm) << std::endl;
 	//    std::cout << "plus:\n" << Ra << std::endl;
 	//    std::cout << "mult:\n" << Rm << std::endl;
 
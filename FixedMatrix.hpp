@@ -0,0 +1,370 @@
+#ifndef MATRIX_FIXEDMATRIX_HPP
+#define MATRIX_FIXEDMATRIX_HPP
+
+#include <cstddef>
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+#include "Matrix.hpp"
+
+/**
+ * @def FIXED_SIZE_EXCEPTION_MSG "the given matrix dimensions don't fit the fixed matrix size."
+ * @brief the message to add to a fixed size conversion exception
+ */
+#define FIXED_SIZE_EXCEPTION_MSG "the given matrix dimensions don't fit the fixed matrix size."
+
+/**
+ * @brief calls func(First), func(First + 1), ..., func(First + N - 1), unrolled at compile time
+ * The range is split in halves, so the instantiation depth grows with log2(N) and not with N.
+ */
+template <std::size_t N, std::size_t First = 0>
+struct _Unroll
+{
+	/**
+	 * @brief calls func on the indexes [First, First + N)
+	 * @param func the function to call
+	 */
+	template <typename Func>
+	static void apply(const Func& func)
+	{
+		_Unroll<N / 2, First>::apply(func);
+		_Unroll<N - N / 2, First + N / 2>::apply(func);
+	}
+};
+
+/**
+ * @brief a single index
+ */
+template <std::size_t First>
+struct _Unroll<1, First>
+{
+	/**
+	 * @brief calls func on First
+	 * @param func the function to call
+	 */
+	template <typename Func>
+	static void apply(const Func& func)
+	{
+		func(First);
+	}
+};
+
+/**
+ * @brief an empty range
+ */
+template <std::size_t First>
+struct _Unroll<0, First>
+{
+	/**
+	 * @brief calls nothing
+	 */
+	template <typename Func>
+	static void apply(const Func&)
+	{
+	}
+};
+
+/**
+ * @brief a matrix of R x C elements whose size is fixed at compile time
+ * The elements are stored inline, row major, so a fixed matrix doesn't allocate and the
+ * operations on it are unrolled loops over constant bounds. Sizes are checked by the compiler:
+ * adding or multiplying matrices of mismatching sizes doesn't compile. A fixed matrix converts
+ * to and from a Matrix<T> of the same size.
+ */
+template <typename T, unsigned int R, unsigned int C>
+class FixedMatrix
+{
+	/**
+	 * @brief the elements, row major
+	 */
+	std::array<T, (std::size_t) R * C> cells;
+
+public:
+
+	/**
+	 * @brief the element type of the matrix
+	 */
+	typedef T value_type;
+
+	/**
+	 * @brief iterator type definition, the elements are walked in row major order
+	 */
+	typedef const T* const_iterator;
+
+	/**
+	 * @brief creates a matrix of zeroes
+	 */
+	FixedMatrix()
+	{
+		cells.fill(T());
+	}
+
+	/**
+	 * @brief creates a matrix from its elements in row major order
+	 * @param elements R * C elements
+	 * @throw std::invalid_argument if the number of elements isn't R * C
+	 */
+	explicit FixedMatrix(const std::vector<T>& elements)
+	{
+		if (elements.size() != cells.size())
+		{
+			throw std::invalid_argument(CELLS_CTOR_EXCEPTION_MSG);
+		}
+		std::copy(elements.begin(), elements.end(), cells.begin());
+	}
+
+	/**
+	 * @brief copies the elements of a dense matrix of the same size
+	 * @param dense the matrix to copy
+	 * @throw std::invalid_argument if the matrix isn't R x C
+	 */
+	template <typename Alloc>
+	explicit FixedMatrix(const Matrix<T, Alloc>& dense)
+	{
+		if (dense.rows() != R || dense.cols() != C)
+		{
+			throw std::invalid_argument(FIXED_SIZE_EXCEPTION_MSG);
+		}
+		unsigned int i;
+		for (i = 0; i < R; ++i)
+		{
+			std::copy(&dense.unchecked(i, 0), &dense.unchecked(i, 0) + C, &cells[(std::size_t) i * C]);
+		}
+	}
+
+	/**
+	 * @brief returns the dense matrix with the same elements
+	 * @return R x C matrix
+	 */
+	Matrix<T> toMatrix() const
+	{
+		return Matrix<T>(R, C, std::vector<T>(cells.begin(), cells.end()));
+	}
+
+	/**
+	 * @brief returns the number of rows in the matrix
+	 * @return R
+	 */
+	static constexpr unsigned int rows()
+	{
+		return R;
+	}
+
+	/**
+	 * @brief returns the number of columns in the matrix
+	 * @return C
+	 */
+	static constexpr unsigned int cols()
+	{
+		return C;
+	}
+
+	/**
+	 * @brief returns true if the matrix is square
+	 * @return R == C
+	 */
+	static constexpr bool isSquareMatrix()
+	{
+		return R == C;
+	}
+
+	/**
+	 * @brief returns a constant of the element in the given matrix position
+	 * @param row the row number
+	 * @param col the column number
+	 * @return the element in the given row and column number
+	 * @throw std::out_of_range if the position is outside the matrix and MATRIX_CHECKED_ACCESS is 1
+	 */
+	const T& operator()(unsigned int row, unsigned int col) const
+	{
+		_checkRange(row, col);
+		return cells[(std::size_t) row * C + col];
+	}
+
+	/**
+	 * @brief returns the element in the given matrix position
+	 * @param row the row number
+	 * @param col the column number
+	 * @return the element in the given row and column number
+	 * @throw std::out_of_range if the position is outside the matrix and MATRIX_CHECKED_ACCESS is 1
+	 */
+	T& operator()(unsigned int row, unsigned int col)
+	{
+		_checkRange(row, col);
+		return cells[(std::size_t) row * C + col];
+	}
+
+	/**
+	 * @brief returns a constant of the element in the given matrix position without checking it
+	 * @param row the row number, less than R
+	 * @param col the column number, less than C
+	 * @return the element in the given row and column number
+	 */
+	const T& unchecked(unsigned int row, unsigned int col) const
+	{
+		return cells[(std::size_t) row * C + col];
+	}
+
+	/**
+	 * @brief returns the element in the given matrix position without checking it
+	 * @param row the row number, less than R
+	 * @param col the column number, less than C
+	 * @return the element in the given row and column number
+	 */
+	T& unchecked(unsigned int row, unsigned int col)
+	{
+		return cells[(std::size_t) row * C + col];
+	}
+
+	/**
+	 * @brief Returns the iterator to the first element of the matrix
+	 * @return iterator to the first element of the matrix
+	 */
+	const_iterator begin() const
+	{
+		return cells.data();
+	}
+
+	/**
+	 * @brief Returns the iterator to the element following the last element of the matrix
+	 * @return iterator to the element following the last element of the matrix
+	 */
+	const_iterator end() const
+	{
+		return cells.data() + cells.size();
+	}
+
+	/**
+	 * @brief addition operator
+	 * @param rhs matrix of the same size to add
+	 * @return the sum
+	 */
+	FixedMatrix<T, R, C> operator+(const FixedMatrix<T, R, C>& rhs) const
+	{
+		FixedMatrix<T, R, C> result(*this);
+		_Unroll<(std::size_t) R * C>::apply([&](std::size_t i)
+		{
+			result.cells[i] = cells[i] + rhs.cells[i];
+		});
+		return result;
+	}
+
+	/**
+	 * @brief subtraction operator
+	 * @param rhs matrix of the same size to subtract
+	 * @return the difference
+	 */
+	FixedMatrix<T, R, C> operator-(const FixedMatrix<T, R, C>& rhs) const
+	{
+		FixedMatrix<T, R, C> result(*this);
+		_Unroll<(std::size_t) R * C>::apply([&](std::size_t i)
+		{
+			result.cells[i] = cells[i] - rhs.cells[i];
+		});
+		return result;
+	}
+
+	/**
+	 * @brief multiplication operator, the product elements sum their products in increasing
+	 * order like Matrix<T>
+	 * @param rhs matrix of C rows to multiply with
+	 * @return R x K product
+	 */
+	template <unsigned int K>
+	FixedMatrix<T, R, K> operator*(const FixedMatrix<T, C, K>& rhs) const
+	{
+		FixedMatrix<T, R, K> result;
+		_Unroll<R>::apply([&](std::size_t i)
+		{
+			_Unroll<K>::apply([&](std::size_t j)
+			{
+				T sum = 0;
+				_Unroll<C>::apply([&](std::size_t k)
+				{
+					sum = sum + (cells[i * C + k] * rhs.unchecked(k, j));
+				});
+				result.unchecked(i, j) = sum;
+			});
+		});
+		return result;
+	}
+
+	/**
+	 * @brief returns the transpose of this matrix, conjugated over the complex field like
+	 * Matrix<T>::trans()
+	 * @return C x R transpose matrix
+	 */
+	FixedMatrix<T, C, R> trans() const
+	{
+		FixedMatrix<T, C, R> result;
+		_Unroll<R>::apply([&](std::size_t i)
+		{
+			_Unroll<C>::apply([&](std::size_t j)
+			{
+				result.unchecked(j, i) = _transElement(cells[i * C + j]);
+			});
+		});
+		return result;
+	}
+
+	/**
+	 * @brief equals operator
+	 * @param rhs matrix of the same size to test this against
+	 * @return true if every element of rhs equals the element of this at the same position
+	 */
+	bool operator==(const FixedMatrix<T, R, C>& rhs) const
+	{
+		return std::equal(cells.begin(), cells.end(), rhs.cells.begin());
+	}
+
+	/**
+	 * @brief not-equals operator
+	 * @param rhs matrix of the same size to test this against
+	 * @return true if rhs doesn't equal this, otherwise false
+	 */
+	bool operator!=(const FixedMatrix<T, R, C>& rhs) const
+	{
+		return !(*this == rhs);
+	}
+
+private:
+
+	/**
+	 * @brief throws if the given position is outside the matrix, when MATRIX_CHECKED_ACCESS is 1
+	 * @param row number of row
+	 * @param col number of column
+	 * @throw std::out_of_range if the position is outside the matrix
+	 */
+	static void _checkRange(unsigned int row, unsigned int col)
+	{
+		if (MATRIX_CHECKED_ACCESS && (row >= R || col >= C))
+		{
+			throw std::out_of_range(OUT_OF_RANGE_MSG);
+		}
+	}
+};
+
+/**
+ * @brief output operator, formats the matrix like a Matrix<T>
+ * @param os output stream
+ * @param matrix the matrix to output
+ * @return output stream
+ */
+template <typename T, unsigned int R, unsigned int C>
+std::ostream& operator<<(std::ostream& os, const FixedMatrix<T, R, C>& matrix)
+{
+	unsigned int i, j;
+	for (i = 0; i < R; ++i)
+	{
+		for (j = 0; j < C; ++j)
+		{
+			os << matrix.unchecked(i, j) << TAB_CHAR;
+		}
+		os << NEWLINE_CHAR;
+	}
+	return os;
+}
+
+#endif //MATRIX_FIXEDMATRIX_HPP
@@ -7,12 +7,11 @@
 #include <vector>
 #include <string>
 #include <cstdlib>
-#include <sstream>
-#include <iostream>
-#include <sstream>
+#include <algorithm>
 
 
 #include "Matrix.hpp"
+#include "MatrixParser.hpp"
 #include "Complex.h"
 
 #define LINE "=========="
@@ -49,10 +48,7 @@ template <typename T>
 void readMatrixInfo(int& rows, int& cols, std::vector<T>& cells);
 
 template <typename T>
-void getNumFromString(const std::string &str, T *num);
-
-template <>
-void getNumFromString(const std::string &str, int *num);
+void getNumFromString(const char *begin, const char *end, T *num);
 
 template <typename T>
 const T readScalarLine();
@@ -245,11 +241,11 @@ void readMatrixInfo(int& rows, int& cols, std::vector<T>& cells)
 {
 	std::cout << "number of rows:";
 	getline(std::cin, g_line);
-	rows = atoi(g_line.c_str());
+	getNumFromString(g_line.data(), g_line.data() + g_line.size(), &rows);
 
 	std::cout << "number of columns:";
 	getline(std::cin, g_line);
-	cols = atoi(g_line.c_str());
+	getNumFromString(g_line.data(), g_line.data() + g_line.size(), &cols);
 
 	std::cout << "Now insert the values of the matrix, row by row." << std::endl << 
 		"After each cell add the char \'" << DELIM << "\'" << 
@@ -257,60 +253,68 @@ void readMatrixInfo(int& rows, int& cols, std::vector<T>& cells)
 		"Each row should be in a separate line." << std::endl;
 
 	int row, col;
+	cells.reserve((std::size_t) rows * cols);
 	for (row = 0; row < rows; row++)
 	{
 		getline(std::cin, g_line);
 
-		std::stringstream stream(g_line);
-		std::string numStr;
+		// every cell is parsed in place, up to the next DELIM
+		const char *cell = g_line.data();
+		const char *lineEnd = cell + g_line.size();
 		T val;
 		for (col = 0; col < cols; col++)
 		{
-			getline(stream, numStr, DELIM);
-			getNumFromString(numStr, &val);
+			const char *cellEnd = std::find(cell, lineEnd, DELIM);
+			getNumFromString(cell, cellEnd, &val);
 			cells.push_back(val);
+			cell = (cellEnd == lineEnd) ? lineEnd : cellEnd + 1;
 		}
 	}
 
 }
 
 template <typename T>
-void getNumFromString(const std::string &str, T *num)
+void getNumFromString(const char *begin, const char *end, T *num)
 {
-	 //istringstream iss(s);
-	T number(str);
+	T number(std::string(begin, end));
 
 	*num = number;
 }
 
-
-
-
-void getNumFromString(const std::string &str, Complex *num)
+/**
+ * int, double and Complex cells are parsed locale-free without copying the cell, like atoi and
+ * atof: leading spaces are skipped, the number ends at the first character that doesn't
+ * belong to it, and a cell without a number is zero
+ */
+template <typename T>
+void getParsedNumber(const char *begin, const char *end, T *num)
 {
-	 std::istringstream iss(str);
-	 double r,i=0;
-	 iss>>r;
-	 if (!(iss>>i)){
-	 	i=0;
-	 };
-	Complex number(r,i);
-	*num = number;
+	while (begin != end && (*begin == ' ' || *begin == '\t'))
+	{
+		begin++;
+	}
+	if (!parseNumber(begin, end, *num))
+	{
+		*num = T(0);
+	}
 }
 
 template <>
-void getNumFromString(const std::string &str, int *num)
+void getNumFromString(const char *begin, const char *end, int *num)
 {
-	int number = atoi(str.c_str());
-
-	*num = number;
+	getParsedNumber(begin, end, num);
 }
+
 template <>
-void getNumFromString(const std::string &str, double *num)
+void getNumFromString(const char *begin, const char *end, double *num)
 {
-	double number = atof(str.c_str());
+	getParsedNumber(begin, end, num);
+}
 
-	*num = number;
+template <>
+void getNumFromString(const char *begin, const char *end, Complex *num)
+{
+	getParsedNumber(begin, end, num);
 }
 
 template <typename T>
@@ -318,7 +322,7 @@ const T readScalarLine()
 {
 	getline(std::cin, g_line);
 	T number;
-	getNumFromString(g_line, &number);
+	getNumFromString(g_line.data(), g_line.data() + g_line.size(), &number);
 
 	return number;
 }
@@ -4,7 +4,18 @@
 #include <iostream>
 #include <vector>
 #include <stdexcept>	// std::out_of_range
+#include <algorithm>	// std::min
+#include <utility>	// std::move
+#include <memory>
+#include <type_traits>
+#include <string>
+#include <locale>
 #include "Complex.h"
+#include "ThreadPool.hpp"
+#include "MatrixInstrument.hpp"
+#include "MatrixSimd.hpp"
+#include "MatrixExpression.hpp"
+#include "MatrixFormat.hpp"
 
 /**
  * @def DEFAULT_CTOR_ROWS 1
@@ -26,11 +37,6 @@
  * @brief the message to input to the out of range exception
  */
 #define OUT_OF_RANGE_MSG "Requested element (col, row) are out of the matrix range."
-/**
- * @def ROWS_COLS_CTOR_EXCEPTION_MSG "the given matrix dimensions are invalid."
- * @brief the message to add to a invalid row and column arguments exception
- */
-#define ROWS_COLS_CTOR_EXCEPTION_MSG "the given matrix dimensions are invalid."
 /**
  * @def CELLS_CTOR_EXCEPTION_MSG "the given matrix dimensions don't fit the given vector size."
  * @brief the message to add to a matrix vector constructor exception
@@ -47,20 +53,28 @@
  */
 #define SUBTRACTION_EXCEPTION_MSG "cannot subtract matrices of different sizes."
 /**
- * @def TRANSPOSE_EXCEPTION_MSG "cannot transpose non square matrix."
- * @brief the message to add to a transpose exception
+ * @def TRANSPOSE_EXCEPTION_MSG "cannot transpose non square matrix in place."
+ * @brief the message to add to an in place transpose exception
  */
-#define TRANSPOSE_EXCEPTION_MSG "cannot transpose non square matrix."
+#define TRANSPOSE_EXCEPTION_MSG "cannot transpose non square matrix in place."
 /**
  * @def MULTIPLICATION_EXCEPTION_MSG "cannot multiply with the given matrix row dimension."
  * @brief the message to add to a multiplication exception
  */
 #define MULTIPLICATION_EXCEPTION_MSG "cannot multiply with the given matrix row dimension."
 /**
- * @def MIN_MATRIX_INDEX 0
- * @brief the minimum matrix row and column index
+ * @def MATRIX_CHECKED_ACCESS
+ * @brief 1 if operator() throws std::out_of_range on an index outside the matrix, 0 if it doesn't
+ * check its indexes. Defaults to 1, and to 0 in NDEBUG (release) builds; define it to 0 or 1 before
+ * including Matrix.hpp to choose. unchecked() and the matrix operations never check.
  */
-#define MIN_MATRIX_INDEX 0
+#ifndef MATRIX_CHECKED_ACCESS
+#ifdef NDEBUG
+#define MATRIX_CHECKED_ACCESS 0
+#else
+#define MATRIX_CHECKED_ACCESS 1
+#endif
+#endif
 /**
  * @def TAB_CHAR '\t'
  * @brief Tab character
@@ -71,19 +85,178 @@
  * @brief new line character
  */
 #define NEWLINE_CHAR '\n';
+/**
+ * @def PARALLEL_MIN_ELEMENTS 4096
+ * @brief operations on matrices smaller than this run serially even in parallel mode
+ */
+#define PARALLEL_MIN_ELEMENTS 4096
+/**
+ * @def BLOCKED_MULT_MIN_OPS 32768
+ * @brief multiplications with at least this many element products use the blocked kernel
+ */
+#define BLOCKED_MULT_MIN_OPS 32768
+/**
+ * @def MULT_BLOCK_K 128
+ * @brief the length of the packed rhs panel rows, the number of products summed per block
+ */
+#define MULT_BLOCK_K 128
+/**
+ * @def MULT_BLOCK_J 32
+ * @brief the number of rhs columns in a packed panel
+ */
+#define MULT_BLOCK_J 32
+/**
+ * @def MULT_BLOCK_I 64
+ * @brief the number of result rows computed against a packed panel before moving to the next one
+ */
+#define MULT_BLOCK_I 64
+/**
+ * @def STRASSEN_DEFAULT_CUTOFF 128
+ * @brief the default size at or below which Strassen-Winograd recursion stops
+ */
+#define STRASSEN_DEFAULT_CUTOFF 128
+/**
+ * @def TRANS_BLOCK 32
+ * @brief transpose recursion stops at tiles of at most this many rows and columns
+ */
+#define TRANS_BLOCK 32
+/**
+ * @def VIEW_MULT_BLOCK 16
+ * @brief the number of result rows computed together by the transposed view products
+ */
+#define VIEW_MULT_BLOCK 16
+/**
+ * @def EVALUATE_CHUNK 512
+ * @brief a new matrix is evaluated serially in chunks of this many elements, computed in a buffer
+ * and appended to its storage, so the storage isn't zero filled before it's written
+ */
+#define EVALUATE_CHUNK 512
+
+/**
+ * @brief returns the process wide execution mode of the matrix operations, shared by the
+ * matrices of every element type
+ * @return true if the matrix operations run in parallel, serial by default
+ */
+inline bool& parallelMode()
+{
+	static bool parallel = false;
+	return parallel;
+}
+
+/**
+ * @brief the multiplication algorithms of the matrices of element type T, shared by the matrices
+ * of every allocator
+ */
+template <typename T>
+struct MatrixSettings
+{
+	/**
+	 * @brief true if large square matrices should be multiplied with Strassen-Winograd
+	 */
+	static bool strassen;
 
-template <class T>
-class Matrix
+	/**
+	 * @brief the size at or below which Strassen-Winograd recursion stops
+	 */
+	static unsigned int strassenCutoff;
+
+	/**
+	 * @brief true if complex matrices should be multiplied with the 3 real products method
+	 */
+	static bool gaussMultiply;
+};
+
+/**
+ * @brief the multiplication algorithm of square matrices, classic by default
+ */
+template <typename T>
+bool MatrixSettings<T>::strassen = false;
+
+/**
+ * @brief the Strassen-Winograd recursion cutoff size
+ */
+template <typename T>
+unsigned int MatrixSettings<T>::strassenCutoff = STRASSEN_DEFAULT_CUTOFF;
+
+/**
+ * @brief the multiplication algorithm of complex matrices, classic by default
+ */
+template <typename T>
+bool MatrixSettings<T>::gaussMultiply = false;
+
+/**
+ * @brief the row layout of the matrices whose storage comes from Alloc, by default the rows are
+ * stored back to back. An allocator may pad every row to a stride (leading dimension) longer
+ * than the row, e.g. to start every row on a cache line.
+ */
+template <typename Alloc>
+struct MatrixLayout
+{
+	/**
+	 * @brief returns the number of elements between the starts of two consecutive rows
+	 * @param cols the number of columns
+	 * @return the row stride, at least cols
+	 */
+	static unsigned int stride(unsigned int cols)
+	{
+		return cols;
+	}
+};
+
+/**
+ * @brief a matrix of T elements, stored row major in a std::vector<T, Alloc>
+ * the storage comes from std::allocator<T> by default, the allocator of every matrix a
+ * matrix operation returns is the allocator of its operands. The rows are MatrixLayout<Alloc>
+ * stride() elements apart, the padding elements after a row are zero and aren't part of the
+ * matrix: element access, iteration and every operation skip them.
+ */
+template <class T, class Alloc>
+class Matrix : public MatrixExpression<Matrix<T, Alloc>>
 {
 	/**
 	 * @brief bidirectional iterator class declaration
 	 */
 	class BidiConstIterator;
 
+	/**
+	 * @brief matrices of other allocators are evaluated into the matrix directly
+	 */
+	template <typename U, typename A>
+	friend class Matrix;
+
+	/**
+	 * @brief expression nodes read the matrix elements directly
+	 */
+	template <typename Op, typename L, typename R>
+	friend class MatrixBinaryExpression;
+
+	/**
+	 * @brief transposed views read the matrix elements directly
+	 */
+	template <typename U, typename A>
+	friend class MatrixTransView;
+
+	/**
+	 * @brief sparse matrices convert from and multiply the matrix elements directly
+	 */
+	template <typename U>
+	friend class SparseMatrix;
+
+	/**
+	 * @brief split complex matrices keep their planes as real matrices and write them directly
+	 */
+	friend class SplitComplexMatrix;
+
+	/**
+	 * @brief panel multipliers pack their right matrix once for the blocked kernel
+	 */
+	template <typename U>
+	friend class PanelMultiplier;
+
 	/**
 	 * @brief vector of type T, represents a matrix.
 	 */
-	std::vector<T> matrix;
+	std::vector<T, Alloc> matrix;
 
 	/**
 	 * @brief the number of columns in the matrix;
@@ -95,6 +268,11 @@ class Matrix
 	 */
 	unsigned int nRows;
 
+	/**
+	 * @brief the number of elements between the starts of two consecutive rows, at least nCols
+	 */
+	unsigned int nStride;
+
 public:
 
 	/**
@@ -102,6 +280,11 @@ public:
 	 */
 	typedef BidiConstIterator const_iterator;
 
+	/**
+	 * @brief the element type
+	 */
+	typedef T value_type;
+
 	/**
 	 * @brief default constructor
 	 * initializes a matrix of size 1x1 with a single element 0
@@ -119,13 +302,25 @@ public:
 	 * @brief Matrix copy constructor
 	 * @param other the matrix to copy
 	 */
-	Matrix(const Matrix<T>& other) : matrix(other.matrix), nCols(other.nCols), nRows(other.nRows) {};
+	Matrix(const Matrix<T, Alloc>& other) : matrix(other.matrix), nCols(other.nCols), nRows(other.nRows),
+											nStride(other.nStride)
+	{
+		MATRIX_INSTRUMENT_SCOPE(CONSTRUCT, nRows, 0, nCols);
+		MATRIX_INSTRUMENT_ALLOC(matrix.size() * sizeof(T));
+	};
 
 	/**
 	 * @brief Matrix move constructor
-	 * @param other the matrix to copy
+	 * takes over the elements of other, which is left as an empty 0x0 matrix
+	 * @param other the matrix to move
 	 */
-	Matrix(const Matrix<T> && other) : matrix(other.matrix), nCols(other.nCols), nRows(other.nRows) {};
+	Matrix(Matrix<T, Alloc>&& other) noexcept : matrix(std::move(other.matrix)), nCols(other.nCols), nRows(other.nRows),
+												nStride(other.nStride)
+	{
+		other.nCols = 0;
+		other.nRows = 0;
+		other.nStride = 0;
+	};
 
 	/**
 	 * @brief Constructs a matrix from a given vector and row and column numbers
@@ -135,6 +330,22 @@ public:
 	 */
 	Matrix(unsigned int rows, unsigned int cols, const std::vector<T>& cells);
 
+	/**
+	 * @brief Constructs a matrix that adopts the given vector as its elements, without copying them
+	 * when the rows aren't padded
+	 * @param rows number of rows
+	 * @param cols number of columns
+	 * @param cells the elements of the matrix, left empty
+	 */
+	Matrix(unsigned int rows, unsigned int cols, std::vector<T, Alloc>&& cells);
+
+	/**
+	 * @brief Constructs a matrix by evaluating the given expression in a single pass
+	 * @param expr the expression to evaluate
+	 */
+	template <typename E>
+	Matrix(const MatrixExpression<E>& expr);
+
 	/**
 	 * @brief Matrix destructor
 	 */
@@ -145,48 +356,92 @@ public:
 	 * @param rhs matrix whose values to assign
 	 * @return *this
 	 */
-	Matrix<T>& operator=(const Matrix<T>& rhs);
+	Matrix<T, Alloc>& operator=(const Matrix<T, Alloc>& rhs);
 
 	/**
-	 * @brief Binary addition operator
-	 * @param rhs the matrix to add to this
-	 * @return A matrix that equals (this + rhs)
+	 * @brief Moves the content of the given matrix into this matrix
+	 * rhs is left as an empty 0x0 matrix
+	 * @param rhs matrix whose values to move
+	 * @return *this
 	 */
-	Matrix<T> operator+(const Matrix<T>& rhs) const;
+	Matrix<T, Alloc>& operator=(Matrix<T, Alloc>&& rhs) noexcept;
 
 	/**
-	 * @brief Binary subtraction operator
-	 * @param rhs the matrix to subtract from this
-	 * @return A matrix that equals (this - rhs)
+	 * @brief Assigns the value of the given expression, evaluated in a single pass
+	 * the existing storage is reused when the sizes match
+	 * @param expr the expression to evaluate
+	 * @return *this
 	 */
-	Matrix<T> operator-(const Matrix<T>& rhs) const;
+	template <typename E>
+	Matrix<T, Alloc>& operator=(const MatrixExpression<E>& expr);
 
 	/**
 	 * @brief Matrix multiplication operator
 	 * @param rhs the matrix to multiply with this
 	 * @return A matrix that equals (this * rhs)
 	 */
-	Matrix<T> operator*(const Matrix<T>& rhs) const;
+	Matrix<T, Alloc> operator*(const Matrix<T, Alloc>& rhs) const;
+
+	/**
+	 * @brief Addition assignment operator, adds rhs to this in place
+	 * @param rhs the matrix or expression to add to this
+	 * @return *this
+	 */
+	template <typename E>
+	Matrix<T, Alloc>& operator+=(const MatrixExpression<E>& rhs);
+
+	/**
+	 * @brief Subtraction assignment operator, subtracts rhs from this in place
+	 * @param rhs the matrix or expression to subtract from this
+	 * @return *this
+	 */
+	template <typename E>
+	Matrix<T, Alloc>& operator-=(const MatrixExpression<E>& rhs);
+
+	/**
+	 * @brief Multiplication assignment operator, replaces this with (this * rhs)
+	 * @param rhs the matrix to multiply with this
+	 * @return *this
+	 */
+	Matrix<T, Alloc>& operator*=(const Matrix<T, Alloc>& rhs);
 
 	/**
 	 * @brief compare the contents of this matrix with the given matrix
 	 * @param rhs the matrix to compare its content to this matrix
 	 * @return true if all the elements are equal, otherwise false
 	 */
-	bool operator==(const Matrix<T>& rhs) const;
+	bool operator==(const Matrix<T, Alloc>& rhs) const;
 
 	/**
 	 * @brief compare the contents of this matrix with the given matrix
 	 * @param rhs the matrix to compare its content to this matrix
 	 * @return false if all the elements are equal, otherwise true
 	 */
-	bool operator!=(const Matrix<T>& rhs) const;
+	bool operator!=(const Matrix<T, Alloc>& rhs) const;
 
 	/**
 	 * @brief returns the a transpose matrix of this matrix
 	 * @return transpose matrix
 	 */
-	Matrix<T> trans() const;
+	Matrix<T, Alloc> trans() const;
+
+	/**
+	 * @brief returns a transposed view of this matrix, conjugated over the complex field like trans()
+	 * the elements aren't copied, multiplying the view (e.g. A.transView() * A) runs a dedicated
+	 * kernel, the view should be used in the same statement like any other expression
+	 * @return a transposed view of this matrix
+	 */
+	MatrixTransView<T, Alloc> transView() const
+	{
+		return MatrixTransView<T, Alloc>(*this);
+	}
+
+	/**
+	 * @brief transposes this square matrix in place, without allocating a second matrix
+	 * over the complex field the matrix is conjugate transposed, like trans()
+	 * @throw std::logic_error if the matrix isn't square
+	 */
+	void transInPlace();
 
 	/**
 	 * @brief returns true if the matrix is square, otherwise false
@@ -203,14 +458,33 @@ public:
 	 * @param matrix the matrix to output
 	 * @return output stream
 	 */
-	template <typename P>
-	friend std::ostream& operator<<(std::ostream& os, const Matrix<P>& matrix);
+	template <typename P, typename A>
+	friend std::ostream& operator<<(std::ostream& os, const Matrix<P, A>& matrix);
+
+	/**
+	 * @brief multiplies a transposed view with a matrix
+	 * @param lhs the transposed view
+	 * @param rhs the matrix to multiply with the view
+	 * @return A matrix that equals (lhs * rhs)
+	 */
+	template <typename P, typename A>
+	friend Matrix<P, A> operator*(const MatrixTransView<P, A>& lhs, const Matrix<P, A>& rhs);
+
+	/**
+	 * @brief multiplies a matrix with a transposed view
+	 * @param lhs the matrix to multiply with the view
+	 * @param rhs the transposed view
+	 * @return A matrix that equals (lhs * rhs)
+	 */
+	template <typename P, typename A>
+	friend Matrix<P, A> operator*(const Matrix<P, A>& lhs, const MatrixTransView<P, A>& rhs);
 
 	/**
 	 * @brief returns a constant of the element in the given matrix position
 	 * @param row the row number
 	 * @param col the column number
 	 * @return the element in the given row and column number
+	 * @throw std::out_of_range if the position is outside the matrix and MATRIX_CHECKED_ACCESS is 1
 	 */
 	const T& operator()(unsigned int row, unsigned int col) const;
 
@@ -219,16 +493,39 @@ public:
 	 * @param row the row number
 	 * @param col the column number
 	 * @return the element in the given row and column number
+	 * @throw std::out_of_range if the position is outside the matrix and MATRIX_CHECKED_ACCESS is 1
 	 */
 	T& operator()(unsigned int row, unsigned int col);
 
+	/**
+	 * @brief returns a constant of the element in the given matrix position without checking it
+	 * @param row the row number, less than rows()
+	 * @param col the column number, less than cols()
+	 * @return the element in the given row and column number
+	 */
+	const T& unchecked(unsigned int row, unsigned int col) const
+	{
+		return matrix[_getIndex(row, col)];
+	}
+
+	/**
+	 * @brief returns the element in the given matrix position without checking it
+	 * @param row the row number, less than rows()
+	 * @param col the column number, less than cols()
+	 * @return the element in the given row and column number
+	 */
+	T& unchecked(unsigned int row, unsigned int col)
+	{
+		return matrix[_getIndex(row, col)];
+	}
+
 	/**
 	 * @brief Returns the iterator to the first element of the matrix
 	 * @return iterator to the first element of the matrix
 	 */
 	const_iterator begin() const
 	{
-		return const_iterator(&(matrix.front()));
+		return const_iterator(matrix.data(), nCols, nStride);
 	}
 
 	/**
@@ -237,7 +534,7 @@ public:
 	 */
 	const_iterator end() const
 	{
-		return const_iterator(&(matrix.back()) + 1);
+		return const_iterator(matrix.data() + (std::size_t) nRows * nStride, nCols, nStride);
 	}
 
 	/**
@@ -252,6 +549,111 @@ public:
 	 */
 	unsigned int rows() const;
 
+	/**
+	 * @brief returns the number of elements between the starts of two consecutive rows, the
+	 * leading dimension of the storage
+	 * @return the row stride, cols() unless the rows are padded
+	 */
+	unsigned int stride() const
+	{
+		return nStride;
+	}
+
+	/**
+	 * @brief returns the storage, rows() rows of cols() elements, stride() elements apart
+	 * @return the first element
+	 */
+	const T* data() const
+	{
+		return matrix.data();
+	}
+
+	/**
+	 * @brief sets the execution mode of the matrix operations
+	 * in parallel mode the element-wise operations, operator* and trans() split their rows (and
+	 * the recursive algorithms their subproblems) across the work-stealing thread pool, the
+	 * results are identical to the serial ones.
+	 * The mode is process wide, it applies to the matrices of every element type.
+	 * @param enable true for parallel execution, false for serial execution
+	 */
+	static void setParallel(bool enable)
+	{
+		parallelMode() = enable;
+	}
+
+	/**
+	 * @brief returns true if the matrix operations run in parallel
+	 * @return true if the matrix operations run in parallel
+	 */
+	static bool isParallel()
+	{
+		return parallelMode();
+	}
+
+	/**
+	 * @brief sets the number of threads running the parallel operations, including the caller
+	 * the thread pool is shared by the matrices of every element type and by every thread
+	 * calling the operations, it should be resized while no operation runs
+	 * @param count the number of threads, 1 runs the parallel operations on the caller
+	 */
+	static void setThreadCount(unsigned int count)
+	{
+		ThreadPool::instance().resize(count);
+	}
+
+	/**
+	 * @brief returns the number of threads running the parallel operations, including the caller
+	 * @return the number of threads
+	 */
+	static unsigned int threadCount()
+	{
+		return ThreadPool::instance().size();
+	}
+
+	/**
+	 * @brief sets the multiplication algorithm of square matrices
+	 * When enabled, multiplying two square matrices of size n > cutoff uses the recursive
+	 * Strassen-Winograd algorithm (7 half size products and 15 additions per level, about
+	 * O(n^2.81)), odd sizes are padded with a zero row and column.
+	 * Accuracy: for int the result is exact. For double and Complex the result is not bit
+	 * identical to the classic product, the error bound is normwise (relative to |A||B|)
+	 * instead of per element and grows with the recursion depth, so elements much smaller
+	 * than the matrix norms may lose most of their relative accuracy. A higher cutoff
+	 * trades speed for accuracy.
+	 * @param enable true to use Strassen-Winograd, false to use the classic product
+	 */
+	static void setStrassen(bool enable)
+	{
+		MatrixSettings<T>::strassen = enable;
+	}
+
+	/**
+	 * @brief sets the size at or below which Strassen-Winograd recursion stops and the
+	 * classic product is used
+	 * @param cutoff the recursion cutoff size
+	 */
+	static void setStrassenCutoff(unsigned int cutoff)
+	{
+		MatrixSettings<T>::strassenCutoff = cutoff;
+	}
+
+	/**
+	 * @brief sets the multiplication algorithm of complex matrices, has no effect on other
+	 * element types
+	 * When enabled, A * B is computed from the real and imaginary planes of the operands
+	 * with 3 real matrix products instead of 4 (Gauss / Karatsuba):
+	 * T1 = Ar * Br, T2 = Ai * Bi, T3 = (Ar + Ai) * (Br + Bi),
+	 * real part = T1 - T2, imaginary part = T3 - T1 - T2.
+	 * Accuracy: the result is not bit identical to the classic product, the imaginary part is
+	 * computed by cancellation and its error is bounded relative to |A||B| rather than to
+	 * the element itself.
+	 * @param enable true to use 3 real products, false to use the classic product
+	 */
+	static void setGaussMultiply(bool enable)
+	{
+		MatrixSettings<T>::gaussMultiply = enable;
+	}
+
 private:
 
 	/**
@@ -261,11 +663,326 @@ private:
 	 * @param col number of column
 	 * @return the appropriate index of the element in the vector
 	 */
-	unsigned int _getIndex(unsigned int row, unsigned int col) const
+	std::size_t _getIndex(unsigned int row, unsigned int col) const
+	{
+		return ((std::size_t) row * nStride + col);
+	}
+
+	/**
+	 * @brief throws if the given position is outside the matrix, when MATRIX_CHECKED_ACCESS is 1
+	 * @param row number of row
+	 * @param col number of column
+	 * @throw std::out_of_range if the position is outside the matrix
+	 */
+	void _checkRange(unsigned int row, unsigned int col) const
+	{
+		if (MATRIX_CHECKED_ACCESS && (row >= nRows || col >= nCols))
+		{
+			throw std::out_of_range(OUT_OF_RANGE_MSG);
+		}
+	}
+
+	/**
+	 * @brief calls func(first, last) on row blocks covering [0, rows)
+	 * the blocks run on the thread pool in parallel mode, otherwise func is called once
+	 * @param rows number of rows to split
+	 * @param rowSize number of elements processed per row, used to skip tiny operations
+	 * @param func the function to run on every row block
+	 */
+	template <typename Func>
+	static void _forEachRowBlock(unsigned int rows, unsigned long rowSize, const Func& func)
+	{
+		if (!parallelMode() || rows * rowSize < PARALLEL_MIN_ELEMENTS)
+		{
+			func(0, rows);
+			return;
+		}
+		ThreadPool::instance().parallelFor(rows, func);
+	}
+
+	/**
+	 * @brief runs first and second, forked on the thread pool in parallel mode
+	 * @param elements number of elements processed by both functions, used to skip tiny operations
+	 * @param first the first function
+	 * @param second the second function
+	 */
+	template <typename First, typename Second>
+	static void _forkJoin(unsigned long elements, const First& first, const Second& second)
+	{
+		if (!parallelMode() || elements < PARALLEL_MIN_ELEMENTS)
+		{
+			first();
+			second();
+			return;
+		}
+		ThreadPool::instance().invoke(first, second);
+	}
+
+	/**
+	 * @brief writes the transpose of the given source tile into dst, a cols() x rows() matrix
+	 * the tile is split recursively along its longer side until it fits in TRANS_BLOCK, so both
+	 * the source rows and the destination rows are walked in cache sized pieces at every level.
+	 * In parallel mode the halves are forked on the thread pool, so tall and wide matrices split
+	 * as evenly as square ones.
+	 * @param dst the transpose matrix storage
+	 * @param dstStride the row stride of the transpose matrix
+	 * @param rowFirst the first source row of the tile
+	 * @param rowLast the row following the last source row of the tile
+	 * @param colFirst the first source column of the tile
+	 * @param colLast the column following the last source column of the tile
+	 */
+	void _transBlock(T* dst, std::size_t dstStride, unsigned int rowFirst, unsigned int rowLast,
+					 unsigned int colFirst, unsigned int colLast) const;
+
+	/**
+	 * @brief transposes the square diagonal tile [first, last) x [first, last) in place
+	 * @param first the first row and column of the tile
+	 * @param last the row and column following the tile
+	 */
+	void _transDiagonal(unsigned int first, unsigned int last);
+
+	/**
+	 * @brief swaps the tile [rowFirst, rowLast) x [colFirst, colLast) with its mirror tile
+	 * across the diagonal, transposing both, the tile should be above the diagonal
+	 * @param rowFirst the first row of the tile
+	 * @param rowLast the row following the last row of the tile
+	 * @param colFirst the first column of the tile
+	 * @param colLast the column following the last column of the tile
+	 */
+	void _swapTransBlock(unsigned int rowFirst, unsigned int rowLast, unsigned int colFirst, unsigned int colLast);
+
+	/**
+	 * @brief returns the element at the given row major index, used by the expression nodes
+	 * @param index the element index
+	 * @return the element at the given index
+	 */
+	const T& _at(std::size_t index) const
+	{
+		return matrix[nStride == nCols ? index : index + index / nCols * (nStride - nCols)];
+	}
+
+	/**
+	 * @brief evaluates the given expression into the matrix storage
+	 * the expression should have the size of this matrix
+	 * @param expr the expression to evaluate
+	 */
+	template <typename E>
+	void _assign(const E& expr);
+
+	/**
+	 * @brief evaluates the given transposed view into the matrix storage with the tiled transpose
+	 * the view should have the size of this matrix, a view of this matrix is transposed in place
+	 * @param view the view to evaluate
+	 */
+	void _assign(const MatrixTransView<T, Alloc>& view);
+
+	/**
+	 * @brief evaluates the given expression into the empty storage of a new matrix
+	 * serially the elements are appended chunk by chunk, so they are written once instead of
+	 * being zero filled first, in parallel mode the storage is allocated for the row blocks
+	 * @param expr the expression to evaluate, of the size of this matrix
+	 */
+	template <typename E>
+	void _construct(const E& expr);
+
+	/**
+	 * @brief evaluates the given transposed view into the empty storage of a new matrix, the
+	 * tiled transpose writes the storage out of order so it's allocated first
+	 * @param view the view to evaluate, of the size of this matrix
+	 */
+	void _construct(const MatrixTransView<T, Alloc>& view)
+	{
+		matrix.resize((std::size_t) nRows * nStride);
+		_assign(view);
+	}
+
+	/**
+	 * @brief creates a rows x cols matrix whose rows are written by func(first, last, out, stride),
+	 * row i of [first, last) at out + (i - first) * stride
+	 * serially blocks of blockRows rows of trivial elements are written into a stack chunk of
+	 * EVALUATE_CHUNK elements and appended, so the storage is written once instead of being zero
+	 * filled first. Larger blocks, other elements and the row blocks of parallel mode write the
+	 * allocated storage in place.
+	 * @param rows number of rows
+	 * @param cols number of columns
+	 * @param rowSize number of elements processed per row, used to skip tiny operations
+	 * @param blockRows number of rows func writes at a time serially
+	 * @param func the function writing a block of rows
+	 * @return the matrix
+	 */
+	template <typename Func>
+	static Matrix<T, Alloc> _generateRows(unsigned int rows, unsigned int cols, unsigned long rowSize,
+										  unsigned int blockRows, const Func& func);
+
+	/**
+	 * @brief appends elements and then value initialized elements to the reserved storage
+	 * @param elements the elements to append
+	 * @param count the number of elements
+	 * @param zeros the number of value initialized elements following them
+	 */
+	void _append(const T* elements, std::size_t count, std::size_t zeros)
+	{
+		matrix.insert(matrix.end(), elements, elements + count);
+		if (zeros != 0)
+		{
+			matrix.insert(matrix.end(), zeros, T());
+		}
+	}
+
+	/**
+	 * @brief returns false, a matrix operand reads the elements of a matrix at the same index
+	 * @return false
+	 */
+	template <typename M>
+	bool _transposes(const M&) const
+	{
+		return false;
+	}
+
+	/**
+	 * @brief evaluates the elements [first, last) of the given expression into out
+	 * @param expr the expression to evaluate
+	 * @param out the output of the element first
+	 * @param first the first element index
+	 * @param last the index following the last element
+	 * @param shift the distance of the elements in the operands storage from their index, the
+	 * padding of the rows before them
+	 */
+	template <typename E>
+	static void _evaluateBlock(const E& expr, T* out, std::size_t first, std::size_t last, std::size_t /*shift*/)
+	{
+		std::size_t i;
+		for (i = first; i < last; ++i)
+		{
+			out[i - first] = expr._at(i);
+		}
+	}
+
+	/**
+	 * @brief evaluates an operation on two matrices with the vectorized element kernel of Op
+	 * @param expr the expression to evaluate
+	 * @param out the output of the element first, may be in one of the operands storage
+	 * @param first the first element index
+	 * @param last the index following the last element
+	 * @param shift the distance of the elements in the operands storage from their index, the
+	 * padding of the rows before them
+	 */
+	template <typename Op>
+	static void _evaluateBlock(const MatrixBinaryExpression<Op, Matrix<T, Alloc>, Matrix<T, Alloc>>& expr, T* out,
+							   std::size_t first, std::size_t last, std::size_t shift)
+	{
+		Op::kernel(expr.left().matrix.data() + first + shift, expr.right().matrix.data() + first + shift,
+				   out, last - first);
+	}
+
+	/**
+	 * @brief multiplies this with rhs with the iterative or the blocked kernel
+	 * @param rhs the matrix to multiply with this, its row number should equal cols()
+	 * @return A matrix that equals (this * rhs)
+	 */
+	Matrix<T, Alloc> _multiply(const Matrix<T, Alloc>& rhs) const;
+
+	/**
+	 * @brief multiplies the transpose of lhs with rhs without forming the transpose
+	 * @param lhs the transposed operand, its row number should equal rhs.rows()
+	 * @param rhs the right operand
+	 * @return A matrix that equals (lhs.trans() * rhs)
+	 */
+	static Matrix<T, Alloc> _multiplyTransLhs(const Matrix<T, Alloc>& lhs, const Matrix<T, Alloc>& rhs);
+
+	/**
+	 * @brief multiplies lhs with the transpose of rhs without forming the transpose
+	 * @param lhs the left operand
+	 * @param rhs the transposed operand, its column number should equal lhs.cols()
+	 * @return A matrix that equals (lhs * rhs.trans())
+	 */
+	static Matrix<T, Alloc> _multiplyTransRhs(const Matrix<T, Alloc>& lhs, const Matrix<T, Alloc>& rhs);
+
+	/**
+	 * @brief multiplies two square matrices of the same size with Strassen-Winograd
+	 * @param lhs the left operand
+	 * @param rhs the right operand
+	 * @return A matrix that equals (lhs * rhs)
+	 */
+	static Matrix<T, Alloc> _multiplyStrassen(const Matrix<T, Alloc>& lhs, const Matrix<T, Alloc>& rhs);
+
+	/**
+	 * @brief multiplies this with rhs with 3 real products, only for Complex
+	 * @param rhs the matrix to multiply with this, its row number should equal cols()
+	 * @return A matrix that equals (this * rhs)
+	 */
+	Matrix<T, Alloc> _multiplyGauss(const Matrix<T, Alloc>& rhs, std::true_type) const;
+
+	/**
+	 * @brief other element types have no 3 real products method and use the default product
+	 * @param rhs the matrix to multiply with this, its row number should equal cols()
+	 * @return A matrix that equals (this * rhs)
+	 */
+	Matrix<T, Alloc> _multiplyGauss(const Matrix<T, Alloc>& rhs, std::false_type) const
+	{
+		return _multiplyDefault(rhs);
+	}
+
+	/**
+	 * @brief multiplies this with rhs with Strassen-Winograd when enabled and applicable,
+	 * otherwise with the iterative or the blocked kernel
+	 * @param rhs the matrix to multiply with this, its row number should equal cols()
+	 * @return A matrix that equals (this * rhs)
+	 */
+	Matrix<T, Alloc> _multiplyDefault(const Matrix<T, Alloc>& rhs) const
+	{
+		if (MatrixSettings<T>::strassen && isSquareMatrix() && rhs.isSquareMatrix() &&
+			nRows > MatrixSettings<T>::strassenCutoff && nRows > 1)
+		{
+			return _multiplyStrassen(*this, rhs);
+		}
+		return _multiply(rhs);
+	}
+
+	/**
+	 * @brief returns the size x size block of this matrix starting at (row, col)
+	 * elements outside the matrix are zero
+	 * @param row the first row of the block
+	 * @param col the first column of the block
+	 * @param size the block size
+	 * @return the block
+	 */
+	Matrix<T, Alloc> _block(unsigned int row, unsigned int col, unsigned int size) const;
+
+	/**
+	 * @brief multiplies this with rhs using the iterative algorithm
+	 * @param rhs the matrix to multiply with this
+	 * @return A matrix that equals (this * rhs)
+	 */
+	Matrix<T, Alloc> _multiplyClassic(const Matrix<T, Alloc>& rhs) const;
+
+	/**
+	 * @brief multiplies this with rhs using a cache blocked kernel
+	 * rhs is first packed into transposed panels so the inner loop reads both operands
+	 * contiguously, every result element still sums its products in the same order as
+	 * _multiplyClassic so both kernels give identical results
+	 * @param rhs the matrix to multiply with this
+	 * @param result a zero matrix of size rows() x rhs.cols() to store the product in
+	 */
+	void _multiplyBlocked(const Matrix<T, Alloc>& rhs, Matrix<T, Alloc>& result) const
 	{
-		return (row*nCols + col);
+		_multiplyPacked(_pack(rhs), rhs.nCols, result);
 	}
 
+	/**
+	 * @brief packs the given right operand of the blocked kernel into transposed panels
+	 * @param rhs the right operand
+	 * @return the packed operand
+	 */
+	static std::vector<T, Alloc> _pack(const Matrix<T, Alloc>& rhs);
+
+	/**
+	 * @brief multiplies this with a right operand packed by _pack using the cache blocked kernel
+	 * @param packed the packed right operand, with cols() rows
+	 * @param m the number of columns of the right operand
+	 * @param result a zero matrix of size rows() x m to store the product in
+	 */
+	void _multiplyPacked(const std::vector<T, Alloc>& packed, unsigned int m, Matrix<T, Alloc>& result) const;
 
 };
 
@@ -273,30 +990,30 @@ private:
  * @brief default constructor
  * initializes a matrix of size 1x1 with a single element 0
  */
-template <typename T>
-Matrix<T>::Matrix() : nCols(DEFAULT_CTOR_COLS), nRows(DEFAULT_CTOR_ROWS)
+template <typename T, typename Alloc>
+Matrix<T, Alloc>::Matrix() : matrix((std::size_t) DEFAULT_CTOR_ROWS * MatrixLayout<Alloc>::stride(DEFAULT_CTOR_COLS)),
+							nCols(DEFAULT_CTOR_COLS), nRows(DEFAULT_CTOR_ROWS),
+							nStride(MatrixLayout<Alloc>::stride(DEFAULT_CTOR_COLS))
 {
-	/* initialize a new vector with a single element 0 */
-	std::vector<T> zero(nCols, DEFAULT_CTOR_ELEM);
-	matrix = zero;
+	MATRIX_INSTRUMENT_SCOPE(CONSTRUCT, nRows, 0, nCols);
+	MATRIX_INSTRUMENT_ALLOC(matrix.size() * sizeof(T));
+	matrix[0] = DEFAULT_CTOR_ELEM;
 }
 /**
  * @brief Matrix constructor, creates a matrix with the given row and column sizes initialized to zeroes
  * @param rows number of rows
  * @param cols number of columns
  */
-template <typename T>
-Matrix<T>::Matrix(unsigned int rows, unsigned int cols)
+template <typename T, typename Alloc>
+Matrix<T, Alloc>::Matrix(unsigned int rows, unsigned int cols)
 {
-	if (rows < 0 || cols < 0)
-	{
-		throw std::invalid_argument(ROWS_COLS_CTOR_EXCEPTION_MSG);
-	}
+	MATRIX_INSTRUMENT_SCOPE(CONSTRUCT, rows, 0, cols);
 	nRows = rows;
 	nCols = cols;
+	nStride = MatrixLayout<Alloc>::stride(cols);
 
-	std::vector<T> vec(rows * cols);
-	matrix = vec;
+	matrix.resize((unsigned long) rows * nStride);
+	MATRIX_INSTRUMENT_ALLOC(matrix.size() * sizeof(T));
 }
 
 /**
@@ -305,122 +1022,648 @@ Matrix<T>::Matrix(unsigned int rows, unsigned int cols)
  * @param cols number of columns
  * @param cells the element to populate the matrix with
  */
-template <typename T>
-Matrix<T>::Matrix(unsigned int rows, unsigned int cols, const std::vector<T>& cells)
+template <typename T, typename Alloc>
+Matrix<T, Alloc>::Matrix(unsigned int rows, unsigned int cols, const std::vector<T>& cells)
+{
+	MATRIX_INSTRUMENT_SCOPE(CONSTRUCT, rows, 0, cols);
+	// throw exception if given vector size doesn't fit the matrix
+	if (cells.size() != (std::size_t) rows * cols)
+	{
+		throw std::invalid_argument(CELLS_CTOR_EXCEPTION_MSG);
+	}
+	MATRIX_INSTRUMENT_ALLOC((std::size_t) rows * MatrixLayout<Alloc>::stride(cols) * sizeof(T));
+	nCols = cols;
+	nRows = rows;
+	nStride = MatrixLayout<Alloc>::stride(cols);
+	if (nStride == nCols)
+	{
+		matrix.assign(cells.begin(), cells.end());
+		return;
+	}
+	matrix.reserve((std::size_t) rows * nStride);
+	unsigned int i;
+	for (i = 0; i < nRows; ++i)
+	{
+		_append(cells.data() + (std::size_t) i * nCols, nCols, nStride - nCols);
+	}
+}
+
+/**
+ * @brief Constructs a matrix that adopts the given vector as its elements, without copying them
+ * @param rows number of rows
+ * @param cols number of columns
+ * @param cells the elements of the matrix, left empty
+ */
+template <typename T, typename Alloc>
+Matrix<T, Alloc>::Matrix(unsigned int rows, unsigned int cols, std::vector<T, Alloc>&& cells)
 {
+	MATRIX_INSTRUMENT_SCOPE(CONSTRUCT, rows, 0, cols);
 	// throw exception if given vector size doesn't fit the matrix
-	if (cells.size() != (rows * cols) || rows < 0 || cols < 0)
+	if (cells.size() != (unsigned long) rows * cols)
 	{
 		throw std::invalid_argument(CELLS_CTOR_EXCEPTION_MSG);
 	}
 	nCols = cols;
 	nRows = rows;
-	matrix = cells;
+	nStride = MatrixLayout<Alloc>::stride(cols);
+	if (nStride == nCols)
+	{
+		matrix = std::move(cells);
+		return;
+	}
+	// the rows are spread out to the padded layout in place, from the last one down
+	cells.resize((std::size_t) rows * nStride);
+	MATRIX_INSTRUMENT_ALLOC(cells.size() * sizeof(T));
+	unsigned int i;
+	for (i = nRows; i-- > 0;)
+	{
+		std::copy_backward(cells.begin() + (std::size_t) i * nCols, cells.begin() + (std::size_t) (i + 1) * nCols,
+						   cells.begin() + (std::size_t) i * nStride + nCols);
+		std::fill(cells.begin() + (std::size_t) i * nStride + nCols, cells.begin() + (std::size_t) (i + 1) * nStride,
+				  T());
+	}
+	matrix = std::move(cells);
+}
+
+
+/**
+ * @brief Assigns the content of the given matrix
+ * @param rhs matrix whose values to assign
+ * @return *this
+ */
+template <typename T, typename Alloc>
+Matrix<T, Alloc>& Matrix<T, Alloc>::operator=(const Matrix<T, Alloc>& rhs)
+{
+	matrix = rhs.matrix;
+	nCols = rhs.nCols;
+	nRows = rhs.nRows;
+	nStride = rhs.nStride;
+
+	return *this;
+}
+
+/**
+ * @brief Moves the content of the given matrix into this matrix
+ * rhs is left as an empty 0x0 matrix
+ * @param rhs matrix whose values to move
+ * @return *this
+ */
+template <typename T, typename Alloc>
+Matrix<T, Alloc>& Matrix<T, Alloc>::operator=(Matrix<T, Alloc>&& rhs) noexcept
+{
+	if (this != &rhs)
+	{
+		matrix = std::move(rhs.matrix);
+		nCols = rhs.nCols;
+		nRows = rhs.nRows;
+		nStride = rhs.nStride;
+		rhs.matrix.clear();
+		rhs.nCols = 0;
+		rhs.nRows = 0;
+		rhs.nStride = 0;
+	}
+
+	return *this;
+}
+
+/**
+ * @brief Constructs a matrix by evaluating the given expression in a single pass
+ * @param expr the expression to evaluate
+ */
+template <typename T, typename Alloc>
+template <typename E>
+Matrix<T, Alloc>::Matrix(const MatrixExpression<E>& expr) :
+		nCols(expr.self().cols()), nRows(expr.self().rows()), nStride(MatrixLayout<Alloc>::stride(expr.self().cols()))
+{
+	MATRIX_INSTRUMENT_SCOPE(EVALUATE, nRows, 0, nCols);
+	MATRIX_INSTRUMENT_ALLOC((std::size_t) nRows * nStride * sizeof(T));
+	_construct(expr.self());
+}
+
+/**
+ * @brief Assigns the value of the given expression, evaluated in a single pass
+ * the existing storage is reused when the sizes match
+ * @param expr the expression to evaluate
+ * @return *this
+ */
+template <typename T, typename Alloc>
+template <typename E>
+Matrix<T, Alloc>& Matrix<T, Alloc>::operator=(const MatrixExpression<E>& expr)
+{
+	MATRIX_INSTRUMENT_SCOPE(EVALUATE, expr.self().rows(), 0, expr.self().cols());
+	if (rows() != expr.self().rows() || cols() != expr.self().cols())
+	{
+		return *this = Matrix<T, Alloc>(expr);
+	}
+	// every element depends only on the operand elements at the same index, so the
+	// expression can be evaluated into the storage of one of its operands
+	_assign(expr.self());
+	return *this;
+}
+
+/**
+ * @brief evaluates the given expression into the matrix storage
+ * the expression should have the size of this matrix
+ * @param expr the expression to evaluate
+ */
+template <typename T, typename Alloc>
+template <typename E>
+void Matrix<T, Alloc>::_assign(const E& expr)
+{
+	if (expr._transposes(*this))
+	{
+		// the elements of this are read at other indices, evaluate into new storage
+		*this = Matrix<T, Alloc>(expr);
+		return;
+	}
+	T* out = matrix.data();
+	_forEachRowBlock(nRows, nCols, [&](unsigned int first, unsigned int last)
+	{
+		if (nStride == nCols)
+		{
+			_evaluateBlock(expr, out + (std::size_t) first * nCols, (std::size_t) first * nCols,
+						   (std::size_t) last * nCols, 0);
+			return;
+		}
+		unsigned int i;
+		for (i = first; i < last; ++i)
+		{
+			_evaluateBlock(expr, out + (std::size_t) i * nStride, (std::size_t) i * nCols,
+						   (std::size_t) (i + 1) * nCols, (std::size_t) i * (nStride - nCols));
+		}
+	});
+}
+
+/**
+ * @brief evaluates the given expression into the empty storage of a new matrix
+ * @param expr the expression to evaluate, of the size of this matrix
+ */
+template <typename T, typename Alloc>
+template <typename E>
+void Matrix<T, Alloc>::_construct(const E& expr)
+{
+	if (!std::is_trivial<T>::value || (parallelMode() && (unsigned long) nRows * nCols >= PARALLEL_MIN_ELEMENTS))
+	{
+		// elements with a constructor would be constructed in the chunk and copied, and the row
+		// blocks write the storage concurrently
+		matrix.resize((std::size_t) nRows * nStride);
+		_assign(expr);
+		return;
+	}
+	matrix.reserve((std::size_t) nRows * nStride);
+	// without padding the whole storage is a single run of elements
+	const std::size_t padding = nStride - nCols;
+	const unsigned int runs = padding == 0 ? 1 : nRows;
+	const std::size_t runLength = padding == 0 ? (std::size_t) nRows * nCols : nCols;
+	T chunk[EVALUATE_CHUNK];
+	unsigned int run;
+	for (run = 0; run < runs; ++run)
+	{
+		std::size_t first = run * runLength, last = first + runLength, i, count;
+		for (i = first; i < last; i += count)
+		{
+			count = std::min<std::size_t>(EVALUATE_CHUNK, last - i);
+			_evaluateBlock(expr, chunk, i, i + count, run * padding);
+			_append(chunk, count, i + count == last ? padding : 0);
+		}
+	}
+}
+
+/**
+ * @brief creates a rows x cols matrix whose rows are written by func(first, last, out, stride),
+ * row i of [first, last) at out + (i - first) * stride
+ * @param rows number of rows
+ * @param cols number of columns
+ * @param rowSize number of elements processed per row, used to skip tiny operations
+ * @param blockRows number of rows func writes at a time serially
+ * @param func the function writing a block of rows
+ * @return the matrix
+ */
+template <typename T, typename Alloc>
+template <typename Func>
+Matrix<T, Alloc> Matrix<T, Alloc>::_generateRows(unsigned int rows, unsigned int cols, unsigned long rowSize,
+												 unsigned int blockRows, const Func& func)
+{
+	Matrix<T, Alloc> result(0, 0);
+	result.nRows = rows;
+	result.nCols = cols;
+	result.nStride = MatrixLayout<Alloc>::stride(cols);
+	const std::size_t stride = result.nStride;
+	MATRIX_INSTRUMENT_ALLOC((std::size_t) rows * stride * sizeof(T));
+	if (!std::is_trivial<T>::value || (unsigned long) blockRows * cols > EVALUATE_CHUNK ||
+		(parallelMode() && rows * rowSize >= PARALLEL_MIN_ELEMENTS))
+	{
+		// elements with a constructor would be constructed in the chunk and copied, a block of
+		// rows larger than the chunk is written in place, and the row blocks write the storage
+		// concurrently
+		result.matrix.resize((std::size_t) rows * stride);
+		T* out = result.matrix.data();
+		_forEachRowBlock(rows, rowSize, [&](unsigned int first, unsigned int last)
+		{
+			func(first, last, out + first * stride, stride);
+		});
+		return result;
+	}
+	result.matrix.reserve((std::size_t) rows * stride);
+	T chunk[EVALUATE_CHUNK];
+	unsigned int first, i;
+	for (first = 0; first < rows; first += blockRows)
+	{
+		const unsigned int last = std::min<unsigned int>(first + blockRows, rows);
+		func(first, last, chunk, (std::size_t) cols);
+		for (i = first; i < last; ++i)
+		{
+			result._append(chunk + (std::size_t) (i - first) * cols, cols, stride - cols);
+		}
+	}
+	return result;
+}
+
+/**
+ * @brief Matrix multiplication operator
+ * Using the iterative algorithm for small matrices and a cache blocked kernel for large ones,
+ * or Strassen-Winograd for large square matrices when enabled by setStrassen(), or 3 real
+ * products for complex matrices when enabled by setGaussMultiply(),
+ * the result rows are split across the thread pool in parallel mode
+ * @param rhs the matrix to multiply with this
+ * @return A matrix that equals (this * rhs)
+ */
+template <typename T, typename Alloc>
+Matrix<T, Alloc> Matrix<T, Alloc>::operator*(const Matrix<T, Alloc>& rhs) const
+{
+	MATRIX_INSTRUMENT_SCOPE(MULTIPLY, nRows, nCols, rhs.nCols);
+	if (cols() != rhs.rows())
+	{
+		throw std::invalid_argument(MULTIPLICATION_EXCEPTION_MSG);
+	}
+	if (MatrixSettings<T>::gaussMultiply)
+	{
+		return _multiplyGauss(rhs, std::is_same<T, Complex>());
+	}
+	return _multiplyDefault(rhs);
+}
+
+/**
+ * @brief multiplies this with rhs with the iterative or the blocked kernel
+ * @param rhs the matrix to multiply with this, its row number should equal cols()
+ * @return A matrix that equals (this * rhs)
+ */
+template <typename T, typename Alloc>
+Matrix<T, Alloc> Matrix<T, Alloc>::_multiply(const Matrix<T, Alloc>& rhs) const
+{
+	if ((unsigned long) nRows * nCols * rhs.nCols < BLOCKED_MULT_MIN_OPS)
+	{
+		return _multiplyClassic(rhs);
+	}
+	// the blocked kernel accumulates a panel at a time into the zero matrix
+	Matrix<T, Alloc> result(nRows, rhs.nCols);
+	_multiplyBlocked(rhs, result);
+	return result;
+}
+
+/**
+ * @brief multiplies the transpose of lhs with rhs without forming the transpose
+ * result row i accumulates the rhs rows scaled by the (transposed) elements of lhs column i,
+ * a block of VIEW_MULT_BLOCK result rows at a time, in increasing k order like _multiplyClassic
+ * on lhs.trans(). The opt-in Strassen and Gauss algorithms still multiply lhs.trans().
+ * @param lhs the transposed operand, its row number should equal rhs.rows()
+ * @param rhs the right operand
+ * @return A matrix that equals (lhs.trans() * rhs)
+ */
+template <typename T, typename Alloc>
+Matrix<T, Alloc> Matrix<T, Alloc>::_multiplyTransLhs(const Matrix<T, Alloc>& lhs, const Matrix<T, Alloc>& rhs)
+{
+	if (MatrixSettings<T>::strassen || MatrixSettings<T>::gaussMultiply)
+	{
+		return lhs.trans() * rhs;
+	}
+
+	const unsigned int n = lhs.nRows;
+	const unsigned int m = rhs.nCols;
+	Matrix<T, Alloc> result(lhs.nCols, m);
+	_forEachRowBlock(result.nRows, (unsigned long) n * m, [&](unsigned int first, unsigned int last)
+	{
+		unsigned int i0, i, j, k;
+		for (i0 = first; i0 < last; i0 += VIEW_MULT_BLOCK)
+		{
+			const unsigned int iEnd = std::min<unsigned int>(i0 + VIEW_MULT_BLOCK, last);
+			for (k = 0; k < n; ++k)
+			{
+				const T* rhsRow = &rhs.matrix[rhs._getIndex(k, 0)];
+				for (i = i0; i < iEnd; ++i)
+				{
+					const T element = _transElement(lhs.matrix[lhs._getIndex(k, i)]);
+					T* resultRow = &result.matrix[result._getIndex(i, 0)];
+					for (j = 0; j < m; ++j)
+					{
+						resultRow[j] = resultRow[j] + element * rhsRow[j];
+					}
+				}
+			}
+		}
+	});
+	return result;
+}
+
+/**
+ * @brief multiplies lhs with the transpose of rhs without forming the transpose
+ * every result element is the product of a lhs row with a rhs row, both contiguous, summed in
+ * increasing k order like _multiplyClassic on rhs.trans(). A block of VIEW_MULT_BLOCK lhs rows
+ * is multiplied with every rhs row before moving to the next block.
+ * The opt-in Strassen and Gauss algorithms still multiply rhs.trans().
+ * @param lhs the left operand
+ * @param rhs the transposed operand, its column number should equal lhs.cols()
+ * @return A matrix that equals (lhs * rhs.trans())
+ */
+template <typename T, typename Alloc>
+Matrix<T, Alloc> Matrix<T, Alloc>::_multiplyTransRhs(const Matrix<T, Alloc>& lhs, const Matrix<T, Alloc>& rhs)
+{
+	if (MatrixSettings<T>::strassen || MatrixSettings<T>::gaussMultiply)
+	{
+		return lhs * rhs.trans();
+	}
+
+	const unsigned int n = lhs.nCols;
+	const unsigned int m = rhs.nRows;
+	return _generateRows(lhs.nRows, m, (unsigned long) n * m, VIEW_MULT_BLOCK,
+						 [&](unsigned int first, unsigned int last, T* out, std::size_t stride)
+	{
+		unsigned int i0, i, j, k;
+		for (i0 = first; i0 < last; i0 += VIEW_MULT_BLOCK)
+		{
+			const unsigned int iEnd = std::min<unsigned int>(i0 + VIEW_MULT_BLOCK, last);
+			for (j = 0; j < m; ++j)
+			{
+				const T* rhsRow = &rhs.matrix[rhs._getIndex(j, 0)];
+				for (i = i0; i < iEnd; ++i)
+				{
+					const T* lhsRow = &lhs.matrix[lhs._getIndex(i, 0)];
+					T sum = 0;
+					for (k = 0; k < n; ++k)
+					{
+						sum = sum + (lhsRow[k] * _transElement(rhsRow[k]));
+					}
+					out[(i - first) * stride + j] = sum;
+				}
+			}
+		}
+	});
+}
+
+/**
+ * @brief multiplies two square matrices of the same size with Strassen-Winograd
+ * the operands are split into 2x2 blocks of half size (rounded up, zero padded) and
+ * the 7 block products recurse until the cutoff size
+ * @param lhs the left operand
+ * @param rhs the right operand
+ * @return A matrix that equals (lhs * rhs)
+ */
+template <typename T, typename Alloc>
+Matrix<T, Alloc> Matrix<T, Alloc>::_multiplyStrassen(const Matrix<T, Alloc>& lhs, const Matrix<T, Alloc>& rhs)
+{
+	const unsigned int n = lhs.nRows;
+	if (n <= MatrixSettings<T>::strassenCutoff || n <= 1)
+	{
+		return lhs._multiply(rhs);
+	}
+	const unsigned int h = (n + 1) / 2;
+
+	Matrix<T, Alloc> a11 = lhs._block(0, 0, h), a12 = lhs._block(0, h, h);
+	Matrix<T, Alloc> a21 = lhs._block(h, 0, h), a22 = lhs._block(h, h, h);
+	Matrix<T, Alloc> b11 = rhs._block(0, 0, h), b12 = rhs._block(0, h, h);
+	Matrix<T, Alloc> b21 = rhs._block(h, 0, h), b22 = rhs._block(h, h, h);
+
+	Matrix<T, Alloc> s1 = a21 + a22;
+	Matrix<T, Alloc> s2 = s1 - a11;
+	Matrix<T, Alloc> s3 = a11 - a21;
+	Matrix<T, Alloc> s4 = a12 - s2;
+	Matrix<T, Alloc> t1 = b12 - b11;
+	Matrix<T, Alloc> t2 = b22 - t1;
+	Matrix<T, Alloc> t3 = b22 - b12;
+	Matrix<T, Alloc> t4 = t2 - b21;
+
+	// the 7 products are independent, in parallel mode they are forked on the thread pool
+	const Matrix<T, Alloc>* lhsBlocks[] = {&a11, &a12, &s4, &a22, &s1, &s2, &s3};
+	const Matrix<T, Alloc>* rhsBlocks[] = {&b11, &b21, &b22, &t4, &t1, &t2, &t3};
+	Matrix<T, Alloc> products[7];
+	_forEachRowBlock(7, (unsigned long) h * h, [&](unsigned int first, unsigned int last)
+	{
+		MATRIX_INSTRUMENT_NESTED();
+		unsigned int p;
+		for (p = first; p < last; ++p)
+		{
+			products[p] = _multiplyStrassen(*lhsBlocks[p], *rhsBlocks[p]);
+		}
+	});
+	const Matrix<T, Alloc>& m1 = products[0], & m2 = products[1], & m3 = products[2], & m4 = products[3];
+	const Matrix<T, Alloc>& m5 = products[4], & m6 = products[5], & m7 = products[6];
+
+	Matrix<T, Alloc> u2 = m1 + m6;
+	Matrix<T, Alloc> u3 = u2 + m7;
+
+	const Matrix<T, Alloc> c11 = m1 + m2, c12 = u2 + m5 + m3, c21 = u3 - m4, c22 = u3 + m5;
+
+	// every result row is the row of a left block followed by the row of a right block, the
+	// padding rows and columns of the blocks are dropped
+	return _generateRows(n, n, n, 1, [&](unsigned int first, unsigned int last, T* out, std::size_t stride)
+	{
+		unsigned int i;
+		for (i = first; i < last; ++i, out += stride)
+		{
+			const Matrix<T, Alloc>& left = i < h ? c11 : c21;
+			const Matrix<T, Alloc>& right = i < h ? c12 : c22;
+			const unsigned int row = i < h ? i : i - h;
+			const T* leftRow = &left.matrix[left._getIndex(row, 0)];
+			const T* rightRow = &right.matrix[right._getIndex(row, 0)];
+			std::copy(rightRow, rightRow + (n - h), std::copy(leftRow, leftRow + h, out));
+		}
+	});
+}
+
+/**
+ * @brief returns the size x size block of this matrix starting at (row, col)
+ * elements outside the matrix are zero
+ * @param row the first row of the block
+ * @param col the first column of the block
+ * @param size the block size
+ * @return the block
+ */
+template <typename T, typename Alloc>
+Matrix<T, Alloc> Matrix<T, Alloc>::_block(unsigned int row, unsigned int col, unsigned int size) const
+{
+	Matrix<T, Alloc> block(0, 0);
+	block.nRows = size;
+	block.nCols = size;
+	block.nStride = MatrixLayout<Alloc>::stride(size);
+	block.matrix.reserve((std::size_t) size * block.nStride);
+	MATRIX_INSTRUMENT_ALLOC(block.matrix.capacity() * sizeof(T));
+	unsigned int rowEnd = std::min<unsigned int>(row + size, nRows);
+	unsigned int colEnd = std::min<unsigned int>(col + size, nCols);
+	unsigned int i;
+	for (i = row; i < rowEnd; ++i)
+	{
+		block._append(&matrix[_getIndex(i, col)], colEnd - col, block.nStride - (colEnd - col));
+	}
+	// the rows below the matrix
+	block.matrix.resize((std::size_t) size * block.nStride);
+	return block;
+}
+
+/**
+ * @brief multiplies this with rhs using the iterative algorithm
+ * @param rhs the matrix to multiply with this
+ * @return A matrix that equals (this * rhs)
+ */
+template <typename T, typename Alloc>
+Matrix<T, Alloc> Matrix<T, Alloc>::_multiplyClassic(const Matrix<T, Alloc>& rhs) const
+{
+	return _generateRows(nRows, rhs.nCols, (unsigned long) nCols * rhs.nCols, 1,
+						 [&](unsigned int first, unsigned int last, T* out, std::size_t stride)
+	{
+		unsigned int i, j, k;
+		for (i = first; i < last; ++i, out += stride)
+		{
+			for (j = 0; j < rhs.nCols; ++j)
+			{
+				T sum = 0;
+				for (k = 0; k < nCols; ++k)
+				{
+					sum = sum + (matrix[_getIndex(i, k)] * rhs.matrix[rhs._getIndex(k, j)]);
+				}
+				out[j] = sum;
+			}
+		}
+	});
 }
 
+/**
+ * @brief packs the given right operand of the blocked kernel panel by panel: the panel of rows
+ * [k0, k0 + MULT_BLOCK_K) holds every rhs column as a contiguous run of its elements in those rows
+ * @param rhs the right operand
+ * @return the packed operand
+ */
+template <typename T, typename Alloc>
+std::vector<T, Alloc> Matrix<T, Alloc>::_pack(const Matrix<T, Alloc>& rhs)
+{
+	const unsigned int n = rhs.nRows;
+	const unsigned int m = rhs.nCols;
+	std::vector<T, Alloc> packed((unsigned long) n * m);
+
+	// pack rhs, rows of the same panel are written by the same block
+	_forEachRowBlock(n, m, [&](unsigned int first, unsigned int last)
+	{
+		unsigned int k, j;
+		for (k = first; k < last; ++k)
+		{
+			unsigned int k0 = k - k % MULT_BLOCK_K;
+			unsigned int kb = std::min<unsigned int>(MULT_BLOCK_K, n - k0);
+			T* panel = &packed[(unsigned long) k0 * m] + (k - k0);
+			const T* rhsRow = &rhs.matrix[rhs._getIndex(k, 0)];
+			for (j = 0; j < m; ++j)
+			{
+				panel[(unsigned long) j * kb] = rhsRow[j];
+			}
+		}
+	});
+	return packed;
+}
 
 /**
- * @brief Assigns the content of the given matrix
- * @param rhs matrix whose values to assign
- * @return *this
+ * @brief multiplies this with a right operand packed by _pack using the cache blocked kernel
+ * The result is accumulated a panel at a time in increasing k order, so every element sums its
+ * products in the same order as _multiplyClassic.
+ * @param packed the packed right operand, with cols() rows
+ * @param m the number of columns of the right operand
+ * @param result a zero matrix of size rows() x m to store the product in
  */
-template <typename T>
-Matrix<T>& Matrix<T>::operator=(const Matrix<T>& rhs)
+template <typename T, typename Alloc>
+void Matrix<T, Alloc>::_multiplyPacked(const std::vector<T, Alloc>& packed, unsigned int m,
+									   Matrix<T, Alloc>& result) const
 {
-	matrix = rhs.matrix;
-	nCols = rhs.nCols;
-	nRows = rhs.nRows;
-
-	return *this;
+	const unsigned int n = nCols;
+	_forEachRowBlock(nRows, (unsigned long) n * m, [&](unsigned int first, unsigned int last)
+	{
+		unsigned int k0, i0, j0, i, j, k;
+		for (k0 = 0; k0 < n; k0 += MULT_BLOCK_K)
+		{
+			const unsigned int kb = std::min<unsigned int>(MULT_BLOCK_K, n - k0);
+			const T* panel = &packed[(unsigned long) k0 * m];
+			for (i0 = first; i0 < last; i0 += MULT_BLOCK_I)
+			{
+				const unsigned int iEnd = std::min<unsigned int>(i0 + MULT_BLOCK_I, last);
+				for (j0 = 0; j0 < m; j0 += MULT_BLOCK_J)
+				{
+					const unsigned int jEnd = std::min<unsigned int>(j0 + MULT_BLOCK_J, m);
+					for (i = i0; i < iEnd; ++i)
+					{
+						const T* lhsRow = &matrix[_getIndex(i, k0)];
+						T* resultRow = &result.matrix[result._getIndex(i, 0)];
+						for (j = j0; j < jEnd; ++j)
+						{
+							const T* rhsCol = panel + (unsigned long) j * kb;
+							T sum = resultRow[j];
+							for (k = 0; k < kb; ++k)
+							{
+								sum = sum + (lhsRow[k] * rhsCol[k]);
+							}
+							resultRow[j] = sum;
+						}
+					}
+				}
+			}
+		}
+	});
 }
 
 /**
- * @brief Binary addition operator
- * @param rhs the matrix to add to this
- * @return A matrix that equals (this + rhs)
+ * @brief Addition assignment operator, adds rhs to this in place
+ * @param rhs the matrix or expression to add to this
+ * @return *this
  */
-template <typename T>
-Matrix<T> Matrix<T>::operator+(const Matrix<T>& rhs) const
+template <typename T, typename Alloc>
+template <typename E>
+Matrix<T, Alloc>& Matrix<T, Alloc>::operator+=(const MatrixExpression<E>& rhs)
 {
 	// throw an exception if matrices dimensions differ
-	if (rows() != rhs.rows() || cols() != rhs.cols())
+	if (rows() != rhs.self().rows() || cols() != rhs.self().cols())
 	{
 		throw std::invalid_argument(ADDITION_EXCEPTION_MSG);
 	}
-
-	Matrix<T>::const_iterator rhsBegin = rhs.begin();
-	Matrix<T>::const_iterator rhsEnd = rhs.end();
-	Matrix<T>::const_iterator thisBegin = begin();
-
-	std::vector<T> newMatrixVec(cols() * rows());
-
-	int i;
-	for (i = 0; rhsBegin != rhsEnd; ++rhsBegin, ++thisBegin, ++i)
-	{
-		newMatrixVec[i] = *thisBegin + *rhsBegin;
-	}
-
-	Matrix<T> newMatrix(nRows, nCols, newMatrixVec);
-	return newMatrix;
+	MATRIX_INSTRUMENT_SCOPE(PLUS, nRows, 0, nCols);
+	_assign(MatrixBinaryExpression<PlusOp, Matrix<T, Alloc>, E>(*this, rhs.self()));
+	return *this;
 }
 
 /**
- * @brief Binary subtraction operator
- * @param rhs the matrix to subtract from this
- * @return A matrix that equals (this - rhs)
+ * @brief Subtraction assignment operator, subtracts rhs from this in place
+ * @param rhs the matrix or expression to subtract from this
+ * @return *this
  */
-template <typename T>
-Matrix<T> Matrix<T>::operator-(const Matrix<T>& rhs) const
+template <typename T, typename Alloc>
+template <typename E>
+Matrix<T, Alloc>& Matrix<T, Alloc>::operator-=(const MatrixExpression<E>& rhs)
 {
 	// throw an exception if matrices dimensions differ
-	if (cols() != rhs.rows() || cols() != rhs.cols())
+	if (rows() != rhs.self().rows() || cols() != rhs.self().cols())
 	{
 		throw std::invalid_argument(SUBTRACTION_EXCEPTION_MSG);
 	}
-	const_iterator rhsBegin = rhs.begin();
-	const_iterator rhsEnd = rhs.end();
-	const_iterator thisBegin = begin();
-
-	std::vector<T> newMatrixVec(nCols * nRows);
-
-	int i;
-	for (i = 0; rhsBegin != rhsEnd; ++rhsBegin, ++thisBegin, ++i)
-	{
-		newMatrixVec[i] = *thisBegin - *rhsBegin;
-	}
-
-	Matrix<T> newMatrix(nRows, nCols, newMatrixVec);
-	return newMatrix;
+	MATRIX_INSTRUMENT_SCOPE(MINUS, nRows, 0, nCols);
+	_assign(MatrixBinaryExpression<MinusOp, Matrix<T, Alloc>, E>(*this, rhs.self()));
+	return *this;
 }
 
 /**
- * @brief Matrix multiplication operator
- * Using the iterative algorithm
+ * @brief Multiplication assignment operator, replaces this with (this * rhs)
+ * the product can't be computed in place, its storage replaces the storage of this
  * @param rhs the matrix to multiply with this
- * @return A matrix that equals (this * rhs)
+ * @return *this
  */
-template <typename T>
-Matrix<T> Matrix<T>::operator*(const Matrix<T>& rhs) const
+template <typename T, typename Alloc>
+Matrix<T, Alloc>& Matrix<T, Alloc>::operator*=(const Matrix<T, Alloc>& rhs)
 {
-	Matrix<T> result(nRows, rhs.nCols);
-	if (cols() != rhs.rows())
-	{
-		throw std::invalid_argument(MULTIPLICATION_EXCEPTION_MSG);
-	}
-	unsigned int i, j, k;
-	for (i = 0; i < nRows; ++i)
-	{
-		for (j = 0; j < rhs.nCols; ++j)
-		{
-			T sum = 0;
-			for (k = 0; k < nCols; ++k)
-			{
-				sum = sum + ((*this)(i, k) * rhs(k, j));
-			}
-			result(i, j) = sum;
-		}
-	}
-	return result;
+	*this = *this * rhs;
+	return *this;
 }
 
 /**
@@ -428,26 +1671,26 @@ Matrix<T> Matrix<T>::operator*(const Matrix<T>& rhs) const
  * @param rhs the matrix to compare its content to this matrix
  * @return true if all the elements are equal, otherwise false
  */
-template <typename T>
-bool Matrix<T>::operator==(const Matrix<T>& rhs) const
+template <typename T, typename Alloc>
+bool Matrix<T, Alloc>::operator==(const Matrix<T, Alloc>& rhs) const
 {
 	if (nCols != rhs.nCols || nRows != rhs.nRows)
 	{
 		return false;
 	}
 
-	const_iterator thisBegin = this->begin();
-	const_iterator thisEnd = this->end();
-	const_iterator rhsBegin = rhs.begin();
-
-	for (; thisBegin != thisEnd; ++thisBegin, ++rhsBegin)
+	if (nStride == nCols)
 	{
-		if (*thisBegin != *rhsBegin)
+		return ElementKernels<T>::equal(matrix.data(), rhs.matrix.data(), matrix.size());
+	}
+	unsigned int i;
+	for (i = 0; i < nRows; ++i)
+	{
+		if (!ElementKernels<T>::equal(&matrix[_getIndex(i, 0)], &rhs.matrix[rhs._getIndex(i, 0)], nCols))
 		{
 			return false;
 		}
 	}
-
 	return true;
 }
 
@@ -456,8 +1699,8 @@ bool Matrix<T>::operator==(const Matrix<T>& rhs) const
  * @param rhs the matrix to compare its content to this matrix
  * @return false if all the elements are equal, otherwise true
  */
-template <typename T>
-bool Matrix<T>::operator!=(const Matrix<T>& rhs) const
+template <typename T, typename Alloc>
+bool Matrix<T, Alloc>::operator!=(const Matrix<T, Alloc>& rhs) const
 {
 	return !(*this == rhs);
 }
@@ -466,72 +1709,215 @@ bool Matrix<T>::operator!=(const Matrix<T>& rhs) const
  * @brief returns the a transpose matrix of this matrix
  * @return transpose matrix
  */
-template <typename T>
-Matrix<T> Matrix<T>::trans() const
+template <typename T, typename Alloc>
+Matrix<T, Alloc> Matrix<T, Alloc>::trans() const
+{
+	MATRIX_INSTRUMENT_SCOPE(TRANS, nCols, 0, nRows);
+	Matrix<T, Alloc> transMatrix(nCols, nRows);
+	transMatrix._assign(transView());
+	return transMatrix;
+}
+
+/**
+ * @brief evaluates the given transposed view into the matrix storage with the tiled transpose
+ * the view should have the size of this matrix, a view of this matrix is transposed in place
+ * @param view the view to evaluate
+ */
+template <typename T, typename Alloc>
+void Matrix<T, Alloc>::_assign(const MatrixTransView<T, Alloc>& view)
+{
+	const Matrix<T, Alloc>& source = view.matrix();
+	if (&source == this)
+	{
+		transInPlace();
+		return;
+	}
+
+	source._transBlock(matrix.data(), nStride, 0, source.nRows, 0, source.nCols);
+}
+
+/**
+ * @brief transposes this square matrix in place, without allocating a second matrix
+ * over the complex field the matrix is conjugate transposed, like trans()
+ * @throw std::logic_error if the matrix isn't square
+ */
+template <typename T, typename Alloc>
+void Matrix<T, Alloc>::transInPlace()
 {
 	if (cols() != rows())
 	{
 		throw std::logic_error(TRANSPOSE_EXCEPTION_MSG);
 	}
+	_transDiagonal(0, nRows);
+}
 
-	unsigned int i, j;
-	Matrix<T> transMatrix(nRows, nCols);
-
-	for (i = 0; i < nRows; ++i)
+/**
+ * @brief writes the transpose of the given source tile into dst, a cols() x rows() matrix
+ * @param dst the transpose matrix storage
+ * @param rowFirst the first source row of the tile
+ * @param rowLast the row following the last source row of the tile
+ * @param colFirst the first source column of the tile
+ * @param colLast the column following the last source column of the tile
+ */
+template <typename T, typename Alloc>
+void Matrix<T, Alloc>::_transBlock(T* dst, std::size_t dstStride, unsigned int rowFirst, unsigned int rowLast,
+								   unsigned int colFirst, unsigned int colLast) const
+{
+	unsigned int nTileRows = rowLast - rowFirst, nTileCols = colLast - colFirst;
+	if (nTileRows > TRANS_BLOCK || nTileCols > TRANS_BLOCK)
 	{
-		for (j = 0; j < nCols; ++j)
+		const unsigned long elements = (unsigned long) nTileRows * nTileCols;
+		if (nTileRows >= nTileCols)
+		{
+			unsigned int mid = rowFirst + nTileRows / 2;
+			_forkJoin(elements, [&] { _transBlock(dst, dstStride, rowFirst, mid, colFirst, colLast); },
+					  [&] { _transBlock(dst, dstStride, mid, rowLast, colFirst, colLast); });
+		}
+		else
 		{
-			transMatrix(j, i) = (*this)(i, j);
+			unsigned int mid = colFirst + nTileCols / 2;
+			_forkJoin(elements, [&] { _transBlock(dst, dstStride, rowFirst, rowLast, colFirst, mid); },
+					  [&] { _transBlock(dst, dstStride, rowFirst, rowLast, mid, colLast); });
 		}
+		return;
 	}
 
-	return transMatrix;
+	unsigned int i, j;
+	for (i = rowFirst; i < rowLast; ++i)
+	{
+		for (j = colFirst; j < colLast; ++j)
+		{
+			dst[j * dstStride + i] = _transElement(matrix[_getIndex(i, j)]);
+		}
+	}
 }
 
 /**
- * @brief specialized transpose method for matrices over the complex field
- * Conjugate transpose
- * @return the transposed matrix
+ * @brief transposes the square diagonal tile [first, last) x [first, last) in place
+ * @param first the first row and column of the tile
+ * @param last the row and column following the tile
  */
-template <>
-Matrix<Complex> Matrix<Complex>::trans() const
+template <typename T, typename Alloc>
+void Matrix<T, Alloc>::_transDiagonal(unsigned int first, unsigned int last)
 {
-	if (cols() != rows())
+	if (last - first > TRANS_BLOCK)
 	{
-		throw std::logic_error(TRANSPOSE_EXCEPTION_MSG);
+		unsigned int mid = first + (last - first) / 2;
+		const unsigned long elements = (unsigned long) (last - first) * (last - first);
+		_forkJoin(elements, [&]
+		{
+			_forkJoin(elements / 2, [&] { _transDiagonal(first, mid); }, [&] { _transDiagonal(mid, last); });
+		}, [&] { _swapTransBlock(first, mid, mid, last); });
+		return;
 	}
 
 	unsigned int i, j;
-	Matrix<Complex> transMatrix(nRows, nCols);
+	for (i = first; i < last; ++i)
+	{
+		matrix[_getIndex(i, i)] = _transElement(matrix[_getIndex(i, i)]);
+		for (j = i + 1; j < last; ++j)
+		{
+			T upper = _transElement(matrix[_getIndex(i, j)]);
+			matrix[_getIndex(i, j)] = _transElement(matrix[_getIndex(j, i)]);
+			matrix[_getIndex(j, i)] = upper;
+		}
+	}
+}
 
-	for (i = 0; i < nRows; ++i)
+/**
+ * @brief swaps the tile [rowFirst, rowLast) x [colFirst, colLast) with its mirror tile
+ * across the diagonal, transposing both, the tile should be above the diagonal
+ * @param rowFirst the first row of the tile
+ * @param rowLast the row following the last row of the tile
+ * @param colFirst the first column of the tile
+ * @param colLast the column following the last column of the tile
+ */
+template <typename T, typename Alloc>
+void Matrix<T, Alloc>::_swapTransBlock(unsigned int rowFirst, unsigned int rowLast,
+								unsigned int colFirst, unsigned int colLast)
+{
+	unsigned int nTileRows = rowLast - rowFirst, nTileCols = colLast - colFirst;
+	if (nTileRows > TRANS_BLOCK || nTileCols > TRANS_BLOCK)
 	{
-		for (j = 0; j < nCols; ++j)
+		const unsigned long elements = 2UL * nTileRows * nTileCols;
+		if (nTileRows >= nTileCols)
+		{
+			unsigned int mid = rowFirst + nTileRows / 2;
+			_forkJoin(elements, [&] { _swapTransBlock(rowFirst, mid, colFirst, colLast); },
+					  [&] { _swapTransBlock(mid, rowLast, colFirst, colLast); });
+		}
+		else
 		{
-			transMatrix(j, i) = matrix[_getIndex(i, j)].conj();
+			unsigned int mid = colFirst + nTileCols / 2;
+			_forkJoin(elements, [&] { _swapTransBlock(rowFirst, rowLast, colFirst, mid); },
+					  [&] { _swapTransBlock(rowFirst, rowLast, mid, colLast); });
 		}
+		return;
 	}
 
-	return transMatrix;
+	unsigned int i, j;
+	for (i = rowFirst; i < rowLast; ++i)
+	{
+		for (j = colFirst; j < colLast; ++j)
+		{
+			T upper = _transElement(matrix[_getIndex(i, j)]);
+			matrix[_getIndex(i, j)] = _transElement(matrix[_getIndex(j, i)]);
+			matrix[_getIndex(j, i)] = upper;
+		}
+	}
+}
+
+/**
+ * @brief appends the text operator<< outputs for the matrix on a stream with default formatting
+ * and the given precision to out, without going through a stream
+ * @param matrix the matrix to format
+ * @param out the text to append to
+ * @param precision the floating point precision, 6 by default like a stream
+ */
+template <typename T, typename Alloc>
+void formatMatrixText(const Matrix<T, Alloc>& matrix, std::string& out, int precision = 6)
+{
+	typename Matrix<T, Alloc>::const_iterator element = matrix.begin();
+	unsigned int i, j;
+	out.reserve(out.size() + (std::size_t) matrix.rows() * matrix.cols() * 8);
+	for (i = 0; i < matrix.rows(); ++i)
+	{
+		for (j = 0; j < matrix.cols(); ++j, ++element)
+		{
+			_appendText(out, *element, precision);
+			out += TAB_CHAR;
+		}
+		out += NEWLINE_CHAR;
+	}
 }
 
 /**
  * @brief output operator
  * outputs each matrix element seperated by a tab and every row seperated by a new line
+ * when the stream formatting is at its defaults (except for the precision), the matrix is
+ * formatted into a single buffer by formatMatrixText and written at once
  * @param os output stream
  * @param matrix the matrix to output
  * @return output stream
  */
-template <typename T>
-std::ostream& operator<<(std::ostream& os, const Matrix<T>& matrix)
+template <typename T, typename Alloc>
+std::ostream& operator<<(std::ostream& os, const Matrix<T, Alloc>& matrix)
 {
+	if (os.flags() == (std::ios_base::dec | std::ios_base::skipws) && os.width() == 0 && os.precision() >= 0 &&
+		os.getloc() == std::locale::classic())
+	{
+		std::string text;
+		formatMatrixText(matrix, text, (int) os.precision());
+		return os.write(text.data(), (std::streamsize) text.size());
+	}
+
 	unsigned int i, j;
 	/** iterate over matrix elements */
 	for (i = 0; i < matrix.rows(); ++i)
 	{
 		for (j = 0; j < matrix.cols(); ++j)
 		{
-			os << matrix(i, j) << TAB_CHAR;
+			os << matrix.unchecked(i, j) << TAB_CHAR;
 		}
 		os << NEWLINE_CHAR;
 	}
@@ -544,15 +1930,10 @@ std::ostream& operator<<(std::ostream& os, const Matrix<T>& matrix)
  * @param col the column number
  * @return the element in the given row and column number
  */
-template <typename T>
-const T& Matrix<T>::operator()(unsigned int row, unsigned int col) const
+template <typename T, typename Alloc>
+const T& Matrix<T, Alloc>::operator()(unsigned int row, unsigned int col) const
 {
-	if (row >= nRows || row < MIN_MATRIX_INDEX || col >= nCols || col < MIN_MATRIX_INDEX)
-	{
-		throw std::out_of_range(OUT_OF_RANGE_MSG);
-	}
-
-	/* matrix indexes start at 1, but vector indexes start at 0 */
+	_checkRange(row, col);
 	return matrix[_getIndex(row, col)];
 }
 
@@ -562,16 +1943,10 @@ const T& Matrix<T>::operator()(unsigned int row, unsigned int col) const
  * @param col the column number
  * @return the element in the given row and column number
  */
-template <typename T>
-T& Matrix<T>::operator()(unsigned int row, unsigned int col)
+template <typename T, typename Alloc>
+T& Matrix<T, Alloc>::operator()(unsigned int row, unsigned int col)
 {
-	// TODO: maybe make a single function for const and non const
-	if (row >= nRows || row < MIN_MATRIX_INDEX || col >= nCols || col < MIN_MATRIX_INDEX)
-	{
-		throw std::out_of_range(OUT_OF_RANGE_MSG);
-	}
-
-	/* matrix indexes start at 1, but vector indexes start at 0 */
+	_checkRange(row, col);
 	return matrix[_getIndex(row, col)];
 }
 
@@ -580,8 +1955,8 @@ T& Matrix<T>::operator()(unsigned int row, unsigned int col)
  * @brief returns the number of columns in the matrix
  * @return the number of columns in the matrix
  */
-template <typename T>
-unsigned int Matrix<T>::cols() const
+template <typename T, typename Alloc>
+unsigned int Matrix<T, Alloc>::cols() const
 {
 	return nCols;
 }
@@ -590,43 +1965,223 @@ unsigned int Matrix<T>::cols() const
  * @brief returns the number of rows in the matrix
  * @return the number of rows in the matrix
  */
-template <typename T>
-unsigned int Matrix<T>::rows() const
+template <typename T, typename Alloc>
+unsigned int Matrix<T, Alloc>::rows() const
 {
 	return nRows;
 }
 
+//-------------------------- Expression operators ---------------------------
+
+/**
+ * @brief Binary addition operator
+ * the sum is evaluated when the expression is assigned to a matrix
+ * @param lhs the left operand
+ * @param rhs the right operand
+ * @return an expression that equals (lhs + rhs)
+ */
+template <typename L, typename R>
+typename EnableIfExpressions<L, R, MatrixBinaryExpression<PlusOp, L, R>>::type
+operator+(const L& lhs, const R& rhs)
+{
+	// throw an exception if matrices dimensions differ
+	if (lhs.rows() != rhs.rows() || lhs.cols() != rhs.cols())
+	{
+		throw std::invalid_argument(ADDITION_EXCEPTION_MSG);
+	}
+	MATRIX_INSTRUMENT_SCOPE(PLUS, lhs.rows(), 0, lhs.cols());
+	return MatrixBinaryExpression<PlusOp, L, R>(lhs, rhs);
+}
+
+/**
+ * @brief Binary subtraction operator
+ * the difference is evaluated when the expression is assigned to a matrix
+ * @param lhs the left operand
+ * @param rhs the right operand
+ * @return an expression that equals (lhs - rhs)
+ */
+template <typename L, typename R>
+typename EnableIfExpressions<L, R, MatrixBinaryExpression<MinusOp, L, R>>::type
+operator-(const L& lhs, const R& rhs)
+{
+	// throw an exception if matrices dimensions differ
+	if (lhs.rows() != rhs.rows() || lhs.cols() != rhs.cols())
+	{
+		throw std::invalid_argument(SUBTRACTION_EXCEPTION_MSG);
+	}
+	MATRIX_INSTRUMENT_SCOPE(MINUS, lhs.rows(), 0, lhs.cols());
+	return MatrixBinaryExpression<MinusOp, L, R>(lhs, rhs);
+}
+
+/**
+ * @brief returns the given matrix
+ * @param matrix a matrix of type M
+ * @return the matrix itself
+ */
+template <typename M>
+const M& evaluate(const M& matrix)
+{
+	return matrix;
+}
+
+/**
+ * @brief evaluates the given expression into a new matrix of type M
+ * @param expr the expression to evaluate, a matrix of another allocator is copied
+ * @return the value of the expression
+ */
+template <typename M, typename E>
+M evaluate(const MatrixExpression<E>& expr)
+{
+	return M(expr);
+}
+
+/**
+ * @brief Matrix multiplication operator for expressions
+ * operands that aren't matrices are evaluated once before multiplying
+ * @param lhs the left operand
+ * @param rhs the right operand
+ * @return A matrix that equals (lhs * rhs)
+ */
+template <typename L, typename R>
+typename ExpressionResult<typename EnableIfExpressions<L, R, L>::type>::type
+operator*(const L& lhs, const R& rhs)
+{
+	typedef typename ExpressionResult<L>::type Result;
+	MATRIX_INSTRUMENT_SCOPE(MULTIPLY, lhs.rows(), lhs.cols(), rhs.cols());
+	return evaluate<Result>(lhs) * evaluate<Result>(rhs);
+}
+
+/**
+ * @brief multiplies a transposed view with a matrix without forming the transpose
+ * @param lhs the transposed view
+ * @param rhs the matrix to multiply with the view
+ * @return A matrix that equals (lhs * rhs)
+ */
+template <typename T, typename Alloc>
+Matrix<T, Alloc> operator*(const MatrixTransView<T, Alloc>& lhs, const Matrix<T, Alloc>& rhs)
+{
+	if (lhs.cols() != rhs.rows())
+	{
+		throw std::invalid_argument(MULTIPLICATION_EXCEPTION_MSG);
+	}
+	MATRIX_INSTRUMENT_SCOPE(MULTIPLY, lhs.rows(), lhs.cols(), rhs.cols());
+	return Matrix<T, Alloc>::_multiplyTransLhs(lhs.matrix(), rhs);
+}
+
+/**
+ * @brief multiplies a matrix with a transposed view without forming the transpose
+ * @param lhs the matrix to multiply with the view
+ * @param rhs the transposed view
+ * @return A matrix that equals (lhs * rhs)
+ */
+template <typename T, typename Alloc>
+Matrix<T, Alloc> operator*(const Matrix<T, Alloc>& lhs, const MatrixTransView<T, Alloc>& rhs)
+{
+	if (lhs.cols() != rhs.rows())
+	{
+		throw std::invalid_argument(MULTIPLICATION_EXCEPTION_MSG);
+	}
+	MATRIX_INSTRUMENT_SCOPE(MULTIPLY, lhs.rows(), lhs.cols(), rhs.cols());
+	return Matrix<T, Alloc>::_multiplyTransRhs(lhs, rhs.matrix());
+}
+
+/**
+ * @brief compares the values of two expressions
+ * @param lhs the left operand
+ * @param rhs the right operand
+ * @return true if all the elements are equal, otherwise false
+ */
+template <typename L, typename R>
+typename EnableIfExpressions<L, R, bool>::type
+operator==(const L& lhs, const R& rhs)
+{
+	typedef typename ExpressionResult<L>::type Result;
+	return evaluate<Result>(lhs) == evaluate<Result>(rhs);
+}
+
+/**
+ * @brief compares the values of two expressions
+ * @param lhs the left operand
+ * @param rhs the right operand
+ * @return false if all the elements are equal, otherwise true
+ */
+template <typename L, typename R>
+typename EnableIfExpressions<L, R, bool>::type
+operator!=(const L& lhs, const R& rhs)
+{
+	typedef typename ExpressionResult<L>::type Result;
+	return !(evaluate<Result>(lhs) == evaluate<Result>(rhs));
+}
+
+/**
+ * @brief output operator for expressions, outputs the value of the expression
+ * @param os output stream
+ * @param expr the expression to output
+ * @return output stream
+ */
+template <typename E>
+std::ostream& operator<<(std::ostream& os, const MatrixExpression<E>& expr)
+{
+	return os << evaluate<typename ExpressionResult<E>::type>(expr);
+}
+
 //-------------------------- Iterator class implementation ---------------------------
 
 /**
  * @brief bidirectional const iterator class
+ * walks the elements row by row, skipping the padding after every row of a padded matrix
  */
-template<class T>
-class Matrix<T>::BidiConstIterator
+template <class T, class Alloc>
+class Matrix<T, Alloc>::BidiConstIterator
 {
 	/**
 	 * @brief pointer to the element
 	 */
 	const T* _ptr;
 
+	/**
+	 * @brief the column of the element, only kept when the rows are padded
+	 */
+	unsigned int _col;
+
+	/**
+	 * @brief the number of columns
+	 */
+	unsigned int _cols;
+
+	/**
+	 * @brief the number of padding elements after every row, 0 if the rows aren't padded
+	 */
+	unsigned int _pad;
+
 public:
 
 	/**
 	 * @brief default constructor
 	 * initialized the pointer to nullptr
 	 */
-	BidiConstIterator() : _ptr(nullptr) {};
+	BidiConstIterator() : _ptr(nullptr), _col(0), _cols(0), _pad(0) {};
 	/**
 	 * @brief Bidirectional iterator constructor
 	 * @param ptr the element the iterator should point to
 	 */
-	BidiConstIterator(const T* ptr) : _ptr(ptr) {};
+	BidiConstIterator(const T* ptr) : _ptr(ptr), _col(0), _cols(0), _pad(0) {};
+
+	/**
+	 * @brief Bidirectional iterator constructor over the padded rows of a matrix
+	 * @param ptr the first element of a row the iterator should point to
+	 * @param cols the number of columns
+	 * @param stride the number of elements between the starts of two consecutive rows
+	 */
+	BidiConstIterator(const T* ptr, unsigned int cols, unsigned int stride) : _ptr(ptr), _col(0), _cols(cols),
+																			 _pad(stride - cols) {};
 
 	/**
 	 * @brief Iterator constructor
 	 * @param iterator to copy
 	 */
-	BidiConstIterator(const BidiConstIterator& other) : _ptr(other._ptr) {};
+	BidiConstIterator(const BidiConstIterator& other) : _ptr(other._ptr), _col(other._col), _cols(other._cols),
+														_pad(other._pad) {};
 
 	/**
 	 * @brief Destructor
@@ -641,6 +2196,9 @@ public:
 	BidiConstIterator& operator=(const BidiConstIterator& rhs)
 	{
 		_ptr = rhs._ptr;
+		_col = rhs._col;
+		_cols = rhs._cols;
+		_pad = rhs._pad;
 		return *this;
 	}
 
@@ -688,7 +2246,8 @@ public:
 	 */
 	const T& operator++()
 	{
-		return *(++_ptr);
+		_next();
+		return *_ptr;
 	}
 
 	/**
@@ -697,7 +2256,8 @@ public:
 	 */
 	const T& operator++(int i)
 	{
-		const T* tmp = _ptr++;
+		const T* tmp = _ptr;
+		_next();
 		return *tmp;
 	}
 
@@ -707,7 +2267,8 @@ public:
 	 */
 	const T& operator--()
 	{
-		return *(--_ptr);
+		_previous();
+		return *_ptr;
 	}
 
 	/**
@@ -716,9 +2277,100 @@ public:
 	 */
 	const T& operator--(int i)
 	{
-		const T* tmp = _ptr--;
+		const T* tmp = _ptr;
+		_previous();
 		return *tmp;
 	}
+
+private:
+
+	/**
+	 * @brief moves to the next element, over the padding at the end of a row
+	 */
+	void _next()
+	{
+		++_ptr;
+		if (_pad != 0 && ++_col == _cols)
+		{
+			_col = 0;
+			_ptr += _pad;
+		}
+	}
+
+	/**
+	 * @brief moves to the previous element, over the padding at the end of the previous row
+	 */
+	void _previous()
+	{
+		if (_pad != 0)
+		{
+			if (_col == 0)
+			{
+				_col = _cols;
+				_ptr -= _pad;
+			}
+			--_col;
+		}
+		--_ptr;
+	}
 };
 
+//-------------------------- Complex field specializations ---------------------------
+
+/**
+ * @brief multiplication for matrices over the complex field
+ * Multiplies the real and imaginary planes with 3 real matrix products (Gauss / Karatsuba),
+ * the real products use the double kernels, including Strassen-Winograd when it's enabled
+ * for Matrix<double>. The planes are allocated with the allocator of the matrix.
+ * @param rhs the matrix to multiply with this, its row number should equal cols()
+ * @return A matrix that equals (this * rhs)
+ */
+template <typename T, typename Alloc>
+Matrix<T, Alloc> Matrix<T, Alloc>::_multiplyGauss(const Matrix<T, Alloc>& rhs, std::true_type) const
+{
+	typedef typename std::allocator_traits<Alloc>::template rebind_alloc<double> PlaneAlloc;
+	std::vector<double, PlaneAlloc> lhsReal((std::size_t) nRows * nCols), lhsImaginary(lhsReal.size());
+	std::vector<double, PlaneAlloc> rhsReal((std::size_t) rhs.nRows * rhs.nCols), rhsImaginary(rhsReal.size());
+	std::size_t i;
+	for (i = 0; i < lhsReal.size(); ++i)
+	{
+		lhsReal[i] = _at(i).getReal();
+		lhsImaginary[i] = _at(i).getImaginary();
+	}
+	for (i = 0; i < rhsReal.size(); ++i)
+	{
+		rhsReal[i] = rhs._at(i).getReal();
+		rhsImaginary[i] = rhs._at(i).getImaginary();
+	}
+	Matrix<double, PlaneAlloc> ar(nRows, nCols, std::move(lhsReal)), ai(nRows, nCols, std::move(lhsImaginary));
+	Matrix<double, PlaneAlloc> br(rhs.nRows, rhs.nCols, std::move(rhsReal));
+	Matrix<double, PlaneAlloc> bi(rhs.nRows, rhs.nCols, std::move(rhsImaginary));
+
+	Matrix<double, PlaneAlloc> t1 = ar * br;
+	Matrix<double, PlaneAlloc> t2 = ai * bi;
+	Matrix<double, PlaneAlloc> t3 = (ar + ai) * (br + bi);
+
+	Matrix<T, Alloc> result(nRows, rhs.nCols);
+	if (result.matrix.empty())
+	{
+		return result;
+	}
+	_forEachRowBlock(nRows, rhs.nCols, [&](unsigned int first, unsigned int last)
+	{
+		unsigned int row, j;
+		for (row = first; row < last; ++row)
+		{
+			const double* t1Row = &t1.matrix[t1._getIndex(row, 0)];
+			const double* t2Row = &t2.matrix[t2._getIndex(row, 0)];
+			const double* t3Row = &t3.matrix[t3._getIndex(row, 0)];
+			Complex* resultRow = &result.matrix[result._getIndex(row, 0)];
+			for (j = 0; j < rhs.nCols; ++j)
+			{
+				resultRow[j] = Complex(t1Row[j] - t2Row[j], t3Row[j] - t1Row[j] - t2Row[j]);
+			}
+		}
+	});
+	return result;
+}
+
 #endif //MATRIX_MATRIX_HPP
\ No newline at end of file
@@ -0,0 +1,428 @@
+#ifndef MATRIX_MATRIXBATCH_HPP
+#define MATRIX_MATRIXBATCH_HPP
+
+#include <cstddef>
+#include <algorithm>
+#include <vector>
+#include <stdexcept>
+#include "Matrix.hpp"
+
+/**
+ * @def BATCH_SIMD_WIDTH 8
+ * @brief the number of batch matrices multiplied together, one per vector lane
+ */
+#define BATCH_SIMD_WIDTH 8
+/**
+ * @def BATCH_SIZE_EXCEPTION_MSG "the matrices of a batch should all have the same size."
+ * @brief the message to add to a batch construction exception
+ */
+#define BATCH_SIZE_EXCEPTION_MSG "the matrices of a batch should all have the same size."
+
+/**
+ * @brief calls func(first, last) on blocks of chunks covering [0, chunks)
+ * the blocks run on the thread pool in parallel mode, unless the batch is tiny
+ * @param chunks number of chunks to split
+ * @param chunkSize number of elements processed per chunk
+ * @param func the function to run on every block of chunks
+ */
+template <typename Func>
+void _forEachBatchBlock(std::size_t chunks, std::size_t chunkSize, const Func& func)
+{
+	if (!parallelMode() || chunks * chunkSize < PARALLEL_MIN_ELEMENTS)
+	{
+		func(0, (unsigned int) chunks);
+		return;
+	}
+	ThreadPool::instance().parallelFor((unsigned int) chunks, func);
+}
+
+/**
+ * @brief multiplies count pairs of matrices stored in strided batches, c[b] = a[b] * b[b]
+ * Every matrix is stored row major and contiguous, matrix b of a batch starts b * stride
+ * elements after the first one. The batch is multiplied BATCH_SIMD_WIDTH matrices at a time:
+ * the matrices of a group are interleaved element by element, so the innermost loop runs over
+ * the group and vectorizes across the batch however small the matrices are. The groups are
+ * split between the threads in parallel mode. Every product element sums its products in
+ * increasing order like Matrix<T>::operator*.
+ * @param lhs the first left matrix, rows x inner
+ * @param lhsStride the distance between two left matrices, at least rows * inner
+ * @param rhs the first right matrix, inner x cols
+ * @param rhsStride the distance between two right matrices, at least inner * cols
+ * @param out the first product matrix, rows x cols, may not overlap the operands
+ * @param outStride the distance between two product matrices, at least rows * cols
+ * @param rows the number of rows of the left matrices
+ * @param inner the number of columns of the left matrices and rows of the right matrices
+ * @param cols the number of columns of the right matrices
+ * @param count the number of matrices in every batch
+ */
+template <typename T>
+void batchMultiply(const T* lhs, std::size_t lhsStride, const T* rhs, std::size_t rhsStride, T* out,
+				   std::size_t outStride, unsigned int rows, unsigned int inner, unsigned int cols, std::size_t count)
+{
+	const std::size_t lhsSize = (std::size_t) rows * inner, rhsSize = (std::size_t) inner * cols;
+	const std::size_t chunks = (count + BATCH_SIMD_WIDTH - 1) / BATCH_SIMD_WIDTH;
+	_forEachBatchBlock(chunks, BATCH_SIMD_WIDTH * rows * cols * (std::size_t) inner,
+					   [&](unsigned int first, unsigned int last)
+	{
+		std::vector<T> lhsGroup(lhsSize * BATCH_SIMD_WIDTH), rhsGroup(rhsSize * BATCH_SIMD_WIDTH);
+		T sums[BATCH_SIMD_WIDTH];
+		unsigned int chunk, i, j, k, w;
+		for (chunk = first; chunk < last; ++chunk)
+		{
+			const std::size_t base = (std::size_t) chunk * BATCH_SIMD_WIDTH;
+			const unsigned int width = (unsigned int) std::min<std::size_t>(BATCH_SIMD_WIDTH, count - base);
+			std::size_t e;
+			if (width < BATCH_SIMD_WIDTH)
+			{
+				// the missing matrices of the last group are zero
+				std::fill(lhsGroup.begin(), lhsGroup.end(), T());
+				std::fill(rhsGroup.begin(), rhsGroup.end(), T());
+			}
+			for (w = 0; w < width; ++w)
+			{
+				const T* lhsMatrix = lhs + (base + w) * lhsStride;
+				const T* rhsMatrix = rhs + (base + w) * rhsStride;
+				for (e = 0; e < lhsSize; ++e)
+				{
+					lhsGroup[e * BATCH_SIMD_WIDTH + w] = lhsMatrix[e];
+				}
+				for (e = 0; e < rhsSize; ++e)
+				{
+					rhsGroup[e * BATCH_SIMD_WIDTH + w] = rhsMatrix[e];
+				}
+			}
+			for (i = 0; i < rows; ++i)
+			{
+				for (j = 0; j < cols; ++j)
+				{
+					for (w = 0; w < BATCH_SIMD_WIDTH; ++w)
+					{
+						sums[w] = 0;
+					}
+					for (k = 0; k < inner; ++k)
+					{
+						const T* lhsLanes = &lhsGroup[((std::size_t) i * inner + k) * BATCH_SIMD_WIDTH];
+						const T* rhsLanes = &rhsGroup[((std::size_t) k * cols + j) * BATCH_SIMD_WIDTH];
+						for (w = 0; w < BATCH_SIMD_WIDTH; ++w)
+						{
+							sums[w] = sums[w] + (lhsLanes[w] * rhsLanes[w]);
+						}
+					}
+					for (w = 0; w < width; ++w)
+					{
+						out[(base + w) * outStride + (std::size_t) i * cols + j] = sums[w];
+					}
+				}
+			}
+		}
+	});
+}
+
+/**
+ * @brief transposes count matrices stored in a strided batch, out[b] = in[b].trans(),
+ * conjugated over the complex field like Matrix<T>::trans()
+ * @param in the first matrix, rows x cols
+ * @param inStride the distance between two matrices, at least rows * cols
+ * @param out the first transpose matrix, cols x rows, may not overlap in
+ * @param outStride the distance between two transpose matrices, at least rows * cols
+ * @param rows the number of rows of the matrices
+ * @param cols the number of columns of the matrices
+ * @param count the number of matrices in the batch
+ */
+template <typename T>
+void batchTrans(const T* in, std::size_t inStride, T* out, std::size_t outStride, unsigned int rows,
+				unsigned int cols, std::size_t count)
+{
+	const std::size_t chunks = (count + BATCH_SIMD_WIDTH - 1) / BATCH_SIMD_WIDTH;
+	_forEachBatchBlock(chunks, BATCH_SIMD_WIDTH * rows * (std::size_t) cols, [&](unsigned int first, unsigned int last)
+	{
+		std::size_t b;
+		const std::size_t end = std::min<std::size_t>((std::size_t) last * BATCH_SIMD_WIDTH, count);
+		for (b = (std::size_t) first * BATCH_SIMD_WIDTH; b < end; ++b)
+		{
+			const T* matrix = in + b * inStride;
+			T* transposed = out + b * outStride;
+			unsigned int i, j;
+			for (i = 0; i < rows; ++i)
+			{
+				for (j = 0; j < cols; ++j)
+				{
+					transposed[(std::size_t) j * rows + i] = _transElement(matrix[(std::size_t) i * cols + j]);
+				}
+			}
+		}
+	});
+}
+
+/**
+ * @brief a batch of matrices of the same size, stored back to back in a single buffer
+ * The operations apply to every matrix of the batch at once with a single allocation and
+ * dispatch, instead of one per matrix like a loop over Matrix<T> would.
+ * The batch is laid out as a strided batch with stride() == rows() * cols(), so its data() can
+ * be passed to batchMultiply and batchTrans directly.
+ */
+template <typename T>
+class MatrixBatch
+{
+	/**
+	 * @brief the elements of the matrices, one matrix after the other
+	 */
+	std::vector<T> cells;
+
+	/**
+	 * @brief the number of rows of every matrix
+	 */
+	unsigned int nRows;
+
+	/**
+	 * @brief the number of columns of every matrix
+	 */
+	unsigned int nCols;
+
+	/**
+	 * @brief the number of matrices
+	 */
+	std::size_t nCount;
+
+	/**
+	 * @brief applies an element-wise kernel to two batches of the same size
+	 * @param rhs the right operand
+	 * @param kernel the element kernel, e.g. ElementKernels<T>::add
+	 * @param message the exception message if the sizes don't match
+	 * @return the result batch
+	 */
+	MatrixBatch<T> _elementWise(const MatrixBatch<T>& rhs, void (*kernel)(const T*, const T*, T*, std::size_t),
+								const char* message) const
+	{
+		if (nCount != rhs.nCount || nRows != rhs.nRows || nCols != rhs.nCols)
+		{
+			throw std::invalid_argument(message);
+		}
+		MatrixBatch<T> result(nCount, nRows, nCols);
+		const std::size_t chunk = (std::size_t) BATCH_SIMD_WIDTH * stride();
+		const std::size_t chunks = (nCount + BATCH_SIMD_WIDTH - 1) / BATCH_SIMD_WIDTH;
+		_forEachBatchBlock(chunks, chunk, [&](unsigned int first, unsigned int last)
+		{
+			const std::size_t begin = first * chunk, end = std::min(last * chunk, cells.size());
+			kernel(cells.data() + begin, rhs.cells.data() + begin, result.cells.data() + begin, end - begin);
+		});
+		return result;
+	}
+
+public:
+
+	/**
+	 * @brief creates a batch of count rows x cols zero matrices
+	 * @param count the number of matrices
+	 * @param rows the number of rows of every matrix
+	 * @param cols the number of columns of every matrix
+	 */
+	MatrixBatch(std::size_t count, unsigned int rows, unsigned int cols) :
+			cells(count * rows * cols), nRows(rows), nCols(cols), nCount(count) {};
+
+	/**
+	 * @brief creates a batch from its elements, one row major matrix after the other
+	 * @param count the number of matrices
+	 * @param rows the number of rows of every matrix
+	 * @param cols the number of columns of every matrix
+	 * @param elements count * rows * cols elements
+	 * @throw std::invalid_argument if the number of elements doesn't fit the batch
+	 */
+	MatrixBatch(std::size_t count, unsigned int rows, unsigned int cols, std::vector<T> elements) :
+			cells(std::move(elements)), nRows(rows), nCols(cols), nCount(count)
+	{
+		if (cells.size() != count * rows * cols)
+		{
+			throw std::invalid_argument(CELLS_CTOR_EXCEPTION_MSG);
+		}
+	}
+
+	/**
+	 * @brief copies the given matrices into a batch
+	 * @param matrices matrices of the same size
+	 * @throw std::invalid_argument if the matrices sizes differ
+	 */
+	explicit MatrixBatch(const std::vector<Matrix<T>>& matrices) :
+			nRows(matrices.empty() ? 0 : matrices[0].rows()), nCols(matrices.empty() ? 0 : matrices[0].cols()),
+			nCount(matrices.size())
+	{
+		cells.resize(nCount * stride());
+		std::size_t b;
+		for (b = 0; b < nCount; ++b)
+		{
+			if (matrices[b].rows() != nRows || matrices[b].cols() != nCols)
+			{
+				throw std::invalid_argument(BATCH_SIZE_EXCEPTION_MSG);
+			}
+			set(b, matrices[b]);
+		}
+	}
+
+	/**
+	 * @brief returns the number of matrices in the batch
+	 * @return the number of matrices
+	 */
+	std::size_t size() const
+	{
+		return nCount;
+	}
+
+	/**
+	 * @brief returns the number of rows of every matrix
+	 * @return the number of rows
+	 */
+	unsigned int rows() const
+	{
+		return nRows;
+	}
+
+	/**
+	 * @brief returns the number of columns of every matrix
+	 * @return the number of columns
+	 */
+	unsigned int cols() const
+	{
+		return nCols;
+	}
+
+	/**
+	 * @brief returns the distance between the starts of two consecutive matrices
+	 * @return rows() * cols()
+	 */
+	std::size_t stride() const
+	{
+		return (std::size_t) nRows * nCols;
+	}
+
+	/**
+	 * @brief returns the elements of the batch
+	 * @return the first element of the first matrix
+	 */
+	const T* data() const
+	{
+		return cells.data();
+	}
+
+	/**
+	 * @brief returns the elements of the batch
+	 * @return the first element of the first matrix
+	 */
+	T* data()
+	{
+		return cells.data();
+	}
+
+	/**
+	 * @brief returns a copy of a matrix of the batch
+	 * @param index the matrix index
+	 * @return the matrix
+	 * @throw std::out_of_range if there's no such matrix
+	 */
+	Matrix<T> matrix(std::size_t index) const
+	{
+		if (index >= nCount)
+		{
+			throw std::out_of_range(OUT_OF_RANGE_MSG);
+		}
+		return Matrix<T>(nRows, nCols, std::vector<T>(cells.begin() + index * stride(),
+													   cells.begin() + (index + 1) * stride()));
+	}
+
+	/**
+	 * @brief replaces a matrix of the batch
+	 * @param index the matrix index
+	 * @param matrix the matrix to copy, of size rows() x cols()
+	 * @throw std::out_of_range if there's no such matrix
+	 * @throw std::invalid_argument if the matrix size doesn't match the batch
+	 */
+	void set(std::size_t index, const Matrix<T>& matrix)
+	{
+		if (index >= nCount)
+		{
+			throw std::out_of_range(OUT_OF_RANGE_MSG);
+		}
+		if (matrix.rows() != nRows || matrix.cols() != nCols)
+		{
+			throw std::invalid_argument(BATCH_SIZE_EXCEPTION_MSG);
+		}
+		unsigned int i;
+		for (i = 0; i < nRows; ++i)
+		{
+			std::copy(&matrix.unchecked(i, 0), &matrix.unchecked(i, 0) + nCols,
+					  cells.begin() + index * stride() + (std::size_t) i * nCols);
+		}
+	}
+
+	/**
+	 * @brief adds the matrices of two batches pairwise
+	 * @param rhs batch of the same number and size of matrices
+	 * @return the batch of sums
+	 * @throw std::invalid_argument if the batches sizes don't match
+	 */
+	MatrixBatch<T> operator+(const MatrixBatch<T>& rhs) const
+	{
+		return _elementWise(rhs, &ElementKernels<T>::add, ADDITION_EXCEPTION_MSG);
+	}
+
+	/**
+	 * @brief subtracts the matrices of two batches pairwise
+	 * @param rhs batch of the same number and size of matrices
+	 * @return the batch of differences
+	 * @throw std::invalid_argument if the batches sizes don't match
+	 */
+	MatrixBatch<T> operator-(const MatrixBatch<T>& rhs) const
+	{
+		return _elementWise(rhs, &ElementKernels<T>::sub, SUBTRACTION_EXCEPTION_MSG);
+	}
+
+	/**
+	 * @brief multiplies the matrices of two batches pairwise with batchMultiply
+	 * @param rhs batch of the same number of matrices, with cols() rows
+	 * @return the batch of rows() x rhs.cols() products
+	 * @throw std::invalid_argument if the batches sizes don't match
+	 */
+	MatrixBatch<T> operator*(const MatrixBatch<T>& rhs) const
+	{
+		if (nCount != rhs.nCount || nCols != rhs.nRows)
+		{
+			throw std::invalid_argument(MULTIPLICATION_EXCEPTION_MSG);
+		}
+		MatrixBatch<T> result(nCount, nRows, rhs.nCols);
+		batchMultiply(cells.data(), stride(), rhs.cells.data(), rhs.stride(), result.cells.data(), result.stride(),
+					  nRows, nCols, rhs.nCols, nCount);
+		return result;
+	}
+
+	/**
+	 * @brief transposes every matrix of the batch with batchTrans
+	 * @return the batch of cols() x rows() transpose matrices
+	 */
+	MatrixBatch<T> trans() const
+	{
+		MatrixBatch<T> result(nCount, nCols, nRows);
+		batchTrans(cells.data(), stride(), result.cells.data(), result.stride(), nRows, nCols, nCount);
+		return result;
+	}
+
+	/**
+	 * @brief equals operator
+	 * @param rhs the batch to test this against
+	 * @return true if the batches have the same size and elements
+	 */
+	bool operator==(const MatrixBatch<T>& rhs) const
+	{
+		return nCount == rhs.nCount && nRows == rhs.nRows && nCols == rhs.nCols && cells == rhs.cells;
+	}
+
+	/**
+	 * @brief not-equals operator
+	 * @param rhs the batch to test this against
+	 * @return true if rhs doesn't equal this, otherwise false
+	 */
+	bool operator!=(const MatrixBatch<T>& rhs) const
+	{
+		return !(*this == rhs);
+	}
+};
+
+#endif //MATRIX_MATRIXBATCH_HPP
@@ -0,0 +1,380 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Complex.h"
+#include "Matrix.hpp"
+#include "MatrixParser.hpp"
+
+/**
+ * @def BENCH_WARMUP_RUNS 2
+ * @brief the number of untimed runs of every benchmark before its samples
+ */
+#define BENCH_WARMUP_RUNS 2
+/**
+ * @def BENCH_DEFAULT_SAMPLES 15
+ * @brief the default number of timed samples of every benchmark
+ */
+#define BENCH_DEFAULT_SAMPLES 15
+/**
+ * @def BENCH_MIN_SAMPLE_NS 2000000
+ * @brief the minimum duration of a sample, short operations are repeated within a sample
+ */
+#define BENCH_MIN_SAMPLE_NS 2000000.0
+
+/**
+ * @brief the timing clock, monotonic
+ */
+typedef std::chrono::steady_clock BenchClock;
+
+/**
+ * @brief the result of a benchmark
+ */
+struct BenchResult
+{
+	std::string op;
+	std::string type;
+	unsigned int size;
+	unsigned long iterations;
+	std::vector<double> nsPerOp;
+	double flops;
+	double bytes;
+};
+
+/**
+ * @brief the element traits the benchmark needs: its name, a test value, how it's written in
+ * a matrix text file and the floating point operations of an addition and of a multiply-add
+ */
+template <typename T>
+struct BenchElement;
+
+template <>
+struct BenchElement<int>
+{
+	static const char* name()
+	{
+		return "int";
+	}
+
+	static int make(unsigned int i)
+	{
+		return (int) (i % 19) - 9;
+	}
+
+	static void writeText(std::ostream& os, int value)
+	{
+		os << value;
+	}
+
+	static double flopsPerAdd()
+	{
+		return 1;
+	}
+
+	static double flopsPerMultiplyAdd()
+	{
+		return 2;
+	}
+};
+
+template <>
+struct BenchElement<double>
+{
+	static const char* name()
+	{
+		return "double";
+	}
+
+	static double make(unsigned int i)
+	{
+		return (double) (i % 19) * 0.25 - 2.25;
+	}
+
+	static void writeText(std::ostream& os, double value)
+	{
+		os << value;
+	}
+
+	static double flopsPerAdd()
+	{
+		return 1;
+	}
+
+	static double flopsPerMultiplyAdd()
+	{
+		return 2;
+	}
+};
+
+template <>
+struct BenchElement<Complex>
+{
+	static const char* name()
+	{
+		return "Complex";
+	}
+
+	static Complex make(unsigned int i)
+	{
+		return Complex((double) (i % 19) * 0.25 - 2.25, (double) (i % 7) - 3);
+	}
+
+	static void writeText(std::ostream& os, const Complex& value)
+	{
+		os << value.getReal() << ' ' << value.getImaginary();
+	}
+
+	static double flopsPerAdd()
+	{
+		return 2;
+	}
+
+	static double flopsPerMultiplyAdd()
+	{
+		return 8;
+	}
+};
+
+/**
+ * @brief returns the given percentile of sorted samples, interpolated linearly
+ * @param sorted the samples in increasing order
+ * @param percent the percentile, in [0, 100]
+ * @return the percentile
+ */
+double percentile(const std::vector<double>& sorted, double percent)
+{
+	double position = percent / 100 * (double) (sorted.size() - 1);
+	std::size_t below = (std::size_t) position;
+	if (below + 1 >= sorted.size())
+	{
+		return sorted.back();
+	}
+	return sorted[below] + (sorted[below + 1] - sorted[below]) * (position - (double) below);
+}
+
+/**
+ * @brief keeps the compiler from dropping a benchmarked computation
+ */
+volatile unsigned long benchSink = 0;
+
+/**
+ * @brief returns a value that depends on the storage of the given matrix, so that an
+ * expression converted to it is evaluated and its storage isn't optimized away
+ * @param matrix the benchmarked result
+ * @return a value to fold into benchSink
+ */
+template <typename T>
+unsigned long touch(const Matrix<T>& matrix)
+{
+	return (unsigned long) (std::size_t) &matrix.unchecked(matrix.rows() - 1, matrix.cols() - 1);
+}
+
+/**
+ * @brief times op, after BENCH_WARMUP_RUNS untimed runs, in samples of enough repetitions to
+ * last BENCH_MIN_SAMPLE_NS
+ * @param op the operation to time, returns a value folded into benchSink
+ * @param samples the number of samples
+ * @param result the result to store the iterations and the samples in
+ */
+template <typename Op>
+void measure(const Op& op, unsigned int samples, BenchResult& result)
+{
+	unsigned int i;
+	for (i = 0; i < BENCH_WARMUP_RUNS; ++i)
+	{
+		benchSink += op();
+	}
+	BenchClock::time_point start = BenchClock::now();
+	benchSink += op();
+	double once = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(BenchClock::now() - start).count();
+	result.iterations = std::max(1UL, (unsigned long) (BENCH_MIN_SAMPLE_NS / std::max(once, 1.0)));
+
+	result.nsPerOp.clear();
+	for (i = 0; i < samples; ++i)
+	{
+		unsigned long k;
+		start = BenchClock::now();
+		for (k = 0; k < result.iterations; ++k)
+		{
+			benchSink += op();
+		}
+		double elapsed = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(BenchClock::now() -
+																						  start).count();
+		result.nsPerOp.push_back(elapsed / (double) result.iterations);
+	}
+	std::sort(result.nsPerOp.begin(), result.nsPerOp.end());
+}
+
+/**
+ * @brief runs the benchmarks of element type T and size n x n
+ * @param n the matrix size
+ * @param samples the number of samples of every benchmark
+ * @param results the results to append to
+ */
+template <typename T>
+void benchmarkType(unsigned int n, unsigned int samples, std::vector<BenchResult>& results)
+{
+	std::vector<T> cells1, cells2;
+	unsigned int i;
+	for (i = 0; i < n * n; ++i)
+	{
+		cells1.push_back(BenchElement<T>::make(i));
+		cells2.push_back(BenchElement<T>::make(i * 7 + 3));
+	}
+	const Matrix<T> a(n, n, cells1), b(n, n, cells2), c(a);
+	const double elements = (double) n * n, elementBytes = elements * sizeof(T);
+
+	std::ostringstream textStream;
+	textStream << n << ' ' << n << '\n';
+	for (i = 0; i < n * n; ++i)
+	{
+		BenchElement<T>::writeText(textStream, cells1[i]);
+		textStream << (i % n == n - 1 ? '\n' : ' ');
+	}
+	const std::string text = textStream.str();
+
+	BenchResult result;
+	result.type = BenchElement<T>::name();
+	result.size = n;
+
+	result.op = "plus";
+	result.flops = elements * BenchElement<T>::flopsPerAdd();
+	result.bytes = 3 * elementBytes;
+	measure([&]() { return touch(Matrix<T>(a + b)); }, samples, result);
+	results.push_back(result);
+
+	result.op = "minus";
+	measure([&]() { return touch(Matrix<T>(a - b)); }, samples, result);
+	results.push_back(result);
+
+	result.op = "multiply";
+	result.flops = elements * n * BenchElement<T>::flopsPerMultiplyAdd();
+	result.bytes = 3 * elementBytes;
+	measure([&]() { return touch(a * b); }, samples, result);
+	results.push_back(result);
+
+	result.op = "trans";
+	result.flops = 0;
+	result.bytes = 2 * elementBytes;
+	measure([&]() { return touch(a.trans()); }, samples, result);
+	results.push_back(result);
+
+	result.op = "equals";
+	measure([&]() { return (unsigned long) (a == c); }, samples, result);
+	results.push_back(result);
+
+	result.op = "parse";
+	result.bytes = (double) text.size() + elementBytes;
+	measure([&]() { return touch(parseMatrixText<T>(text.data(), text.size())); }, samples,
+			result);
+	results.push_back(result);
+
+	result.op = "print";
+	measure([&]()
+	{
+		std::ostringstream out;
+		out << a;
+		return (unsigned long) out.tellp();
+	}, samples, result);
+	results.push_back(result);
+}
+
+/**
+ * @brief writes the results as a JSON document
+ * @param os the output stream
+ * @param results the results
+ * @param samples the number of samples of every benchmark
+ * @param parallel true if the benchmarks ran in parallel mode
+ */
+void writeJson(std::ostream& os, const std::vector<BenchResult>& results, unsigned int samples, bool parallel)
+{
+	os.precision(6);
+	os << "{\n  \"benchmark\": \"Matrix\",\n  \"clock\": \"steady_clock\",\n  \"warmup_runs\": " << BENCH_WARMUP_RUNS
+	   << ",\n  \"samples\": " << samples << ",\n  \"parallel\": " << (parallel ? "true" : "false")
+	   << ",\n  \"results\": [";
+	std::size_t r;
+	for (r = 0; r < results.size(); ++r)
+	{
+		const BenchResult& result = results[r];
+		const double median = percentile(result.nsPerOp, 50);
+		os << (r == 0 ? "\n" : ",\n") << "    {\"op\": \"" << result.op << "\", \"type\": \"" << result.type
+		   << "\", \"size\": " << result.size << ", \"iterations\": " << result.iterations
+		   << ", \"ns_per_op\": {\"min\": " << result.nsPerOp.front() << ", \"p10\": "
+		   << percentile(result.nsPerOp, 10) << ", \"p50\": " << median << ", \"p90\": "
+		   << percentile(result.nsPerOp, 90) << ", \"p99\": " << percentile(result.nsPerOp, 99) << ", \"max\": "
+		   << result.nsPerOp.back() << "}, \"gflops\": ";
+		if (result.flops > 0)
+		{
+			os << result.flops / median;
+		}
+		else
+		{
+			os << "null";
+		}
+		os << ", \"gbps\": " << result.bytes / median << "}";
+	}
+	os << "\n  ]\n}\n";
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<unsigned int> sizes = {16, 64, 256};
+	unsigned int samples = BENCH_DEFAULT_SAMPLES;
+	bool parallel = false;
+	std::string output;
+	int arg;
+	for (arg = 1; arg < argc; ++arg)
+	{
+		if (std::strcmp(argv[arg], "--quick") == 0)
+		{
+			sizes = {16, 64};
+			samples = 5;
+		}
+		else if (std::strcmp(argv[arg], "--parallel") == 0)
+		{
+			parallel = true;
+		}
+		else if (std::strcmp(argv[arg], "--samples") == 0 && arg + 1 < argc && std::atoi(argv[arg + 1]) > 0)
+		{
+			samples = (unsigned int) std::atoi(argv[++arg]);
+		}
+		else if (std::strcmp(argv[arg], "--output") == 0 && arg + 1 < argc)
+		{
+			output = argv[++arg];
+		}
+		else
+		{
+			std::cerr << "Usage: MatrixBenchmark [--quick] [--parallel] [--samples <count>] [--output <json_file>]"
+					  << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	Matrix<int>::setParallel(parallel);
+
+	std::vector<BenchResult> results;
+	for (unsigned int n : sizes)
+	{
+		benchmarkType<int>(n, samples, results);
+		benchmarkType<double>(n, samples, results);
+		benchmarkType<Complex>(n, samples, results);
+	}
+
+	if (output.empty())
+	{
+		writeJson(std::cout, results, samples, parallel);
+		return EXIT_SUCCESS;
+	}
+	std::ofstream file(output.c_str());
+	writeJson(file, results, samples, parallel);
+	if (!file)
+	{
+		std::cerr << "Error! Can't write file: " << output << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
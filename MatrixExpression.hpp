@@ -0,0 +1,369 @@
+#ifndef MATRIX_MATRIXEXPRESSION_HPP
+#define MATRIX_MATRIXEXPRESSION_HPP
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include "Complex.h"
+#include "MatrixSimd.hpp"
+
+template <class T, class Alloc = std::allocator<T>>
+class Matrix;
+
+template <typename T, typename Alloc = std::allocator<T>>
+class MatrixTransView;
+
+/**
+ * @brief returns the transposed value of a single element
+ * @param element the element to transpose
+ * @return the element
+ */
+template <typename T>
+T _transElement(const T& element)
+{
+	return element;
+}
+
+/**
+ * @brief over the complex field the transpose is the conjugate transpose
+ * @param element the element to transpose
+ * @return the conjugate of the element
+ */
+inline Complex _transElement(const Complex& element)
+{
+	return element.conj();
+}
+
+/**
+ * @brief base class of every matrix expression, E is the derived expression type
+ * An expression is evaluated lazily, element by element, when it's assigned to a Matrix,
+ * so a chain of element-wise operations runs in a single pass without temporaries.
+ * Every expression provides value_type, rows(), cols() and _at(index) which returns the
+ * element at the given row major index.
+ * Expressions keep references to their Matrix operands, they should be assigned to a
+ * Matrix in the same statement and not stored (e.g. with auto).
+ */
+template <typename E>
+class MatrixExpression
+{
+public:
+
+	/**
+	 * @brief returns the derived expression
+	 * @return the derived expression
+	 */
+	const E& self() const
+	{
+		return static_cast<const E&>(*this);
+	}
+};
+
+/**
+ * @brief true if E is a matrix expression (including Matrix itself)
+ */
+template <typename E>
+struct IsMatrixExpression : std::is_base_of<MatrixExpression<E>, E>
+{
+};
+
+/**
+ * @brief defines type as Result if both L and R are matrix expressions
+ * used as the return type of the expression operators, which take their operands by exact type so
+ * that they are preferred over converting an expression to a Matrix for the Matrix member operators
+ */
+template <typename L, typename R, typename Result>
+struct EnableIfExpressions : std::enable_if<IsMatrixExpression<L>::value && IsMatrixExpression<R>::value, Result>
+{
+};
+
+/**
+ * @brief the type used by an expression node to hold its operand
+ * nested expressions are small and held by value, matrices are held by reference
+ */
+template <typename E>
+struct ExpressionOperand
+{
+	typedef const E type;
+};
+
+/**
+ * @brief matrices are held by reference
+ */
+template <typename T, typename Alloc>
+struct ExpressionOperand<Matrix<T, Alloc>>
+{
+	typedef const Matrix<T, Alloc>& type;
+};
+
+/**
+ * @brief the matrix type an expression is evaluated into, a matrix with the default allocator
+ */
+template <typename E>
+struct ExpressionResult
+{
+	typedef Matrix<typename E::value_type> type;
+};
+
+template <typename Op, typename L, typename R>
+class MatrixBinaryExpression;
+
+/**
+ * @brief an element-wise operation evaluates into the matrix type of its left operand
+ */
+template <typename Op, typename L, typename R>
+struct ExpressionResult<MatrixBinaryExpression<Op, L, R>>
+{
+	typedef typename ExpressionResult<L>::type type;
+};
+
+/**
+ * @brief a matrix evaluates into a matrix with the same allocator
+ */
+template <typename T, typename Alloc>
+struct ExpressionResult<Matrix<T, Alloc>>
+{
+	typedef Matrix<T, Alloc> type;
+};
+
+/**
+ * @brief a transposed view evaluates into a matrix with the allocator of the viewed matrix
+ */
+template <typename T, typename Alloc>
+struct ExpressionResult<MatrixTransView<T, Alloc>>
+{
+	typedef Matrix<T, Alloc> type;
+};
+
+/**
+ * @brief element-wise addition
+ */
+struct PlusOp
+{
+	/**
+	 * @brief returns lhs + rhs
+	 */
+	template <typename T>
+	static T apply(const T& lhs, const T& rhs)
+	{
+		return lhs + rhs;
+	}
+
+	/**
+	 * @brief out[i] = lhs[i] + rhs[i] over n contiguous elements
+	 */
+	template <typename T>
+	static void kernel(const T* lhs, const T* rhs, T* out, std::size_t n)
+	{
+		ElementKernels<T>::add(lhs, rhs, out, n);
+	}
+};
+
+/**
+ * @brief element-wise subtraction
+ */
+struct MinusOp
+{
+	/**
+	 * @brief returns lhs - rhs
+	 */
+	template <typename T>
+	static T apply(const T& lhs, const T& rhs)
+	{
+		return lhs - rhs;
+	}
+
+	/**
+	 * @brief out[i] = lhs[i] - rhs[i] over n contiguous elements
+	 */
+	template <typename T>
+	static void kernel(const T* lhs, const T* rhs, T* out, std::size_t n)
+	{
+		ElementKernels<T>::sub(lhs, rhs, out, n);
+	}
+};
+
+/**
+ * @brief an element-wise operation Op on two expressions of the same size
+ */
+template <typename Op, typename L, typename R>
+class MatrixBinaryExpression : public MatrixExpression<MatrixBinaryExpression<Op, L, R>>
+{
+	/**
+	 * @brief the left operand
+	 */
+	typename ExpressionOperand<L>::type lhs;
+
+	/**
+	 * @brief the right operand
+	 */
+	typename ExpressionOperand<R>::type rhs;
+
+public:
+
+	/**
+	 * @brief the element type of the expression
+	 */
+	typedef typename L::value_type value_type;
+
+	/**
+	 * @brief constructs the expression, the operand sizes should be checked by the caller
+	 * @param left the left operand
+	 * @param right the right operand
+	 */
+	MatrixBinaryExpression(const L& left, const R& right) : lhs(left), rhs(right) {};
+
+	/**
+	 * @brief returns the number of rows of the expression
+	 * @return the number of rows of the expression
+	 */
+	unsigned int rows() const
+	{
+		return lhs.rows();
+	}
+
+	/**
+	 * @brief returns the number of columns of the expression
+	 * @return the number of columns of the expression
+	 */
+	unsigned int cols() const
+	{
+		return lhs.cols();
+	}
+
+	/**
+	 * @brief returns the left operand
+	 * @return the left operand
+	 */
+	const L& left() const
+	{
+		return lhs;
+	}
+
+	/**
+	 * @brief returns the right operand
+	 * @return the right operand
+	 */
+	const R& right() const
+	{
+		return rhs;
+	}
+
+	/**
+	 * @brief returns the transpose of the value of the expression
+	 * @return transpose matrix
+	 */
+	typename ExpressionResult<MatrixBinaryExpression>::type trans() const
+	{
+		return typename ExpressionResult<MatrixBinaryExpression>::type(*this).trans();
+	}
+
+	/**
+	 * @brief evaluates the element at the given row major index
+	 * @param index the element index
+	 * @return the element value
+	 */
+	value_type _at(std::size_t index) const
+	{
+		return Op::apply(lhs._at(index), rhs._at(index));
+	}
+
+	/**
+	 * @brief returns true if the expression reads the given matrix through a transposed view
+	 * such an expression can't be evaluated into the storage of that matrix
+	 * @param matrix the matrix to test
+	 * @return true if the expression reads the transpose of matrix
+	 */
+	template <typename M>
+	bool _transposes(const M& matrix) const
+	{
+		return lhs._transposes(matrix) || rhs._transposes(matrix);
+	}
+};
+
+/**
+ * @brief a transposed view of a matrix, conjugated over the complex field like Matrix::trans()
+ * The view doesn't copy the matrix: operator* multiplies it with dedicated kernels, and the
+ * element-wise operations and assignments read the matrix elements through it.
+ * Like the other expressions the view keeps a reference to the matrix.
+ */
+template <typename T, typename Alloc>
+class MatrixTransView : public MatrixExpression<MatrixTransView<T, Alloc>>
+{
+	/**
+	 * @brief the viewed matrix
+	 */
+	const Matrix<T, Alloc>& source;
+
+public:
+
+	/**
+	 * @brief the element type of the expression
+	 */
+	typedef T value_type;
+
+	/**
+	 * @brief constructs a transposed view of the given matrix
+	 * @param matrix the matrix to view
+	 */
+	explicit MatrixTransView(const Matrix<T, Alloc>& matrix) : source(matrix) {};
+
+	/**
+	 * @brief returns the number of rows of the view, the number of columns of the matrix
+	 * @return the number of rows of the view
+	 */
+	unsigned int rows() const
+	{
+		return source.cols();
+	}
+
+	/**
+	 * @brief returns the number of columns of the view, the number of rows of the matrix
+	 * @return the number of columns of the view
+	 */
+	unsigned int cols() const
+	{
+		return source.rows();
+	}
+
+	/**
+	 * @brief returns the viewed matrix
+	 * @return the viewed matrix
+	 */
+	const Matrix<T, Alloc>& matrix() const
+	{
+		return source;
+	}
+
+	/**
+	 * @brief returns the transpose of the view, which is the viewed matrix
+	 * @return a copy of the viewed matrix
+	 */
+	Matrix<T, Alloc> trans() const
+	{
+		return source;
+	}
+
+	/**
+	 * @brief evaluates the element at the given row major index
+	 * @param index the element index
+	 * @return the element value
+	 */
+	value_type _at(std::size_t index) const
+	{
+		std::size_t row = index / source.rows(), col = index % source.rows();
+		return _transElement(source._at(col * source.cols() + row));
+	}
+
+	/**
+	 * @brief returns true if the given matrix is the viewed matrix
+	 * @param matrix the matrix to test
+	 * @return true if the view reads the transpose of matrix
+	 */
+	template <typename M>
+	bool _transposes(const M& matrix) const
+	{
+		return static_cast<const void*>(&source) == static_cast<const void*>(&matrix);
+	}
+};
+
+#endif //MATRIX_MATRIXEXPRESSION_HPP
@@ -0,0 +1,418 @@
+#ifndef MATRIX_MATRIXFILE_HPP
+#define MATRIX_MATRIXFILE_HPP
+
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Complex.h"
+#include "Matrix.hpp"
+
+/**
+ * @def MATRIX_FILE_MAGIC "MTRX"
+ * @brief the first bytes of every binary matrix file
+ */
+#define MATRIX_FILE_MAGIC "MTRX"
+/**
+ * @def MATRIX_FILE_VERSION 1
+ * @brief the version of the binary matrix file format
+ */
+#define MATRIX_FILE_VERSION 1
+/**
+ * @def MATRIX_FILE_BYTE_ORDER 0x01020304
+ * @brief written in native byte order, tells the reader the byte order of the file
+ */
+#define MATRIX_FILE_BYTE_ORDER 0x01020304
+/**
+ * @def MATRIX_FILE_OPEN_EXCEPTION_MSG "cannot open the matrix file."
+ * @brief the message to add to a matrix file open exception
+ */
+#define MATRIX_FILE_OPEN_EXCEPTION_MSG "cannot open the matrix file."
+/**
+ * @def MATRIX_FILE_WRITE_EXCEPTION_MSG "cannot write the matrix file."
+ * @brief the message to add to a matrix file write exception
+ */
+#define MATRIX_FILE_WRITE_EXCEPTION_MSG "cannot write the matrix file."
+/**
+ * @def MATRIX_FILE_FORMAT_EXCEPTION_MSG "the file isn't a matrix file of the requested element type."
+ * @brief the message to add to a matrix file format exception
+ */
+#define MATRIX_FILE_FORMAT_EXCEPTION_MSG "the file isn't a matrix file of the requested element type."
+/**
+ * @def MATRIX_FILE_BYTE_ORDER_EXCEPTION_MSG "the matrix file was written with a different byte order."
+ * @brief the message to add to a matrix file byte order exception
+ */
+#define MATRIX_FILE_BYTE_ORDER_EXCEPTION_MSG "the matrix file was written with a different byte order."
+
+/**
+ * @brief the header at the start of a binary matrix file
+ * The header is followed by rows * cols elements in row major order, in the byte order given by
+ * byteOrder. A Complex element is its real part followed by its imaginary part, as doubles.
+ * The header is 64 bytes long so the elements are aligned for any element type.
+ */
+struct MatrixFileHeader
+{
+	/**
+	 * @brief MATRIX_FILE_MAGIC, without the terminating null
+	 */
+	char magic[4];
+
+	/**
+	 * @brief the format version, MATRIX_FILE_VERSION
+	 */
+	std::uint32_t version;
+
+	/**
+	 * @brief MatrixFileElement<T>::type of the element type
+	 */
+	std::uint32_t elementType;
+
+	/**
+	 * @brief MATRIX_FILE_BYTE_ORDER written in the byte order of the file
+	 */
+	std::uint32_t byteOrder;
+
+	/**
+	 * @brief the number of rows
+	 */
+	std::uint64_t rows;
+
+	/**
+	 * @brief the number of columns
+	 */
+	std::uint64_t cols;
+
+	/**
+	 * @brief zero, pads the header to 64 bytes
+	 */
+	char reserved[32];
+};
+
+static_assert(sizeof(MatrixFileHeader) == 64, "the matrix file header should be 64 bytes long");
+
+/**
+ * @brief the element type code of T in the binary matrix format, defined for int, double and Complex
+ */
+template <typename T>
+struct MatrixFileElement;
+
+/**
+ * @brief int elements
+ */
+template <>
+struct MatrixFileElement<int>
+{
+	static const std::uint32_t type = 1;
+};
+
+/**
+ * @brief double elements
+ */
+template <>
+struct MatrixFileElement<double>
+{
+	static const std::uint32_t type = 2;
+};
+
+/**
+ * @brief Complex elements, stored as two doubles
+ */
+template <>
+struct MatrixFileElement<Complex>
+{
+	static_assert(sizeof(Complex) == 2 * sizeof(double), "Complex should consist of its two double parts");
+
+	static const std::uint32_t type = 3;
+};
+
+/**
+ * @brief returns true if the given file starts with the binary matrix file magic
+ * @param path the file path
+ * @return true if the file is a binary matrix file, otherwise false
+ */
+inline bool isMatrixFile(const std::string& path)
+{
+	char magic[sizeof(MatrixFileHeader::magic)];
+	std::FILE* file = std::fopen(path.c_str(), "rb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+	bool found = std::fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+				 std::memcmp(magic, MATRIX_FILE_MAGIC, sizeof(magic)) == 0;
+	std::fclose(file);
+	return found;
+}
+
+/**
+ * @brief returns the header of a binary matrix file of element type T in native byte order
+ * @param rows the number of rows
+ * @param cols the number of columns
+ * @return the file header
+ */
+template <typename T>
+MatrixFileHeader _matrixFileHeader(unsigned int rows, unsigned int cols)
+{
+	MatrixFileHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, MATRIX_FILE_MAGIC, sizeof(header.magic));
+	header.version = MATRIX_FILE_VERSION;
+	header.elementType = MatrixFileElement<T>::type;
+	header.byteOrder = MATRIX_FILE_BYTE_ORDER;
+	header.rows = rows;
+	header.cols = cols;
+	return header;
+}
+
+/**
+ * @brief validates the header of a binary matrix file of element type T
+ * @param header the file header
+ * @param fileSize the size of the whole file in bytes, at least the header size
+ * @return nullptr if the file is valid, otherwise the exception message
+ */
+template <typename T>
+const char* _matrixFileError(const MatrixFileHeader& header, std::size_t fileSize)
+{
+	if (std::memcmp(header.magic, MATRIX_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+		header.version != MATRIX_FILE_VERSION)
+	{
+		return MATRIX_FILE_FORMAT_EXCEPTION_MSG;
+	}
+	if (header.byteOrder != MATRIX_FILE_BYTE_ORDER)
+	{
+		return MATRIX_FILE_BYTE_ORDER_EXCEPTION_MSG;
+	}
+	if (header.elementType != MatrixFileElement<T>::type || header.rows > UINT32_MAX ||
+		header.cols > UINT32_MAX || (header.cols != 0 &&
+		(fileSize - sizeof(MatrixFileHeader)) / sizeof(T) / header.cols < header.rows))
+	{
+		return MATRIX_FILE_FORMAT_EXCEPTION_MSG;
+	}
+	return nullptr;
+}
+
+/**
+ * @brief writes the given matrix to a binary matrix file in native byte order
+ * @param path the file path, an existing file is replaced
+ * @param matrix the matrix to write
+ * @throw std::runtime_error if the file can't be written
+ */
+template <typename T, typename Alloc>
+void writeMatrixFile(const std::string& path, const Matrix<T, Alloc>& matrix)
+{
+	MatrixFileHeader header = _matrixFileHeader<T>(matrix.rows(), matrix.cols());
+	std::FILE* file = std::fopen(path.c_str(), "wb");
+	if (file == nullptr)
+	{
+		throw std::runtime_error(MATRIX_FILE_OPEN_EXCEPTION_MSG);
+	}
+	bool written = std::fwrite(&header, sizeof(header), 1, file) == 1;
+	if (matrix.stride() == matrix.cols())
+	{
+		std::size_t size = (std::size_t) matrix.rows() * matrix.cols();
+		written = written && (size == 0 || std::fwrite(matrix.data(), sizeof(T), size, file) == size);
+	}
+	else
+	{
+		// padded rows are written one by one, without their padding
+		unsigned int i;
+		for (i = 0; i < matrix.rows() && written; ++i)
+		{
+			written = std::fwrite(matrix.data() + (std::size_t) i * matrix.stride(), sizeof(T), matrix.cols(),
+								  file) == matrix.cols();
+		}
+	}
+	if (std::fclose(file) != 0 || !written)
+	{
+		throw std::runtime_error(MATRIX_FILE_WRITE_EXCEPTION_MSG);
+	}
+}
+
+/**
+ * @brief a read only binary matrix file mapped into memory
+ * The elements are read in place from the mapped pages, nothing is parsed or copied until the
+ * matrix is converted to a Matrix<T>. The mapped matrix is an expression, so it can be used as
+ * an operand of the matrix operators and assigned to a Matrix<T> directly.
+ */
+template <typename T>
+class MappedMatrix : public MatrixExpression<MappedMatrix<T>>
+{
+	/**
+	 * @brief the mapped file
+	 */
+	void* mapping;
+
+	/**
+	 * @brief the size of the mapping in bytes
+	 */
+	std::size_t mappingSize;
+
+	/**
+	 * @brief the first element
+	 */
+	const T* elements;
+
+	/**
+	 * @brief the number of columns in the matrix;
+	 */
+	unsigned int nCols;
+
+	/**
+	 * @brief the number of rows in the matrix;
+	 */
+	unsigned int nRows;
+
+public:
+
+	/**
+	 * @brief the element type of the expression
+	 */
+	typedef T value_type;
+
+	/**
+	 * @brief maps the given binary matrix file
+	 * @param path the file path
+	 * @throw std::runtime_error if the file can't be mapped, isn't a matrix file of element type T
+	 * or was written with a different byte order
+	 */
+	explicit MappedMatrix(const std::string& path) : mapping(MAP_FAILED), mappingSize(0), elements(nullptr),
+													 nCols(0), nRows(0)
+	{
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			throw std::runtime_error(MATRIX_FILE_OPEN_EXCEPTION_MSG);
+		}
+		struct stat status;
+		if (fstat(fd, &status) != 0 || (std::size_t) status.st_size < sizeof(MatrixFileHeader))
+		{
+			close(fd);
+			throw std::runtime_error(MATRIX_FILE_FORMAT_EXCEPTION_MSG);
+		}
+		mappingSize = (std::size_t) status.st_size;
+		mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (mapping == MAP_FAILED)
+		{
+			throw std::runtime_error(MATRIX_FILE_OPEN_EXCEPTION_MSG);
+		}
+
+		const MatrixFileHeader* header = static_cast<const MatrixFileHeader*>(mapping);
+		const char* error = _matrixFileError<T>(*header, mappingSize);
+		if (error != nullptr)
+		{
+			munmap(mapping, mappingSize);
+			throw std::runtime_error(error);
+		}
+
+		nRows = (unsigned int) header->rows;
+		nCols = (unsigned int) header->cols;
+		elements = reinterpret_cast<const T*>(static_cast<const char*>(mapping) + sizeof(MatrixFileHeader));
+		// the elements are usually read once from start to end
+		madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+	}
+
+	/**
+	 * @brief unmaps the file
+	 */
+	~MappedMatrix()
+	{
+		munmap(mapping, mappingSize);
+	}
+
+	/**
+	 * @brief the mapping can't be copied
+	 */
+	MappedMatrix(const MappedMatrix&) = delete;
+
+	/**
+	 * @brief the mapping can't be assigned
+	 */
+	MappedMatrix& operator=(const MappedMatrix&) = delete;
+
+	/**
+	 * @brief returns the number of rows in the matrix
+	 * @return the number of rows in the matrix
+	 */
+	unsigned int rows() const
+	{
+		return nRows;
+	}
+
+	/**
+	 * @brief returns the number of columns in the matrix
+	 * @return the number of columns in the matrix
+	 */
+	unsigned int cols() const
+	{
+		return nCols;
+	}
+
+	/**
+	 * @brief returns the mapped elements, rows() * cols() elements in row major order
+	 * @return the mapped elements
+	 */
+	const T* data() const
+	{
+		return elements;
+	}
+
+	/**
+	 * @brief returns the transpose of the matrix
+	 * @return transpose matrix
+	 */
+	Matrix<T> trans() const
+	{
+		return Matrix<T>(*this).trans();
+	}
+
+	/**
+	 * @brief returns the element at the given row major index
+	 * @param index the element index
+	 * @return the element at the given index
+	 */
+	const T& _at(std::size_t index) const
+	{
+		return elements[index];
+	}
+
+	/**
+	 * @brief returns false, the mapped elements are never the storage of a matrix
+	 * @return false
+	 */
+	template <typename M>
+	bool _transposes(const M&) const
+	{
+		return false;
+	}
+};
+
+/**
+ * @brief mapped matrices are held by reference
+ */
+template <typename T>
+struct ExpressionOperand<MappedMatrix<T>>
+{
+	typedef const MappedMatrix<T>& type;
+};
+
+/**
+ * @brief reads a binary matrix file into a new matrix
+ * the elements are copied once from the mapped file, without parsing
+ * @param path the file path
+ * @return the matrix in the file
+ * @throw std::runtime_error if the file can't be read or isn't a matrix file of element type T
+ */
+template <typename T>
+Matrix<T> readMatrixFile(const std::string& path)
+{
+	return Matrix<T>(MappedMatrix<T>(path));
+}
+
+#endif //MATRIX_MATRIXFILE_HPP
@@ -0,0 +1,28 @@
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "Complex.h"
+#include "Matrix.hpp"
+#include "MatrixFile.hpp"
+#include "MatrixParser.hpp"
+
+int main(int argc, char *argv[])
+{
+	if (argc != 3)
+	{
+		std::cerr << "Usage: MatrixFileConverter <text_matrix_file> <binary_matrix_file>" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		writeMatrixFile(argv[2], readMatrixText<Complex>(argv[1]));
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Error! " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,252 @@
+#ifndef MATRIX_MATRIXFORMAT_HPP
+#define MATRIX_MATRIXFORMAT_HPP
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <sstream>
+#include "Complex.h"
+
+/**
+ * @def FORMAT_BUFFER_SIZE 32
+ * @brief the size of the buffer a single number is formatted into
+ */
+#define FORMAT_BUFFER_SIZE 32
+/**
+ * @def FORMAT_MAX_INTEGRAL_PRECISION 15
+ * @brief integral doubles are formatted without printf up to this precision (10^15 < 2^53)
+ */
+#define FORMAT_MAX_INTEGRAL_PRECISION 15
+/**
+ * @def FORMAT_MAX_FAST_PRECISION 9
+ * @brief other doubles are formatted without printf up to this precision, the rounding error
+ * of a single scaling by a power of 10 is far below the last digit at this precision
+ */
+#define FORMAT_MAX_FAST_PRECISION 9
+/**
+ * @def FORMAT_TIE_MARGIN 1e-6
+ * @brief scaled values this close to a rounding tie are left to printf, which rounds exactly
+ */
+#define FORMAT_TIE_MARGIN 1e-6
+
+/**
+ * @brief appends the decimal digits of the given magnitude to out
+ * @param out the text to append to
+ * @param magnitude the number to append
+ */
+inline void _appendDigits(std::string& out, unsigned long long magnitude)
+{
+	char digits[FORMAT_BUFFER_SIZE];
+	char* first = digits + sizeof(digits);
+	do
+	{
+		*--first = (char) ('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude != 0);
+	out.append(first, digits + sizeof(digits));
+}
+
+/**
+ * @brief appends a finite non zero double to out as printf's %.*g, when the digits can be
+ * rounded reliably with a single scaling: the value is scaled by an exact power of 10 to
+ * precision integral digits, which are rounded and laid out in fixed or exponent notation
+ * @param out the text to append to
+ * @param value the number to append
+ * @param precision the number of significant digits, 1 to FORMAT_MAX_FAST_PRECISION
+ * @return true if the number was appended, false if it's left to printf
+ */
+inline bool _appendGeneral(std::string& out, double value, int precision)
+{
+	static const double powersOf10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+										1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+	const int maxPower = (int) (sizeof(powersOf10) / sizeof(powersOf10[0])) - 1;
+	double magnitude = std::fabs(value);
+	int exponent = (int) std::floor(std::log10(magnitude));
+	double scaled = 0;
+	int attempt;
+	// log10 may be off by one next to the powers of 10
+	for (attempt = 0; attempt < 2; ++attempt)
+	{
+		int shift = precision - 1 - exponent;
+		if (shift > maxPower || shift < -maxPower)
+		{
+			return false;
+		}
+		scaled = shift >= 0 ? magnitude * powersOf10[shift] : magnitude / powersOf10[-shift];
+		if (scaled < powersOf10[precision - 1])
+		{
+			--exponent;
+		}
+		else if (scaled >= powersOf10[precision])
+		{
+			++exponent;
+		}
+		else
+		{
+			break;
+		}
+	}
+	if (attempt == 2)
+	{
+		return false;
+	}
+	double integral = std::floor(scaled);
+	if (std::fabs(scaled - integral - 0.5) < FORMAT_TIE_MARGIN)
+	{
+		return false;
+	}
+	unsigned long long digitsValue = (unsigned long long) integral + (scaled - integral > 0.5);
+	if (digitsValue == (unsigned long long) powersOf10[precision])
+	{
+		digitsValue /= 10;
+		++exponent;
+	}
+
+	char digits[FORMAT_BUFFER_SIZE];
+	int i;
+	for (i = precision - 1; i >= 0; --i)
+	{
+		digits[i] = (char) ('0' + digitsValue % 10);
+		digitsValue /= 10;
+	}
+	// %g drops the trailing zeros of the fraction
+	int nDigits = precision;
+	while (nDigits > 1 && digits[nDigits - 1] == '0' && (exponent < -4 || exponent >= precision ||
+														nDigits > exponent + 1))
+	{
+		--nDigits;
+	}
+
+	if (value < 0)
+	{
+		out += '-';
+	}
+	if (exponent < -4 || exponent >= precision)
+	{
+		out += digits[0];
+		if (nDigits > 1)
+		{
+			out += '.';
+			out.append(digits + 1, (std::size_t) (nDigits - 1));
+		}
+		out += 'e';
+		out += exponent < 0 ? '-' : '+';
+		int magnitudeExponent = exponent < 0 ? -exponent : exponent;
+		if (magnitudeExponent < 10)
+		{
+			out += '0';
+		}
+		_appendDigits(out, (unsigned long long) magnitudeExponent);
+	}
+	else if (exponent >= 0)
+	{
+		out.append(digits, (std::size_t) (exponent + 1));
+		if (nDigits > exponent + 1)
+		{
+			out += '.';
+			out.append(digits + exponent + 1, (std::size_t) (nDigits - exponent - 1));
+		}
+	}
+	else
+	{
+		out += "0.";
+		out.append((std::size_t) (-exponent - 1), '0');
+		out.append(digits, (std::size_t) nDigits);
+	}
+	return true;
+}
+
+/**
+ * @brief appends an int to out, as std::ostream formats it by default
+ * @param out the text to append to
+ * @param value the number to append
+ */
+inline void _appendText(std::string& out, int value, int)
+{
+	if (value < 0)
+	{
+		out += '-';
+	}
+	_appendDigits(out, value < 0 ? 0ull - (unsigned long long) value : (unsigned long long) value);
+}
+
+/**
+ * @brief appends a double to out, as std::ostream formats it by default with the given precision
+ * (printf's %g). Integral values that %g prints without an exponent and the values that
+ * _appendGeneral can round reliably are formatted directly, other values with snprintf.
+ * @param out the text to append to
+ * @param value the number to append
+ * @param precision the stream precision
+ */
+inline void _appendText(std::string& out, double value, int precision)
+{
+	// %g prints at least one significant digit, also for precision 0
+	static const double powersOf10[] = {1e1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+										1e12, 1e13, 1e14, 1e15};
+	if (precision <= FORMAT_MAX_INTEGRAL_PRECISION && std::fabs(value) < powersOf10[precision] &&
+		value == (double) (long long) value)
+	{
+		if (std::signbit(value))
+		{
+			out += '-';
+		}
+		_appendDigits(out, (unsigned long long) std::fabs(value));
+		return;
+	}
+	if (precision <= FORMAT_MAX_FAST_PRECISION && std::isfinite(value) &&
+		_appendGeneral(out, value, precision == 0 ? 1 : precision))
+	{
+		return;
+	}
+
+	char buffer[FORMAT_BUFFER_SIZE];
+	int length = std::snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+	if (length < (int) sizeof(buffer))
+	{
+		out.append(buffer, (std::size_t) length);
+		return;
+	}
+	std::vector<char> large((std::size_t) length + 1);
+	std::snprintf(large.data(), large.size(), "%.*g", precision, value);
+	out.append(large.data(), (std::size_t) length);
+}
+
+/**
+ * @brief appends a Complex to out, as its operator<< formats it on a default stream
+ * @param out the text to append to
+ * @param value the number to append
+ * @param precision the stream precision
+ */
+inline void _appendText(std::string& out, const Complex& value, int precision)
+{
+	_appendText(out, value.getReal(), precision);
+	if (value.getImaginary() < 0)
+	{
+		out += " - ";
+		_appendText(out, std::fabs(value.getImaginary()), precision);
+	}
+	else
+	{
+		out += " + ";
+		_appendText(out, value.getImaginary(), precision);
+	}
+	out += 'i';
+}
+
+/**
+ * @brief appends any other element type to out through its operator<<
+ * @param out the text to append to
+ * @param value the element to append
+ * @param precision the stream precision
+ */
+template <typename T>
+void _appendText(std::string& out, const T& value, int precision)
+{
+	std::ostringstream stream;
+	stream.precision(precision);
+	stream << value;
+	out += stream.str();
+}
+
+#endif //MATRIX_MATRIXFORMAT_HPP
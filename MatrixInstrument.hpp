@@ -0,0 +1,457 @@
+#ifndef MATRIX_MATRIXINSTRUMENT_HPP
+#define MATRIX_MATRIXINSTRUMENT_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+
+/**
+ * @def MATRIX_INSTRUMENT
+ * @brief 1 to record the calls, shapes, allocations and latency of the matrix operations, 0 (the
+ * default) to compile the instrumentation out entirely. Define it before including Matrix.hpp.
+ */
+#ifndef MATRIX_INSTRUMENT
+#define MATRIX_INSTRUMENT 0
+#endif
+/**
+ * @def INSTRUMENT_LATENCY_BUCKETS 40
+ * @brief the number of power of 2 latency histogram buckets, the last one is open ended
+ */
+#define INSTRUMENT_LATENCY_BUCKETS 40
+/**
+ * @def INSTRUMENT_DUMP_ENV "MATRIX_INSTRUMENT_DUMP"
+ * @brief the environment variable selecting the report written at exit, "text" or "json"
+ */
+#define INSTRUMENT_DUMP_ENV "MATRIX_INSTRUMENT_DUMP"
+/**
+ * @def INSTRUMENT_FILE_ENV "MATRIX_INSTRUMENT_FILE"
+ * @brief the environment variable naming the file the exit report is written to, stderr if unset
+ */
+#define INSTRUMENT_FILE_ENV "MATRIX_INSTRUMENT_FILE"
+
+/**
+ * @brief the instrumented operations
+ */
+enum InstrumentOp
+{
+	INSTRUMENT_PLUS,
+	INSTRUMENT_MINUS,
+	INSTRUMENT_MULTIPLY,
+	INSTRUMENT_TRANS,
+	INSTRUMENT_CONSTRUCT,
+	INSTRUMENT_EVALUATE,
+	INSTRUMENT_OP_COUNT
+};
+
+/**
+ * @brief returns the report name of the given operation
+ * @param op the operation
+ * @return the operation name
+ */
+inline const char* instrumentOpName(InstrumentOp op)
+{
+	static const char* const names[INSTRUMENT_OP_COUNT] = {"plus", "minus", "multiply", "trans", "construct",
+														   "evaluate"};
+	return names[op];
+}
+
+/**
+ * @brief the statistics recorded for an operation
+ */
+struct InstrumentStats
+{
+	/**
+	 * @brief the number of calls
+	 */
+	unsigned long calls;
+
+	/**
+	 * @brief the total, minimum and maximum latency of the calls in nanoseconds
+	 */
+	double totalNs, minNs, maxNs;
+
+	/**
+	 * @brief latency[k] counts the calls that took [2^k, 2^(k+1)) nanoseconds
+	 */
+	unsigned long latency[INSTRUMENT_LATENCY_BUCKETS];
+
+	/**
+	 * @brief the number of calls of every shape, "rows x cols" or "rows x inner x cols" for products
+	 */
+	std::map<std::string, unsigned long> shapes;
+
+	/**
+	 * @brief creates empty statistics
+	 */
+	InstrumentStats() : calls(0), totalNs(0), minNs(0), maxNs(0), latency() {};
+};
+
+/**
+ * @brief the process wide record of the instrumented matrix operations
+ * Only the outermost instrumented operation of a thread is recorded, so the matrices a product
+ * builds internally count toward its allocated bytes but not as constructor calls. The element
+ * wise operators are lazy: plus and minus record the calls and shapes, and the time to compute
+ * them is recorded by the construction or assignment that evaluates them (evaluate).
+ * The report is written at exit when the MATRIX_INSTRUMENT_DUMP environment variable is "text"
+ * or "json".
+ */
+class MatrixInstrumentation
+{
+	/**
+	 * @brief guards the statistics
+	 */
+	mutable std::mutex statsMutex;
+
+	/**
+	 * @brief the statistics of every operation
+	 */
+	InstrumentStats stats[INSTRUMENT_OP_COUNT];
+
+	/**
+	 * @brief the total size of the matrix storage allocated, in bytes
+	 */
+	unsigned long long allocatedBytes;
+
+	/**
+	 * @brief the number of matrix storage allocations
+	 */
+	unsigned long allocations;
+
+	/**
+	 * @brief creates an empty record
+	 */
+	MatrixInstrumentation() : allocatedBytes(0), allocations(0) {};
+
+public:
+
+	/**
+	 * @brief writes the report selected by the environment
+	 */
+	~MatrixInstrumentation()
+	{
+		const char* format = std::getenv(INSTRUMENT_DUMP_ENV);
+		if (format == nullptr)
+		{
+			return;
+		}
+		const char* path = std::getenv(INSTRUMENT_FILE_ENV);
+		std::ofstream file;
+		if (path != nullptr)
+		{
+			file.open(path);
+		}
+		std::ostream& os = path != nullptr ? static_cast<std::ostream&>(file) : std::cerr;
+		if (std::string(format) == "json")
+		{
+			writeJson(os);
+		}
+		else
+		{
+			writeText(os);
+		}
+	}
+
+	/**
+	 * @brief the record can't be copied
+	 */
+	MatrixInstrumentation(const MatrixInstrumentation&) = delete;
+
+	/**
+	 * @brief the record can't be assigned
+	 */
+	MatrixInstrumentation& operator=(const MatrixInstrumentation&) = delete;
+
+	/**
+	 * @brief returns the process wide record
+	 * @return the record
+	 */
+	static MatrixInstrumentation& instance()
+	{
+		static MatrixInstrumentation record;
+		return record;
+	}
+
+	/**
+	 * @brief records a call
+	 * @param op the operation
+	 * @param shape the shape of the operands
+	 * @param ns the latency in nanoseconds
+	 */
+	void recordCall(InstrumentOp op, const std::string& shape, double ns)
+	{
+		std::lock_guard<std::mutex> lock(statsMutex);
+		InstrumentStats& opStats = stats[op];
+		opStats.minNs = opStats.calls == 0 ? ns : std::min(opStats.minNs, ns);
+		opStats.maxNs = std::max(opStats.maxNs, ns);
+		opStats.totalNs += ns;
+		++opStats.calls;
+		++opStats.shapes[shape];
+		unsigned int bucket = 0;
+		while (bucket + 1 < INSTRUMENT_LATENCY_BUCKETS && ns >= (double) (2ULL << bucket))
+		{
+			++bucket;
+		}
+		++opStats.latency[bucket];
+	}
+
+	/**
+	 * @brief records a matrix storage allocation
+	 * @param bytes the allocated size
+	 */
+	void recordAllocation(std::size_t bytes)
+	{
+		if (bytes == 0)
+		{
+			return;
+		}
+		std::lock_guard<std::mutex> lock(statsMutex);
+		allocatedBytes += bytes;
+		++allocations;
+	}
+
+	/**
+	 * @brief returns a copy of the statistics of an operation
+	 * @param op the operation
+	 * @return the statistics
+	 */
+	InstrumentStats statistics(InstrumentOp op) const
+	{
+		std::lock_guard<std::mutex> lock(statsMutex);
+		return stats[op];
+	}
+
+	/**
+	 * @brief returns the total size of the matrix storage allocated
+	 * @return the allocated bytes
+	 */
+	unsigned long long bytesAllocated() const
+	{
+		std::lock_guard<std::mutex> lock(statsMutex);
+		return allocatedBytes;
+	}
+
+	/**
+	 * @brief clears the record
+	 */
+	void reset()
+	{
+		std::lock_guard<std::mutex> lock(statsMutex);
+		unsigned int op;
+		for (op = 0; op < INSTRUMENT_OP_COUNT; ++op)
+		{
+			stats[op] = InstrumentStats();
+		}
+		allocatedBytes = 0;
+		allocations = 0;
+	}
+
+	/**
+	 * @brief writes a human readable report
+	 * @param os the output stream
+	 */
+	void writeText(std::ostream& os) const
+	{
+		std::lock_guard<std::mutex> lock(statsMutex);
+		os << "matrix instrumentation: " << allocations << " allocations, " << allocatedBytes << " bytes\n";
+		unsigned int op;
+		for (op = 0; op < INSTRUMENT_OP_COUNT; ++op)
+		{
+			const InstrumentStats& opStats = stats[op];
+			if (opStats.calls == 0)
+			{
+				continue;
+			}
+			os << instrumentOpName((InstrumentOp) op) << ": " << opStats.calls << " calls, mean "
+			   << opStats.totalNs / (double) opStats.calls << " ns, min " << opStats.minNs << " ns, max "
+			   << opStats.maxNs << " ns\n";
+			for (const std::pair<const std::string, unsigned long>& shape : opStats.shapes)
+			{
+				os << "\t" << shape.first << ": " << shape.second << "\n";
+			}
+		}
+	}
+
+	/**
+	 * @brief writes a JSON report
+	 * @param os the output stream
+	 */
+	void writeJson(std::ostream& os) const
+	{
+		std::lock_guard<std::mutex> lock(statsMutex);
+		os << "{\"allocations\": " << allocations << ", \"allocated_bytes\": " << allocatedBytes
+		   << ", \"operations\": {";
+		bool firstOp = true;
+		unsigned int op, bucket;
+		for (op = 0; op < INSTRUMENT_OP_COUNT; ++op)
+		{
+			const InstrumentStats& opStats = stats[op];
+			if (opStats.calls == 0)
+			{
+				continue;
+			}
+			os << (firstOp ? "" : ", ") << "\"" << instrumentOpName((InstrumentOp) op) << "\": {\"calls\": "
+			   << opStats.calls << ", \"total_ns\": " << opStats.totalNs << ", \"min_ns\": " << opStats.minNs
+			   << ", \"max_ns\": " << opStats.maxNs << ", \"latency_log2_ns\": [";
+			for (bucket = 0; bucket < INSTRUMENT_LATENCY_BUCKETS; ++bucket)
+			{
+				os << (bucket == 0 ? "" : ", ") << opStats.latency[bucket];
+			}
+			os << "], \"shapes\": {";
+			bool firstShape = true;
+			for (const std::pair<const std::string, unsigned long>& shape : opStats.shapes)
+			{
+				os << (firstShape ? "" : ", ") << "\"" << shape.first << "\": " << shape.second;
+				firstShape = false;
+			}
+			os << "}}";
+			firstOp = false;
+		}
+		os << "}}\n";
+	}
+};
+
+/**
+ * @brief records the latency of the enclosing scope as a call of an operation, unless the scope
+ * is nested in another instrumented operation of the same thread
+ */
+class InstrumentScope
+{
+	/**
+	 * @brief the operation
+	 */
+	InstrumentOp op;
+
+	/**
+	 * @brief the shape of the operands
+	 */
+	unsigned int rows, inner, cols;
+
+	/**
+	 * @brief true if this is the outermost scope of the thread
+	 */
+	bool outermost;
+
+	/**
+	 * @brief the start time
+	 */
+	std::chrono::steady_clock::time_point start;
+
+	/**
+	 * @brief returns the number of instrumented scopes the calling thread is in
+	 * @return the depth of the calling thread
+	 */
+	static unsigned int& _depth()
+	{
+		static thread_local unsigned int depth = 0;
+		return depth;
+	}
+
+	friend class InstrumentNested;
+
+public:
+
+	/**
+	 * @brief starts timing an operation
+	 * @param operation the operation
+	 * @param rows the number of rows of the result
+	 * @param inner the shared dimension of a product, 0 for the other operations
+	 * @param cols the number of columns of the result
+	 */
+	InstrumentScope(InstrumentOp operation, unsigned int rows, unsigned int inner, unsigned int cols) :
+			op(operation), rows(rows), inner(inner), cols(cols), outermost(_depth()++ == 0),
+			start(std::chrono::steady_clock::now()) {};
+
+	/**
+	 * @brief records the call
+	 */
+	~InstrumentScope()
+	{
+		--_depth();
+		if (!outermost)
+		{
+			return;
+		}
+		double ns = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count();
+		std::string shape = std::to_string(rows) + "x" + (inner != 0 ? std::to_string(inner) + "x" : "") +
+							std::to_string(cols);
+		MatrixInstrumentation::instance().recordCall(op, shape, ns);
+	}
+
+	/**
+	 * @brief the scope can't be copied
+	 */
+	InstrumentScope(const InstrumentScope&) = delete;
+
+	/**
+	 * @brief the scope can't be assigned
+	 */
+	InstrumentScope& operator=(const InstrumentScope&) = delete;
+};
+
+/**
+ * @brief marks the enclosing scope as nested in an instrumented operation, for the parts of an
+ * operation forked onto another thread of the pool
+ */
+class InstrumentNested
+{
+public:
+
+	/**
+	 * @brief enters the nested scope
+	 */
+	InstrumentNested()
+	{
+		++InstrumentScope::_depth();
+	}
+
+	/**
+	 * @brief leaves the nested scope
+	 */
+	~InstrumentNested()
+	{
+		--InstrumentScope::_depth();
+	}
+
+	/**
+	 * @brief the scope can't be copied
+	 */
+	InstrumentNested(const InstrumentNested&) = delete;
+
+	/**
+	 * @brief the scope can't be assigned
+	 */
+	InstrumentNested& operator=(const InstrumentNested&) = delete;
+};
+
+#if MATRIX_INSTRUMENT
+/**
+ * @def MATRIX_INSTRUMENT_SCOPE(op, rows, inner, cols)
+ * @brief records the enclosing scope as a call of INSTRUMENT_<op>, nothing when MATRIX_INSTRUMENT is 0
+ */
+#define MATRIX_INSTRUMENT_SCOPE(op, rows, inner, cols) \
+	InstrumentScope _instrumentScope(INSTRUMENT_##op, rows, inner, cols)
+/**
+ * @def MATRIX_INSTRUMENT_ALLOC(bytes)
+ * @brief records an allocation of the given size, nothing when MATRIX_INSTRUMENT is 0
+ */
+#define MATRIX_INSTRUMENT_ALLOC(bytes) MatrixInstrumentation::instance().recordAllocation(bytes)
+/**
+ * @def MATRIX_INSTRUMENT_NESTED()
+ * @brief keeps the operations called in the enclosing scope from being recorded, nothing when
+ * MATRIX_INSTRUMENT is 0
+ */
+#define MATRIX_INSTRUMENT_NESTED() InstrumentNested _instrumentNested
+#else
+#define MATRIX_INSTRUMENT_SCOPE(op, rows, inner, cols) ((void) 0)
+#define MATRIX_INSTRUMENT_ALLOC(bytes) ((void) 0)
+#define MATRIX_INSTRUMENT_NESTED() ((void) 0)
+#endif
+
+#endif //MATRIX_MATRIXINSTRUMENT_HPP
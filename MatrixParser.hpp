@@ -0,0 +1,486 @@
+#ifndef MATRIX_MATRIXPARSER_HPP
+#define MATRIX_MATRIXPARSER_HPP
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <utility>
+#include <stdexcept>
+#include <locale.h>
+#include "Complex.h"
+#include "Matrix.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * @def PARSE_READ_BLOCK 16777216
+ * @brief the number of bytes read from a matrix text file at a time
+ */
+#define PARSE_READ_BLOCK 16777216
+/**
+ * @def PARSE_PARALLEL_MIN_BYTES 1048576
+ * @brief matrix texts smaller than this are parsed by the calling thread only
+ */
+#define PARSE_PARALLEL_MIN_BYTES 1048576
+/**
+ * @def PARSE_CHUNKS_PER_THREAD 4
+ * @brief the number of line aligned chunks per pool thread a large matrix text is split into
+ */
+#define PARSE_CHUNKS_PER_THREAD 4
+/**
+ * @def PARSE_TOKEN_BUFFER 128
+ * @brief number tokens shorter than this are copied to the stack for the strtod fallback
+ */
+#define PARSE_TOKEN_BUFFER 128
+/**
+ * @def PARSE_FILE_EXCEPTION_MSG "cannot read the matrix text file."
+ * @brief the message to add to a matrix text file read exception
+ */
+#define PARSE_FILE_EXCEPTION_MSG "cannot read the matrix text file."
+/**
+ * @def PARSE_FORMAT_EXCEPTION_MSG "the matrix text doesn't match its dimensions."
+ * @brief the message to add to a matrix text format exception
+ */
+#define PARSE_FORMAT_EXCEPTION_MSG "the matrix text doesn't match its dimensions."
+
+/**
+ * @brief returns true if c is a decimal digit, independent of the locale
+ * @param c the character to test
+ * @return true if c is a decimal digit
+ */
+inline bool _isDigit(char c)
+{
+	return (unsigned char) (c - '0') < 10;
+}
+
+/**
+ * @brief returns true if c separates numbers in a matrix text, independent of the locale
+ * @param c the character to test
+ * @return true if c is a space, a tab or a line break
+ */
+inline bool _isSeparator(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/**
+ * @brief returns true if c may continue a number token (letters for exponents, hex, inf and nan)
+ * @param c the character to test
+ * @return true if c may be part of a number
+ */
+inline bool _isNumberChar(char c)
+{
+	return _isDigit(c) || ((unsigned char) ((c | 0x20) - 'a') < 26) || c == '.' || c == '+' || c == '-';
+}
+
+/**
+ * @brief returns the C locale, so the strtod fallback reads a '.' decimal point whatever the
+ * program sets LC_NUMERIC to
+ * @return the C locale, 0 if it can't be created
+ */
+inline locale_t _cLocale()
+{
+	static const locale_t locale = newlocale(LC_ALL_MASK, "C", (locale_t) 0);
+	return locale;
+}
+
+/**
+ * @brief parses a double with strtod in the C locale, for the numbers the fast path doesn't handle
+ * the token is copied to a stack buffer, only tokens of PARSE_TOKEN_BUFFER characters or more
+ * are copied to the heap
+ * @param pos the number start, moved past the number on success
+ * @param end the end of the text
+ * @param value the parsed number
+ * @return true if a number was parsed
+ */
+inline bool _parseDoubleSlow(const char*& pos, const char* end, double& value)
+{
+	const char* last = pos;
+	while (last != end && _isNumberChar(*last))
+	{
+		++last;
+	}
+	const std::size_t length = (std::size_t) (last - pos);
+	char buffer[PARSE_TOKEN_BUFFER];
+	std::string longToken;
+	char* token = buffer;
+	if (length < PARSE_TOKEN_BUFFER)
+	{
+		std::copy(pos, last, buffer);
+		buffer[length] = '\0';
+	}
+	else
+	{
+		longToken.assign(pos, last);
+		token = &longToken[0];
+	}
+	char* parsedEnd;
+	const locale_t locale = _cLocale();
+	double number = locale != (locale_t) 0 ? strtod_l(token, &parsedEnd, locale) : std::strtod(token, &parsedEnd);
+	if (parsedEnd == token)
+	{
+		return false;
+	}
+	value = number;
+	pos += parsedEnd - token;
+	return true;
+}
+
+/**
+ * @brief parses an int at pos: an optional sign followed by decimal digits
+ * values out of the int range are saturated
+ * @param pos the number start, moved past the number on success
+ * @param end the end of the text
+ * @param value the parsed number
+ * @return true if a number was parsed
+ */
+inline bool parseNumber(const char*& pos, const char* end, int& value)
+{
+	const char* p = pos;
+	bool negative = false;
+	if (p != end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		++p;
+	}
+	if (p == end || !_isDigit(*p))
+	{
+		return false;
+	}
+	long long number = 0;
+	for (; p != end && _isDigit(*p); ++p)
+	{
+		if (number <= INT32_MAX)
+		{
+			number = number * 10 + (*p - '0');
+		}
+	}
+	number = negative ? -number : number;
+	value = number > INT32_MAX ? INT32_MAX : (number < INT32_MIN ? INT32_MIN : (int) number);
+	pos = p;
+	return true;
+}
+
+/**
+ * @brief parses a double at pos, in the decimal notation of strtod
+ * Decimal numbers with at most 19 significant digits whose mantissa fits in 53 bits and whose
+ * decimal exponent is at most 22 are converted exactly with a single multiplication or division
+ * (Clinger's fast path). Other numbers, including hex, inf and nan, fall back to strtod in
+ * the C locale, so the result always equals strtod's in the C locale whatever LC_NUMERIC is.
+ * @param pos the number start, moved past the number on success
+ * @param end the end of the text
+ * @param value the parsed number
+ * @return true if a number was parsed
+ */
+inline bool parseNumber(const char*& pos, const char* end, double& value)
+{
+	static const double powersOf10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+										1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+	const char* p = pos;
+	bool negative = false;
+	if (p != end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		++p;
+	}
+
+	std::uint64_t mantissa = 0;
+	int significantDigits = 0, exponent = 0;
+	bool anyDigit = false, truncated = false;
+	for (; p != end && _isDigit(*p); ++p)
+	{
+		anyDigit = true;
+		if (significantDigits < 19)
+		{
+			mantissa = mantissa * 10 + (std::uint64_t) (*p - '0');
+			significantDigits += (mantissa != 0);
+		}
+		else
+		{
+			truncated = true;
+			++exponent;
+		}
+	}
+	if (p != end && *p == '.')
+	{
+		for (++p; p != end && _isDigit(*p); ++p)
+		{
+			anyDigit = true;
+			if (significantDigits < 19)
+			{
+				mantissa = mantissa * 10 + (std::uint64_t) (*p - '0');
+				significantDigits += (mantissa != 0);
+				--exponent;
+			}
+			else
+			{
+				truncated = true;
+			}
+		}
+	}
+	if (!anyDigit)
+	{
+		return _parseDoubleSlow(pos, end, value);
+	}
+	if (p != end && (*p == 'e' || *p == 'E'))
+	{
+		const char* e = p + 1;
+		bool negativeExponent = false;
+		if (e != end && (*e == '-' || *e == '+'))
+		{
+			negativeExponent = (*e == '-');
+			++e;
+		}
+		if (e == end || !_isDigit(*e))
+		{
+			return _parseDoubleSlow(pos, end, value);
+		}
+		int written = 0;
+		for (; e != end && _isDigit(*e); ++e)
+		{
+			if (written < 10000)
+			{
+				written = written * 10 + (*e - '0');
+			}
+		}
+		exponent += negativeExponent ? -written : written;
+		p = e;
+	}
+	if (truncated || mantissa > ((std::uint64_t) 1 << 53) || exponent < -22 || exponent > 22 ||
+		(p != end && _isNumberChar(*p)))
+	{
+		return _parseDoubleSlow(pos, end, value);
+	}
+
+	double number = (double) mantissa;
+	number = exponent < 0 ? number / powersOf10[-exponent] : number * powersOf10[exponent];
+	value = negative ? -number : number;
+	pos = p;
+	return true;
+}
+
+/**
+ * @brief parses a Complex at pos: the real part optionally followed by spaces and the
+ * imaginary part, which is zero when it's missing
+ * @param pos the number start, moved past the number on success
+ * @param end the end of the text
+ * @param value the parsed number
+ * @return true if a number was parsed
+ */
+inline bool parseNumber(const char*& pos, const char* end, Complex& value)
+{
+	double real, imaginary = 0;
+	if (!parseNumber(pos, end, real))
+	{
+		return false;
+	}
+	const char* p = pos;
+	while (p != end && (*p == ' ' || *p == '\t'))
+	{
+		++p;
+	}
+	if (parseNumber(p, end, imaginary))
+	{
+		pos = p;
+	}
+	value = Complex(real, imaginary);
+	return true;
+}
+
+/**
+ * @brief describes how the elements of type T are written in a matrix text, defined for int,
+ * double and Complex: every element is Parts numbers of type Part
+ */
+template <typename T>
+struct MatrixTextElement;
+
+/**
+ * @brief int elements
+ */
+template <>
+struct MatrixTextElement<int>
+{
+	typedef int Part;
+	static const unsigned int parts = 1;
+};
+
+/**
+ * @brief double elements
+ */
+template <>
+struct MatrixTextElement<double>
+{
+	typedef double Part;
+	static const unsigned int parts = 1;
+};
+
+/**
+ * @brief Complex elements, the real part followed by the imaginary part
+ */
+template <>
+struct MatrixTextElement<Complex>
+{
+	static_assert(sizeof(Complex) == 2 * sizeof(double), "Complex should consist of its two double parts");
+
+	typedef double Part;
+	static const unsigned int parts = 2;
+};
+
+/**
+ * @brief returns the number of whitespace separated tokens in [begin, end)
+ * @param begin the text start
+ * @param end the text end
+ * @return the number of tokens
+ */
+inline std::size_t _countTokens(const char* begin, const char* end)
+{
+	std::size_t count = 0;
+	bool inToken = false;
+	for (; begin != end; ++begin)
+	{
+		bool separator = _isSeparator(*begin);
+		count += (!separator && !inToken);
+		inToken = !separator;
+	}
+	return count;
+}
+
+/**
+ * @brief parses a matrix text: the number of rows and columns followed by the elements in row
+ * major order, all separated by whitespace (a Complex element is its real and imaginary parts)
+ * The numbers are parsed locale-free directly into the matrix storage. Large texts are split
+ * into line aligned chunks that are parsed on the thread pool: every chunk counts its numbers
+ * first, so the chunks know where their elements go.
+ * @param text the text start
+ * @param size the text size in bytes
+ * @return the parsed matrix
+ * @throw std::invalid_argument if the text isn't a matrix text of element type T
+ */
+template <typename T>
+Matrix<T> parseMatrixText(const char* text, std::size_t size)
+{
+	typedef typename MatrixTextElement<T>::Part Part;
+	const char* end = text + size;
+	const char* pos = text;
+	int dimensions[2];
+	unsigned int i;
+	for (i = 0; i < 2; ++i)
+	{
+		while (pos != end && _isSeparator(*pos))
+		{
+			++pos;
+		}
+		if (!parseNumber(pos, end, dimensions[i]) || dimensions[i] < 0 || (pos != end && !_isSeparator(*pos)))
+		{
+			throw std::invalid_argument(PARSE_FORMAT_EXCEPTION_MSG);
+		}
+	}
+	const unsigned int rows = (unsigned int) dimensions[0], cols = (unsigned int) dimensions[1];
+	const std::size_t nParts = (std::size_t) rows * cols * MatrixTextElement<T>::parts;
+
+	// split at line boundaries, every chunk starts after a line break
+	unsigned int nChunks = 1;
+	if ((std::size_t) (end - pos) >= PARSE_PARALLEL_MIN_BYTES)
+	{
+		nChunks = ThreadPool::instance().size() * PARSE_CHUNKS_PER_THREAD;
+	}
+	std::vector<const char*> bounds(nChunks + 1, end);
+	bounds[0] = pos;
+	for (i = 1; i < nChunks; ++i)
+	{
+		const char* bound = std::max(bounds[i - 1], pos + (end - pos) / nChunks * i);
+		while (bound != end && *bound != '\n')
+		{
+			++bound;
+		}
+		bounds[i] = bound;
+	}
+
+	std::vector<std::size_t> offsets(nChunks + 1, 0);
+	ThreadPool::instance().parallelFor(nChunks, [&](unsigned int first, unsigned int last)
+	{
+		unsigned int chunk;
+		for (chunk = first; chunk < last; ++chunk)
+		{
+			offsets[chunk + 1] = _countTokens(bounds[chunk], bounds[chunk + 1]);
+		}
+	});
+	for (i = 0; i < nChunks; ++i)
+	{
+		offsets[i + 1] += offsets[i];
+	}
+	if (offsets[nChunks] != nParts)
+	{
+		throw std::invalid_argument(PARSE_FORMAT_EXCEPTION_MSG);
+	}
+
+	std::vector<T> cells((std::size_t) rows * cols);
+	Part* parts = reinterpret_cast<Part*>(cells.data());
+	std::atomic<bool> failed(false);
+	ThreadPool::instance().parallelFor(nChunks, [&](unsigned int first, unsigned int last)
+	{
+		unsigned int chunk;
+		for (chunk = first; chunk < last; ++chunk)
+		{
+			const char* p = bounds[chunk];
+			const char* chunkEnd = bounds[chunk + 1];
+			std::size_t part;
+			for (part = offsets[chunk]; part < offsets[chunk + 1]; ++part)
+			{
+				while (_isSeparator(*p))
+				{
+					++p;
+				}
+				if (!parseNumber(p, chunkEnd, parts[part]) || (p != chunkEnd && !_isSeparator(*p)))
+				{
+					failed = true;
+					return;
+				}
+			}
+		}
+	});
+	if (failed)
+	{
+		throw std::invalid_argument(PARSE_FORMAT_EXCEPTION_MSG);
+	}
+	return Matrix<T>(rows, cols, std::move(cells));
+}
+
+/**
+ * @brief reads a matrix text file, in the format of parseMatrixText
+ * the file is read in blocks of PARSE_READ_BLOCK bytes before it's parsed
+ * @param path the file path
+ * @return the matrix in the file
+ * @throw std::runtime_error if the file can't be read
+ * @throw std::invalid_argument if the file isn't a matrix text of element type T
+ */
+template <typename T>
+Matrix<T> readMatrixText(const std::string& path)
+{
+	std::FILE* file = std::fopen(path.c_str(), "rb");
+	if (file == nullptr)
+	{
+		throw std::runtime_error(PARSE_FILE_EXCEPTION_MSG);
+	}
+	std::vector<char> text;
+	std::size_t size = 0, read;
+	do
+	{
+		text.resize(size + PARSE_READ_BLOCK);
+		read = std::fread(text.data() + size, 1, PARSE_READ_BLOCK, file);
+		size += read;
+	} while (read == PARSE_READ_BLOCK);
+	bool failed = std::ferror(file) != 0;
+	std::fclose(file);
+	if (failed)
+	{
+		throw std::runtime_error(PARSE_FILE_EXCEPTION_MSG);
+	}
+	return parseMatrixText<T>(text.data(), size);
+}
+
+#endif //MATRIX_MATRIXPARSER_HPP
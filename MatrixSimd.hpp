@@ -0,0 +1,732 @@
+#ifndef MATRIX_MATRIXSIMD_HPP
+#define MATRIX_MATRIXSIMD_HPP
+
+#include <cstddef>
+#include <cmath>
+#include <limits>
+#include "Complex.h"
+
+/**
+ * @def MATRIX_SIMD_X86
+ * @brief defined when the explicit x86 vector kernels are compiled in
+ */
+#if defined(__GNUC__) && defined(__x86_64__)
+#define MATRIX_SIMD_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * @def SIMD_LEVEL_SSE2 0
+ * @brief the SSE2 instruction set, always available on x86-64
+ */
+#define SIMD_LEVEL_SSE2 0
+/**
+ * @def SIMD_LEVEL_AVX2 1
+ * @brief the AVX2 instruction set
+ */
+#define SIMD_LEVEL_AVX2 1
+/**
+ * @def SIMD_LEVEL_AVX512 2
+ * @brief the AVX-512 foundation instruction set
+ */
+#define SIMD_LEVEL_AVX512 2
+
+/**
+ * @brief element-wise kernels over contiguous arrays used by the matrix operators
+ * The generic version is a plain loop, int, double and Complex have explicit vector
+ * versions picked at runtime by the instruction sets the cpu supports.
+ * The kernels give exactly the results of the element operators of T.
+ */
+template <typename T>
+struct ElementKernels
+{
+	/**
+	 * @brief out[i] = lhs[i] + rhs[i]
+	 * @param lhs left operand array
+	 * @param rhs right operand array
+	 * @param out output array
+	 * @param n number of elements
+	 */
+	static void add(const T* lhs, const T* rhs, T* out, std::size_t n)
+	{
+		std::size_t i;
+		for (i = 0; i < n; ++i)
+		{
+			out[i] = lhs[i] + rhs[i];
+		}
+	}
+
+	/**
+	 * @brief out[i] = lhs[i] - rhs[i]
+	 * @param lhs left operand array
+	 * @param rhs right operand array
+	 * @param out output array
+	 * @param n number of elements
+	 */
+	static void sub(const T* lhs, const T* rhs, T* out, std::size_t n)
+	{
+		std::size_t i;
+		for (i = 0; i < n; ++i)
+		{
+			out[i] = lhs[i] - rhs[i];
+		}
+	}
+
+	/**
+	 * @brief returns true if lhs[i] == rhs[i] for every i
+	 * @param lhs left operand array
+	 * @param rhs right operand array
+	 * @param n number of elements
+	 * @return true if all the elements are equal, otherwise false
+	 */
+	static bool equal(const T* lhs, const T* rhs, std::size_t n)
+	{
+		std::size_t i;
+		for (i = 0; i < n; ++i)
+		{
+			if (lhs[i] != rhs[i])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+#ifdef MATRIX_SIMD_X86
+
+/**
+ * @brief returns the best instruction set supported by the cpu, detected once
+ * @return one of the SIMD_LEVEL_ values
+ */
+inline int simdLevel()
+{
+	static const int level = __builtin_cpu_supports("avx512f") ? SIMD_LEVEL_AVX512 :
+							 __builtin_cpu_supports("avx2") ? SIMD_LEVEL_AVX2 : SIMD_LEVEL_SSE2;
+	return level;
+}
+
+//-------------------------- double kernels ---------------------------
+
+/**
+ * @brief double add, AVX-512
+ */
+__attribute__((target("avx512f")))
+inline void _addDoubleAvx512(const double* lhs, const double* rhs, double* out, std::size_t n)
+{
+	std::size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		_mm512_storeu_pd(out + i, _mm512_add_pd(_mm512_loadu_pd(lhs + i), _mm512_loadu_pd(rhs + i)));
+	}
+	for (; i < n; ++i)
+	{
+		out[i] = lhs[i] + rhs[i];
+	}
+}
+
+/**
+ * @brief double add, AVX2
+ */
+__attribute__((target("avx2")))
+inline void _addDoubleAvx2(const double* lhs, const double* rhs, double* out, std::size_t n)
+{
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		_mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(lhs + i), _mm256_loadu_pd(rhs + i)));
+	}
+	for (; i < n; ++i)
+	{
+		out[i] = lhs[i] + rhs[i];
+	}
+}
+
+/**
+ * @brief double add, SSE2
+ */
+inline void _addDoubleSse2(const double* lhs, const double* rhs, double* out, std::size_t n)
+{
+	std::size_t i = 0;
+	for (; i + 2 <= n; i += 2)
+	{
+		_mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(lhs + i), _mm_loadu_pd(rhs + i)));
+	}
+	for (; i < n; ++i)
+	{
+		out[i] = lhs[i] + rhs[i];
+	}
+}
+
+/**
+ * @brief double subtract, AVX-512
+ */
+__attribute__((target("avx512f")))
+inline void _subDoubleAvx512(const double* lhs, const double* rhs, double* out, std::size_t n)
+{
+	std::size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		_mm512_storeu_pd(out + i, _mm512_sub_pd(_mm512_loadu_pd(lhs + i), _mm512_loadu_pd(rhs + i)));
+	}
+	for (; i < n; ++i)
+	{
+		out[i] = lhs[i] - rhs[i];
+	}
+}
+
+/**
+ * @brief double subtract, AVX2
+ */
+__attribute__((target("avx2")))
+inline void _subDoubleAvx2(const double* lhs, const double* rhs, double* out, std::size_t n)
+{
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		_mm256_storeu_pd(out + i, _mm256_sub_pd(_mm256_loadu_pd(lhs + i), _mm256_loadu_pd(rhs + i)));
+	}
+	for (; i < n; ++i)
+	{
+		out[i] = lhs[i] - rhs[i];
+	}
+}
+
+/**
+ * @brief double subtract, SSE2
+ */
+inline void _subDoubleSse2(const double* lhs, const double* rhs, double* out, std::size_t n)
+{
+	std::size_t i = 0;
+	for (; i + 2 <= n; i += 2)
+	{
+		_mm_storeu_pd(out + i, _mm_sub_pd(_mm_loadu_pd(lhs + i), _mm_loadu_pd(rhs + i)));
+	}
+	for (; i < n; ++i)
+	{
+		out[i] = lhs[i] - rhs[i];
+	}
+}
+
+/**
+ * @brief double equality (NaN is never equal), AVX-512
+ */
+__attribute__((target("avx512f")))
+inline bool _equalDoubleAvx512(const double* lhs, const double* rhs, std::size_t n)
+{
+	std::size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		if (_mm512_cmp_pd_mask(_mm512_loadu_pd(lhs + i), _mm512_loadu_pd(rhs + i), _CMP_NEQ_UQ) != 0)
+		{
+			return false;
+		}
+	}
+	for (; i < n; ++i)
+	{
+		if (lhs[i] != rhs[i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief double equality (NaN is never equal), AVX2
+ */
+__attribute__((target("avx2")))
+inline bool _equalDoubleAvx2(const double* lhs, const double* rhs, std::size_t n)
+{
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		if (_mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(lhs + i), _mm256_loadu_pd(rhs + i),
+											 _CMP_NEQ_UQ)) != 0)
+		{
+			return false;
+		}
+	}
+	for (; i < n; ++i)
+	{
+		if (lhs[i] != rhs[i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief double equality (NaN is never equal), SSE2
+ */
+inline bool _equalDoubleSse2(const double* lhs, const double* rhs, std::size_t n)
+{
+	std::size_t i = 0;
+	for (; i + 2 <= n; i += 2)
+	{
+		if (_mm_movemask_pd(_mm_cmpneq_pd(_mm_loadu_pd(lhs + i), _mm_loadu_pd(rhs + i))) != 0)
+		{
+			return false;
+		}
+	}
+	for (; i < n; ++i)
+	{
+		if (lhs[i] != rhs[i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Complex equality on interleaved (real, imaginary) pairs, AVX-512
+ * a pair is equal when both parts differ by less than epsilon, like Complex::operator==
+ */
+__attribute__((target("avx512f")))
+inline bool _closeDoubleAvx512(const double* lhs, const double* rhs, std::size_t n)
+{
+	const __m512d eps = _mm512_set1_pd(std::numeric_limits<double>::epsilon());
+	const __m512i absMask = _mm512_set1_epi64(0x7FFFFFFFFFFFFFFFLL);
+	std::size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m512d diff = _mm512_sub_pd(_mm512_loadu_pd(lhs + i), _mm512_loadu_pd(rhs + i));
+		__m512d absDiff = _mm512_castsi512_pd(_mm512_and_si512(_mm512_castpd_si512(diff), absMask));
+		if (_mm512_cmp_pd_mask(absDiff, eps, _CMP_NLT_UQ) != 0)
+		{
+			return false;
+		}
+	}
+	for (; i < n; ++i)
+	{
+		if (!(std::fabs(lhs[i] - rhs[i]) < std::numeric_limits<double>::epsilon()))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Complex equality on interleaved (real, imaginary) pairs, AVX2
+ */
+__attribute__((target("avx2")))
+inline bool _closeDoubleAvx2(const double* lhs, const double* rhs, std::size_t n)
+{
+	const __m256d eps = _mm256_set1_pd(std::numeric_limits<double>::epsilon());
+	const __m256d signMask = _mm256_set1_pd(-0.0);
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		__m256d diff = _mm256_sub_pd(_mm256_loadu_pd(lhs + i), _mm256_loadu_pd(rhs + i));
+		__m256d absDiff = _mm256_andnot_pd(signMask, diff);
+		if (_mm256_movemask_pd(_mm256_cmp_pd(absDiff, eps, _CMP_NLT_UQ)) != 0)
+		{
+			return false;
+		}
+	}
+	for (; i < n; ++i)
+	{
+		if (!(std::fabs(lhs[i] - rhs[i]) < std::numeric_limits<double>::epsilon()))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Complex equality on interleaved (real, imaginary) pairs, SSE2
+ */
+inline bool _closeDoubleSse2(const double* lhs, const double* rhs, std::size_t n)
+{
+	const __m128d eps = _mm_set1_pd(std::numeric_limits<double>::epsilon());
+	const __m128d signMask = _mm_set1_pd(-0.0);
+	std::size_t i = 0;
+	for (; i + 2 <= n; i += 2)
+	{
+		__m128d diff = _mm_sub_pd(_mm_loadu_pd(lhs + i), _mm_loadu_pd(rhs + i));
+		__m128d absDiff = _mm_andnot_pd(signMask, diff);
+		if (_mm_movemask_pd(_mm_cmpnlt_pd(absDiff, eps)) != 0)
+		{
+			return false;
+		}
+	}
+	for (; i < n; ++i)
+	{
+		if (!(std::fabs(lhs[i] - rhs[i]) < std::numeric_limits<double>::epsilon()))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//-------------------------- int kernels ---------------------------
+
+/**
+ * @brief int add, AVX-512
+ */
+__attribute__((target("avx512f")))
+inline void _addIntAvx512(const int* lhs, const int* rhs, int* out, std::size_t n)
+{
+	std::size_t i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		__m512i sum = _mm512_add_epi32(_mm512_loadu_si512(lhs + i), _mm512_loadu_si512(rhs + i));
+		_mm512_storeu_si512(out + i, sum);
+	}
+	for (; i < n; ++i)
+	{
+		out[i] = lhs[i] + rhs[i];
+	}
+}
+
+/**
+ * @brief int add, AVX2
+ */
+__attribute__((target("avx2")))
+inline void _addIntAvx2(const int* lhs, const int* rhs, int* out, std::size_t n)
+{
+	std::size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256i sum = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*) (lhs + i)),
+									   _mm256_loadu_si256((const __m256i*) (rhs + i)));
+		_mm256_storeu_si256((__m256i*) (out + i), sum);
+	}
+	for (; i < n; ++i)
+	{
+		out[i] = lhs[i] + rhs[i];
+	}
+}
+
+/**
+ * @brief int add, SSE2
+ */
+inline void _addIntSse2(const int* lhs, const int* rhs, int* out, std::size_t n)
+{
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		__m128i sum = _mm_add_epi32(_mm_loadu_si128((const __m128i*) (lhs + i)),
+									_mm_loadu_si128((const __m128i*) (rhs + i)));
+		_mm_storeu_si128((__m128i*) (out + i), sum);
+	}
+	for (; i < n; ++i)
+	{
+		out[i] = lhs[i] + rhs[i];
+	}
+}
+
+/**
+ * @brief int subtract, AVX-512
+ */
+__attribute__((target("avx512f")))
+inline void _subIntAvx512(const int* lhs, const int* rhs, int* out, std::size_t n)
+{
+	std::size_t i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		__m512i diff = _mm512_sub_epi32(_mm512_loadu_si512(lhs + i), _mm512_loadu_si512(rhs + i));
+		_mm512_storeu_si512(out + i, diff);
+	}
+	for (; i < n; ++i)
+	{
+		out[i] = lhs[i] - rhs[i];
+	}
+}
+
+/**
+ * @brief int subtract, AVX2
+ */
+__attribute__((target("avx2")))
+inline void _subIntAvx2(const int* lhs, const int* rhs, int* out, std::size_t n)
+{
+	std::size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256i diff = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*) (lhs + i)),
+										_mm256_loadu_si256((const __m256i*) (rhs + i)));
+		_mm256_storeu_si256((__m256i*) (out + i), diff);
+	}
+	for (; i < n; ++i)
+	{
+		out[i] = lhs[i] - rhs[i];
+	}
+}
+
+/**
+ * @brief int subtract, SSE2
+ */
+inline void _subIntSse2(const int* lhs, const int* rhs, int* out, std::size_t n)
+{
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		__m128i diff = _mm_sub_epi32(_mm_loadu_si128((const __m128i*) (lhs + i)),
+									 _mm_loadu_si128((const __m128i*) (rhs + i)));
+		_mm_storeu_si128((__m128i*) (out + i), diff);
+	}
+	for (; i < n; ++i)
+	{
+		out[i] = lhs[i] - rhs[i];
+	}
+}
+
+/**
+ * @brief int equality, AVX-512
+ */
+__attribute__((target("avx512f")))
+inline bool _equalIntAvx512(const int* lhs, const int* rhs, std::size_t n)
+{
+	std::size_t i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		if (_mm512_cmpneq_epi32_mask(_mm512_loadu_si512(lhs + i), _mm512_loadu_si512(rhs + i)) != 0)
+		{
+			return false;
+		}
+	}
+	for (; i < n; ++i)
+	{
+		if (lhs[i] != rhs[i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief int equality, AVX2
+ */
+__attribute__((target("avx2")))
+inline bool _equalIntAvx2(const int* lhs, const int* rhs, std::size_t n)
+{
+	std::size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*) (lhs + i)),
+										_mm256_loadu_si256((const __m256i*) (rhs + i)));
+		if (_mm256_movemask_epi8(eq) != -1)
+		{
+			return false;
+		}
+	}
+	for (; i < n; ++i)
+	{
+		if (lhs[i] != rhs[i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief int equality, SSE2
+ */
+inline bool _equalIntSse2(const int* lhs, const int* rhs, std::size_t n)
+{
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		__m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*) (lhs + i)),
+									 _mm_loadu_si128((const __m128i*) (rhs + i)));
+		if (_mm_movemask_epi8(eq) != 0xFFFF)
+		{
+			return false;
+		}
+	}
+	for (; i < n; ++i)
+	{
+		if (lhs[i] != rhs[i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//-------------------------- dispatching specializations ---------------------------
+
+/**
+ * @brief double kernels
+ */
+template <>
+struct ElementKernels<double>
+{
+	static void add(const double* lhs, const double* rhs, double* out, std::size_t n)
+	{
+		switch (simdLevel())
+		{
+			case SIMD_LEVEL_AVX512:
+				_addDoubleAvx512(lhs, rhs, out, n);
+				break;
+			case SIMD_LEVEL_AVX2:
+				_addDoubleAvx2(lhs, rhs, out, n);
+				break;
+			default:
+				_addDoubleSse2(lhs, rhs, out, n);
+		}
+	}
+
+	static void sub(const double* lhs, const double* rhs, double* out, std::size_t n)
+	{
+		switch (simdLevel())
+		{
+			case SIMD_LEVEL_AVX512:
+				_subDoubleAvx512(lhs, rhs, out, n);
+				break;
+			case SIMD_LEVEL_AVX2:
+				_subDoubleAvx2(lhs, rhs, out, n);
+				break;
+			default:
+				_subDoubleSse2(lhs, rhs, out, n);
+		}
+	}
+
+	static bool equal(const double* lhs, const double* rhs, std::size_t n)
+	{
+		switch (simdLevel())
+		{
+			case SIMD_LEVEL_AVX512:
+				return _equalDoubleAvx512(lhs, rhs, n);
+			case SIMD_LEVEL_AVX2:
+				return _equalDoubleAvx2(lhs, rhs, n);
+			default:
+				return _equalDoubleSse2(lhs, rhs, n);
+		}
+	}
+};
+
+/**
+ * @brief int kernels
+ */
+template <>
+struct ElementKernels<int>
+{
+	static void add(const int* lhs, const int* rhs, int* out, std::size_t n)
+	{
+		switch (simdLevel())
+		{
+			case SIMD_LEVEL_AVX512:
+				_addIntAvx512(lhs, rhs, out, n);
+				break;
+			case SIMD_LEVEL_AVX2:
+				_addIntAvx2(lhs, rhs, out, n);
+				break;
+			default:
+				_addIntSse2(lhs, rhs, out, n);
+		}
+	}
+
+	static void sub(const int* lhs, const int* rhs, int* out, std::size_t n)
+	{
+		switch (simdLevel())
+		{
+			case SIMD_LEVEL_AVX512:
+				_subIntAvx512(lhs, rhs, out, n);
+				break;
+			case SIMD_LEVEL_AVX2:
+				_subIntAvx2(lhs, rhs, out, n);
+				break;
+			default:
+				_subIntSse2(lhs, rhs, out, n);
+		}
+	}
+
+	static bool equal(const int* lhs, const int* rhs, std::size_t n)
+	{
+		switch (simdLevel())
+		{
+			case SIMD_LEVEL_AVX512:
+				return _equalIntAvx512(lhs, rhs, n);
+			case SIMD_LEVEL_AVX2:
+				return _equalIntAvx2(lhs, rhs, n);
+			default:
+				return _equalIntSse2(lhs, rhs, n);
+		}
+	}
+};
+
+#endif //MATRIX_SIMD_X86
+
+/**
+ * @brief returns true if |lhs[i] - rhs[i]| < epsilon for every i, the per part test of
+ * Complex::operator== applied to arrays of real or imaginary parts
+ * @param lhs left operand parts
+ * @param rhs right operand parts
+ * @param n number of parts
+ * @return true if all the parts are close, otherwise false
+ */
+inline bool partsClose(const double* lhs, const double* rhs, std::size_t n)
+{
+#ifdef MATRIX_SIMD_X86
+	switch (simdLevel())
+	{
+		case SIMD_LEVEL_AVX512:
+			return _closeDoubleAvx512(lhs, rhs, n);
+		case SIMD_LEVEL_AVX2:
+			return _closeDoubleAvx2(lhs, rhs, n);
+		default:
+			return _closeDoubleSse2(lhs, rhs, n);
+	}
+#else
+	std::size_t i;
+	for (i = 0; i < n; ++i)
+	{
+		if (!(std::fabs(lhs[i] - rhs[i]) < std::numeric_limits<double>::epsilon()))
+		{
+			return false;
+		}
+	}
+	return true;
+#endif
+}
+
+#ifdef MATRIX_SIMD_X86
+
+/**
+ * @brief Complex kernels, a Complex array is handled as an array of interleaved
+ * (real, imaginary) doubles
+ */
+template <>
+struct ElementKernels<Complex>
+{
+	static_assert(sizeof(Complex) == 2 * sizeof(double), "Complex must be a pair of doubles");
+
+	static void add(const Complex* lhs, const Complex* rhs, Complex* out, std::size_t n)
+	{
+		ElementKernels<double>::add(_parts(lhs), _parts(rhs), _parts(out), 2 * n);
+	}
+
+	static void sub(const Complex* lhs, const Complex* rhs, Complex* out, std::size_t n)
+	{
+		ElementKernels<double>::sub(_parts(lhs), _parts(rhs), _parts(out), 2 * n);
+	}
+
+	static bool equal(const Complex* lhs, const Complex* rhs, std::size_t n)
+	{
+		return partsClose(_parts(lhs), _parts(rhs), 2 * n);
+	}
+
+private:
+
+	static const double* _parts(const Complex* ptr)
+	{
+		return reinterpret_cast<const double*>(ptr);
+	}
+
+	static double* _parts(Complex* ptr)
+	{
+		return reinterpret_cast<double*>(ptr);
+	}
+};
+
+#endif //MATRIX_SIMD_X86
+
+#endif //MATRIX_MATRIXSIMD_HPP
@@ -0,0 +1,523 @@
+#ifndef MATRIX_MATRIXSTREAM_HPP
+#define MATRIX_MATRIXSTREAM_HPP
+
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Matrix.hpp"
+#include "MatrixFile.hpp"
+
+/**
+ * @def STREAM_DEFAULT_MEMORY_LIMIT 256MiB
+ * @brief the default number of bytes the panels of a streaming multiplication may hold
+ */
+#define STREAM_DEFAULT_MEMORY_LIMIT ((std::size_t) 256 << 20)
+/**
+ * @def STREAM_ROWS_EXCEPTION_MSG "the rows are out of the matrix file."
+ * @brief the message to add to a matrix file row range exception
+ */
+#define STREAM_ROWS_EXCEPTION_MSG "the rows are out of the matrix file."
+/**
+ * @def STREAM_PANEL_EXCEPTION_MSG "the panel doesn't fit the matrix file."
+ * @brief the message to add to a matrix file panel exception
+ */
+#define STREAM_PANEL_EXCEPTION_MSG "the panel doesn't fit the matrix file."
+
+/**
+ * @brief reads row panels of a binary matrix file, without holding the rest of the file in memory
+ */
+template <typename T>
+class MatrixFileReader
+{
+	/**
+	 * @brief the open file
+	 */
+	int fd;
+
+	/**
+	 * @brief the number of columns in the matrix;
+	 */
+	unsigned int nCols;
+
+	/**
+	 * @brief the number of rows in the matrix;
+	 */
+	unsigned int nRows;
+
+	/**
+	 * @brief returns the file offset of the given row
+	 * @param row the row
+	 * @return the offset of the first element of the row
+	 */
+	off_t _offsetOf(unsigned int row) const
+	{
+		return (off_t) (sizeof(MatrixFileHeader) + (std::size_t) row * nCols * sizeof(T));
+	}
+
+public:
+
+	/**
+	 * @brief opens the given binary matrix file
+	 * @param path the file path
+	 * @throw std::runtime_error if the file can't be opened, isn't a matrix file of element type T
+	 * or was written with a different byte order
+	 */
+	explicit MatrixFileReader(const std::string& path) : fd(open(path.c_str(), O_RDONLY)), nCols(0), nRows(0)
+	{
+		if (fd < 0)
+		{
+			throw std::runtime_error(MATRIX_FILE_OPEN_EXCEPTION_MSG);
+		}
+		MatrixFileHeader header;
+		struct stat status;
+		const char* error = MATRIX_FILE_FORMAT_EXCEPTION_MSG;
+		if (fstat(fd, &status) == 0 && (std::size_t) status.st_size >= sizeof(header) &&
+			pread(fd, &header, sizeof(header), 0) == (ssize_t) sizeof(header))
+		{
+			error = _matrixFileError<T>(header, (std::size_t) status.st_size);
+		}
+		if (error != nullptr)
+		{
+			close(fd);
+			throw std::runtime_error(error);
+		}
+		nRows = (unsigned int) header.rows;
+		nCols = (unsigned int) header.cols;
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	}
+
+	/**
+	 * @brief closes the file
+	 */
+	~MatrixFileReader()
+	{
+		close(fd);
+	}
+
+	/**
+	 * @brief the file can't be copied
+	 */
+	MatrixFileReader(const MatrixFileReader&) = delete;
+
+	/**
+	 * @brief the file can't be assigned
+	 */
+	MatrixFileReader& operator=(const MatrixFileReader&) = delete;
+
+	/**
+	 * @brief returns the number of rows in the matrix
+	 * @return the number of rows in the matrix
+	 */
+	unsigned int rows() const
+	{
+		return nRows;
+	}
+
+	/**
+	 * @brief returns the number of columns in the matrix
+	 * @return the number of columns in the matrix
+	 */
+	unsigned int cols() const
+	{
+		return nCols;
+	}
+
+	/**
+	 * @brief reads a panel of consecutive rows
+	 * @param first the first row of the panel
+	 * @param count the number of rows in the panel
+	 * @return count x cols() matrix of the rows
+	 * @throw std::out_of_range if the rows are out of the matrix
+	 * @throw std::runtime_error if the file can't be read
+	 */
+	Matrix<T> readRows(unsigned int first, unsigned int count) const
+	{
+		if (first > nRows || count > nRows - first)
+		{
+			throw std::out_of_range(STREAM_ROWS_EXCEPTION_MSG);
+		}
+		std::vector<T> cells((std::size_t) count * nCols);
+		char* data = reinterpret_cast<char*>(cells.data());
+		std::size_t size = cells.size() * sizeof(T);
+		off_t offset = _offsetOf(first);
+		while (size > 0)
+		{
+			ssize_t done = pread(fd, data, size, offset);
+			if (done <= 0)
+			{
+				throw std::runtime_error(MATRIX_FILE_OPEN_EXCEPTION_MSG);
+			}
+			data += done;
+			size -= (std::size_t) done;
+			offset += done;
+		}
+		return Matrix<T>(count, nCols, std::move(cells));
+	}
+
+	/**
+	 * @brief asks the kernel to start reading a panel that's read later, so the disk works
+	 * while the current panel is multiplied
+	 * @param first the first row of the panel
+	 * @param count the number of rows in the panel
+	 */
+	void prefetchRows(unsigned int first, unsigned int count) const
+	{
+		if (first < nRows && count > 0)
+		{
+			count = std::min(count, nRows - first);
+			posix_fadvise(fd, _offsetOf(first), (off_t) ((std::size_t) count * nCols * sizeof(T)),
+						  POSIX_FADV_WILLNEED);
+		}
+	}
+};
+
+/**
+ * @brief writes a binary matrix file incrementally, one row panel after the other
+ */
+template <typename T>
+class MatrixFileWriter
+{
+	/**
+	 * @brief the open file, nullptr once closed
+	 */
+	std::FILE* file;
+
+	/**
+	 * @brief the number of columns in the matrix;
+	 */
+	unsigned int nCols;
+
+	/**
+	 * @brief the number of rows in the matrix;
+	 */
+	unsigned int nRows;
+
+	/**
+	 * @brief the number of rows written so far
+	 */
+	unsigned int nWritten;
+
+public:
+
+	/**
+	 * @brief creates the given binary matrix file and writes its header
+	 * @param path the file path, an existing file is replaced
+	 * @param rows the number of rows the file will hold
+	 * @param cols the number of columns
+	 * @throw std::runtime_error if the file can't be written
+	 */
+	MatrixFileWriter(const std::string& path, unsigned int rows, unsigned int cols) :
+			file(std::fopen(path.c_str(), "wb")), nCols(cols), nRows(rows), nWritten(0)
+	{
+		if (file == nullptr)
+		{
+			throw std::runtime_error(MATRIX_FILE_OPEN_EXCEPTION_MSG);
+		}
+		MatrixFileHeader header = _matrixFileHeader<T>(rows, cols);
+		if (std::fwrite(&header, sizeof(header), 1, file) != 1)
+		{
+			std::fclose(file);
+			throw std::runtime_error(MATRIX_FILE_WRITE_EXCEPTION_MSG);
+		}
+	}
+
+	/**
+	 * @brief closes the file if close() wasn't called, the file may be incomplete
+	 */
+	~MatrixFileWriter()
+	{
+		if (file != nullptr)
+		{
+			std::fclose(file);
+		}
+	}
+
+	/**
+	 * @brief the file can't be copied
+	 */
+	MatrixFileWriter(const MatrixFileWriter&) = delete;
+
+	/**
+	 * @brief the file can't be assigned
+	 */
+	MatrixFileWriter& operator=(const MatrixFileWriter&) = delete;
+
+	/**
+	 * @brief appends the rows of the given panel after the rows written so far
+	 * @param panel the rows to write, with cols() columns
+	 * @throw std::invalid_argument if the panel has a different number of columns or more rows
+	 * than are left in the file
+	 * @throw std::runtime_error if the file can't be written
+	 */
+	void write(const Matrix<T>& panel)
+	{
+		if (file == nullptr || panel.cols() != nCols || panel.rows() > nRows - nWritten)
+		{
+			throw std::invalid_argument(STREAM_PANEL_EXCEPTION_MSG);
+		}
+		std::size_t size = (std::size_t) panel.rows() * panel.cols();
+		if (size != 0 && std::fwrite(&*panel.begin(), sizeof(T), size, file) != size)
+		{
+			throw std::runtime_error(MATRIX_FILE_WRITE_EXCEPTION_MSG);
+		}
+		nWritten += panel.rows();
+	}
+
+	/**
+	 * @brief flushes and closes the file
+	 * @throw std::invalid_argument if fewer rows than the file holds were written
+	 * @throw std::runtime_error if the file can't be written
+	 */
+	void close()
+	{
+		if (file == nullptr || nWritten != nRows)
+		{
+			throw std::invalid_argument(STREAM_PANEL_EXCEPTION_MSG);
+		}
+		std::FILE* closed = file;
+		file = nullptr;
+		if (std::fclose(closed) != 0)
+		{
+			throw std::runtime_error(MATRIX_FILE_WRITE_EXCEPTION_MSG);
+		}
+	}
+};
+
+/**
+ * @brief returns the number of rows of a panel, so that perRow elements for each row fit in
+ * the given number of elements, at least 1 and at most rows
+ * @param budget the number of elements the panels may hold
+ * @param perRow the number of elements held for each row of the panel
+ * @param rows the number of rows to split into panels
+ * @return the number of rows in a panel
+ */
+inline unsigned int _panelRows(std::size_t budget, std::size_t perRow, unsigned int rows)
+{
+	std::size_t panelRows = perRow == 0 ? rows : budget / perRow;
+	return (unsigned int) std::max<std::size_t>(1, std::min<std::size_t>(panelRows, rows));
+}
+
+/**
+ * @brief multiplies row panels by a resident right matrix with the in-memory kernels, the right
+ * matrix is packed for the blocked kernel once instead of once for every panel
+ */
+template <typename T>
+class PanelMultiplier
+{
+	/**
+	 * @brief the right matrix
+	 */
+	const Matrix<T>& rhs;
+
+	/**
+	 * @brief rhs packed for the blocked kernel, empty until a panel takes that kernel
+	 */
+	std::vector<T> packed;
+
+public:
+
+	/**
+	 * @brief creates a multiplier by the given matrix
+	 * @param rhs the right matrix, it should outlive the multiplier
+	 */
+	explicit PanelMultiplier(const Matrix<T>& rhs) : rhs(rhs) {};
+
+	/**
+	 * @brief multiplies the given panel by the right matrix
+	 * @param panel the panel, its column number should equal the row number of the right matrix
+	 * @return A matrix that equals (panel * rhs)
+	 * @throw std::invalid_argument if the matrices sizes don't match
+	 */
+	Matrix<T> multiply(const Matrix<T>& panel)
+	{
+		if (panel.cols() != rhs.rows())
+		{
+			throw std::invalid_argument(MULTIPLICATION_EXCEPTION_MSG);
+		}
+		if (MatrixSettings<T>::strassen || MatrixSettings<T>::gaussMultiply ||
+			(unsigned long) panel.rows() * panel.cols() * rhs.cols() < BLOCKED_MULT_MIN_OPS)
+		{
+			// the opt-in algorithms and the iterative kernel don't pack rhs
+			return panel * rhs;
+		}
+		MATRIX_INSTRUMENT_SCOPE(MULTIPLY, panel.rows(), panel.cols(), rhs.cols());
+		if (packed.empty())
+		{
+			packed = Matrix<T>::_pack(rhs);
+		}
+		Matrix<T> result(panel.rows(), rhs.cols());
+		panel._multiplyPacked(packed, rhs.cols(), result);
+		return result;
+	}
+};
+
+/**
+ * @brief multiplies the matrix in a binary matrix file by a matrix in memory and writes the
+ * product to a binary matrix file, one row panel at a time: a panel of rows of lhs is read,
+ * multiplied by rhs with the in-memory kernels and written before the next panel is read.
+ * The panels are sized so that a panel of lhs and the matching panel of the product fit in
+ * memoryLimit bytes, besides rhs itself and the copy of rhs the blocked kernel packs once for
+ * all the panels; at least one row is read at a time.
+ * Each product element is computed as by lhs * rhs in memory.
+ * @param lhsPath the binary matrix file of the left matrix
+ * @param rhs the right matrix
+ * @param resultPath the binary matrix file to write the product to, an existing file is replaced
+ * @param memoryLimit the number of bytes the panels may hold
+ * @throw std::invalid_argument if the matrices sizes don't match
+ * @throw std::runtime_error if a file can't be read or written
+ */
+template <typename T>
+void streamMultiply(const std::string& lhsPath, const Matrix<T>& rhs, const std::string& resultPath,
+					std::size_t memoryLimit = STREAM_DEFAULT_MEMORY_LIMIT)
+{
+	MatrixFileReader<T> lhs(lhsPath);
+	if (lhs.cols() != rhs.rows())
+	{
+		throw std::invalid_argument(MULTIPLICATION_EXCEPTION_MSG);
+	}
+	MatrixFileWriter<T> result(resultPath, lhs.rows(), rhs.cols());
+	unsigned int panelRows = _panelRows(memoryLimit / sizeof(T), (std::size_t) lhs.cols() + rhs.cols(),
+										lhs.rows());
+	PanelMultiplier<T> multiplier(rhs);
+	for (unsigned int first = 0; first < lhs.rows(); first += panelRows)
+	{
+		unsigned int count = std::min(panelRows, lhs.rows() - first);
+		Matrix<T> panel = lhs.readRows(first, count);
+		lhs.prefetchRows(first + count, panelRows);
+		result.write(multiplier.multiply(panel));
+	}
+	result.close();
+}
+
+/**
+ * @brief multiplies the matrix in a binary matrix file by the transpose of the matrix in
+ * another (or the same) binary matrix file, as lhs * rhs.trans(), and writes the product to a
+ * binary matrix file. Neither matrix is held in memory: for each row panel of lhs the rows of
+ * rhs are streamed in panels, and each lhs panel times a transposed rhs panel fills a block of
+ * columns of the product panel, which is written once it's complete.
+ * Storing the transpose of the right matrix lets the multiplication read it in rows; with the
+ * same file on both sides it computes a matrix times its own transpose.
+ * The panels are sized so that a panel of lhs, a panel of rhs, their product and a panel of the
+ * product fit in memoryLimit bytes; at least one row is read at a time. rhs is read once for
+ * every panel of lhs, so a larger limit saves reading.
+ * Each product element is computed as by lhs * rhs.transView() in memory.
+ * @param lhsPath the binary matrix file of the left matrix
+ * @param rhsPath the binary matrix file of the transpose of the right matrix
+ * @param resultPath the binary matrix file to write the product to, an existing file is replaced
+ * @param memoryLimit the number of bytes the panels may hold
+ * @throw std::invalid_argument if the matrices sizes don't match
+ * @throw std::runtime_error if a file can't be read or written
+ */
+template <typename T>
+void streamMultiplyTrans(const std::string& lhsPath, const std::string& rhsPath, const std::string& resultPath,
+						 std::size_t memoryLimit = STREAM_DEFAULT_MEMORY_LIMIT)
+{
+	MatrixFileReader<T> lhs(lhsPath);
+	MatrixFileReader<T> rhs(rhsPath);
+	if (lhs.cols() != rhs.cols())
+	{
+		throw std::invalid_argument(MULTIPLICATION_EXCEPTION_MSG);
+	}
+	MatrixFileWriter<T> result(resultPath, lhs.rows(), rhs.rows());
+	// half of the budget streams rhs, the other half holds the lhs and product panels
+	std::size_t budget = memoryLimit / sizeof(T);
+	unsigned int rhsRows = _panelRows(budget / 2, rhs.cols(), rhs.rows());
+	std::size_t rhsSize = (std::size_t) rhsRows * rhs.cols();
+	unsigned int lhsRows = _panelRows(budget > rhsSize ? budget - rhsSize : 0,
+									  (std::size_t) lhs.cols() + rhsRows + rhs.rows(), lhs.rows());
+	for (unsigned int first = 0; first < lhs.rows(); first += lhsRows)
+	{
+		unsigned int count = std::min(lhsRows, lhs.rows() - first);
+		Matrix<T> panel = lhs.readRows(first, count);
+		Matrix<T> product(count, rhs.rows());
+		for (unsigned int rhsFirst = 0; rhsFirst < rhs.rows(); rhsFirst += rhsRows)
+		{
+			unsigned int rhsCount = std::min(rhsRows, rhs.rows() - rhsFirst);
+			Matrix<T> rhsPanel = rhs.readRows(rhsFirst, rhsCount);
+			rhs.prefetchRows(rhsFirst + rhsCount < rhs.rows() ? rhsFirst + rhsCount : 0, rhsRows);
+			Matrix<T> block = panel * rhsPanel.transView();
+			for (unsigned int i = 0; i < count; ++i)
+			{
+				std::copy(&block.unchecked(i, 0), &block.unchecked(i, 0) + rhsCount, &product.unchecked(i, rhsFirst));
+			}
+		}
+		lhs.prefetchRows(first + count, lhsRows);
+		result.write(product);
+	}
+	result.close();
+}
+
+/**
+ * @brief multiplies the transpose of the matrix in a binary matrix file by the matrix in another
+ * (or the same) binary matrix file with as many rows, as lhs.trans() * rhs, and returns the
+ * product, which has lhs.cols() x rhs.cols() elements and stays in memory. Both files are read
+ * once, in panels of the same rows, and every panel adds its products to the result; with the
+ * same file on both sides it computes the Gram matrix of a tall matrix, A.trans() * A, without
+ * holding A.
+ * The panels are sized so that a panel of lhs and a panel of rhs fit in memoryLimit bytes,
+ * besides the result; at least one row is read at a time.
+ * Each product element is computed as by lhs.transView() * rhs in memory.
+ * @param lhsPath the binary matrix file of the transposed left matrix
+ * @param rhsPath the binary matrix file of the right matrix
+ * @param memoryLimit the number of bytes the panels may hold
+ * @return A matrix that equals (lhs.trans() * rhs)
+ * @throw std::invalid_argument if the matrices sizes don't match
+ * @throw std::runtime_error if a file can't be read
+ */
+template <typename T>
+Matrix<T> streamTransMultiply(const std::string& lhsPath, const std::string& rhsPath,
+							  std::size_t memoryLimit = STREAM_DEFAULT_MEMORY_LIMIT)
+{
+	MatrixFileReader<T> lhs(lhsPath);
+	MatrixFileReader<T> rhs(rhsPath);
+	if (lhs.rows() != rhs.rows())
+	{
+		throw std::invalid_argument(MULTIPLICATION_EXCEPTION_MSG);
+	}
+	Matrix<T> result(lhs.cols(), rhs.cols());
+	if (lhs.cols() == 0 || rhs.cols() == 0)
+	{
+		return result;
+	}
+	// the same file is read once for both sides
+	const bool same = lhsPath == rhsPath;
+	unsigned int panelRows = _panelRows(memoryLimit / sizeof(T),
+										(std::size_t) lhs.cols() + (same ? 0 : rhs.cols()), lhs.rows());
+	for (unsigned int first = 0; first < lhs.rows(); first += panelRows)
+	{
+		unsigned int count = std::min(panelRows, lhs.rows() - first);
+		Matrix<T> lhsPanel = lhs.readRows(first, count);
+		Matrix<T> rhsPanel = same ? Matrix<T>(0, 0) : rhs.readRows(first, count);
+		const Matrix<T>& rhsRows = same ? lhsPanel : rhsPanel;
+		lhs.prefetchRows(first + count, panelRows);
+		if (!same)
+		{
+			rhs.prefetchRows(first + count, panelRows);
+		}
+		// result row i accumulates the rhs rows scaled by the (transposed) elements of lhs
+		// column i, in increasing row order like the in-memory product
+		for (unsigned int k = 0; k < count; ++k)
+		{
+			const T* rhsRow = &rhsRows.unchecked(k, 0);
+			for (unsigned int i = 0; i < lhs.cols(); ++i)
+			{
+				const T element = _transElement(lhsPanel.unchecked(k, i));
+				T* resultRow = &result.unchecked(i, 0);
+				for (unsigned int j = 0; j < rhs.cols(); ++j)
+				{
+					resultRow[j] = resultRow[j] + element * rhsRow[j];
+				}
+			}
+		}
+	}
+	return result;
+}
+
+#endif //MATRIX_MATRIXSTREAM_HPP
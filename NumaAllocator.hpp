@@ -0,0 +1,390 @@
+#ifndef MATRIX_NUMAALLOCATOR_HPP
+#define MATRIX_NUMAALLOCATOR_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <unistd.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#include "Matrix.hpp"
+
+/**
+ * @def NUMA_NODES_ENV "MATRIX_NUMA_NODES"
+ * @brief the environment variable setting a fake number of NUMA nodes, for testing the split of
+ * the storage on a single node machine
+ */
+#define NUMA_NODES_ENV "MATRIX_NUMA_NODES"
+/**
+ * @def NUMA_NODE_PATH "/sys/devices/system/node/node"
+ * @brief the sysfs directory prefix of the NUMA nodes
+ */
+#define NUMA_NODE_PATH "/sys/devices/system/node/node"
+/**
+ * @def NUMA_MIN_BYTES 1MiB
+ * @brief smaller allocations come from the heap, their pages are shared with other allocations
+ */
+#define NUMA_MIN_BYTES ((std::size_t) 1 << 20)
+/**
+ * @def NUMA_MAX_NODES 64
+ * @brief the number of nodes a placement node mask holds
+ */
+#define NUMA_MAX_NODES 64
+/**
+ * @def NUMA_MPOL_PREFERRED 1
+ * @brief the Linux memory policy preferring a single node
+ */
+#define NUMA_MPOL_PREFERRED 1
+/**
+ * @def NUMA_MPOL_INTERLEAVE 3
+ * @brief the Linux memory policy interleaving pages over a set of nodes
+ */
+#define NUMA_MPOL_INTERLEAVE 3
+/**
+ * @def NUMA_MPOL_F_ADDR 2
+ * @brief get_mempolicy flag returning the policy of the range containing an address
+ */
+#define NUMA_MPOL_F_ADDR 2
+
+/**
+ * @brief the NUMA placement policies of the matrix storage
+ */
+enum NumaPolicy
+{
+	/**
+	 * @brief the storage is split into as many contiguous row blocks as there are nodes, block k
+	 * prefers node k, so its pages are placed there whichever thread touches them first
+	 */
+	NUMA_FIRST_TOUCH,
+	/**
+	 * @brief the pages are spread round robin over the nodes, for matrices read by every thread
+	 */
+	NUMA_INTERLEAVE
+};
+
+/**
+ * @brief the NUMA nodes of the machine, detected from sysfs or faked for testing
+ */
+class NumaTopology
+{
+	/**
+	 * @brief the number of detected nodes
+	 */
+	unsigned int detected;
+
+	/**
+	 * @brief the number of fake nodes, 0 to use the detected nodes
+	 */
+	unsigned int fake;
+
+	/**
+	 * @brief detects the nodes, reads the fake node count from NUMA_NODES_ENV
+	 */
+	NumaTopology() : detected(_detectNodes()), fake(0)
+	{
+		const char* nodes = std::getenv(NUMA_NODES_ENV);
+		if (nodes != nullptr && std::atoi(nodes) > 0)
+		{
+			fake = (unsigned int) std::atoi(nodes);
+		}
+	}
+
+public:
+
+	/**
+	 * @brief returns the process wide topology
+	 * @return the topology
+	 */
+	static NumaTopology& instance()
+	{
+		static NumaTopology topology;
+		return topology;
+	}
+
+	/**
+	 * @brief returns the number of nodes the storage is placed on
+	 * @return the number of nodes, at least 1
+	 */
+	unsigned int nodes() const
+	{
+		return fake != 0 ? fake : detected;
+	}
+
+	/**
+	 * @brief returns true if the nodes are fake, the storage is then split by pageNode() but
+	 * isn't bound to any node
+	 * @return true if the nodes are fake
+	 */
+	bool isFake() const
+	{
+		return fake != 0;
+	}
+
+	/**
+	 * @brief sets a fake number of nodes
+	 * @param nodes the number of fake nodes, 0 to use the detected nodes again
+	 */
+	void setFakeNodes(unsigned int nodes)
+	{
+		fake = std::min<unsigned int>(nodes, NUMA_MAX_NODES);
+	}
+
+	/**
+	 * @brief returns the node a page of an allocation is placed on
+	 * @param policy the placement policy
+	 * @param page the page index
+	 * @param nPages the number of pages of the allocation
+	 * @return the node of the page
+	 */
+	unsigned int pageNode(NumaPolicy policy, std::size_t page, std::size_t nPages) const
+	{
+		if (policy == NUMA_INTERLEAVE)
+		{
+			return (unsigned int) (page % nodes());
+		}
+		return (unsigned int) (page * nodes() / nPages);
+	}
+
+	/**
+	 * @brief reads the memory policy the kernel applies to the page containing an address
+	 * @param address the address
+	 * @param mode set to the policy mode, NUMA_MPOL_PREFERRED or NUMA_MPOL_INTERLEAVE when bound
+	 * @param mask set to the nodes of the policy, bit k for node k
+	 * @return false if the kernel doesn't report memory policies
+	 */
+	static bool pagePolicy(const void* address, int& mode, unsigned long& mask)
+	{
+#ifdef __linux__
+		mask = 0;
+		return syscall(SYS_get_mempolicy, &mode, &mask, NUMA_MAX_NODES + 1, address, NUMA_MPOL_F_ADDR) == 0;
+#else
+		(void) address;
+		(void) mode;
+		(void) mask;
+		return false;
+#endif
+	}
+
+	/**
+	 * @brief the topology can't be copied
+	 */
+	NumaTopology(const NumaTopology&) = delete;
+
+	/**
+	 * @brief the topology can't be assigned
+	 */
+	NumaTopology& operator=(const NumaTopology&) = delete;
+
+private:
+
+	/**
+	 * @brief counts the consecutive node directories in sysfs
+	 * @return the number of nodes, 1 if there's no NUMA information
+	 */
+	static unsigned int _detectNodes()
+	{
+		unsigned int nodes = 0;
+		while (nodes < NUMA_MAX_NODES &&
+			   std::ifstream((NUMA_NODE_PATH + std::to_string(nodes) + "/cpulist").c_str()).good())
+		{
+			++nodes;
+		}
+		return nodes != 0 ? nodes : 1;
+	}
+};
+
+/**
+ * @brief an allocator placing large storage on the NUMA nodes of the machine
+ * Storage of at least NUMA_MIN_BYTES is mapped directly and bound to the nodes by the policy
+ * with mbind before any page is touched. The work stealing pool doesn't pin its threads to
+ * nodes, so the kernel policy places the pages, not the thread that faults them in.
+ * With fake nodes the storage isn't bound.
+ * @tparam Policy the placement policy
+ */
+template <typename T, NumaPolicy Policy = NUMA_FIRST_TOUCH>
+class NumaAllocator
+{
+	static_assert(alignof(T) <= alignof(std::max_align_t), "the heap buffers are aligned for max_align_t");
+
+public:
+
+	/**
+	 * @brief the allocated type
+	 */
+	typedef T value_type;
+
+	/**
+	 * @brief every numa allocator can free the buffers of every other
+	 */
+	typedef std::true_type is_always_equal;
+
+	/**
+	 * @brief the numa allocator of another type, with the same policy
+	 */
+	template <typename U>
+	struct rebind
+	{
+		typedef NumaAllocator<U, Policy> other;
+	};
+
+	/**
+	 * @brief creates an allocator
+	 */
+	NumaAllocator() noexcept {};
+
+	/**
+	 * @brief creates an allocator of T from an allocator of another type
+	 */
+	template <typename U>
+	NumaAllocator(const NumaAllocator<U, Policy>&) noexcept {};
+
+	/**
+	 * @brief allocates storage for n elements, placed on the nodes if it's large
+	 * @param n the number of elements
+	 * @return the storage
+	 * @throw std::bad_alloc if the storage can't be allocated
+	 */
+	T* allocate(std::size_t n)
+	{
+		if (n > (std::size_t) -1 / sizeof(T))
+		{
+			throw std::bad_alloc();
+		}
+		const std::size_t bytes = n * sizeof(T);
+		void* block;
+		if (bytes < NUMA_MIN_BYTES)
+		{
+			block = std::malloc(bytes != 0 ? bytes : 1);
+		}
+		else
+		{
+			block = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (block == MAP_FAILED)
+			{
+				block = nullptr;
+			}
+			else
+			{
+				_place(static_cast<char*>(block), bytes);
+			}
+		}
+		if (block == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+		return static_cast<T*>(block);
+	}
+
+	/**
+	 * @brief frees the storage of n elements
+	 * @param block the storage
+	 * @param n the number of elements
+	 */
+	void deallocate(T* block, std::size_t n) noexcept
+	{
+		if (n * sizeof(T) < NUMA_MIN_BYTES)
+		{
+			std::free(block);
+			return;
+		}
+		munmap(block, n * sizeof(T));
+	}
+
+private:
+
+	/**
+	 * @brief binds the pages of a fresh mapping to the nodes by the policy, unless the nodes
+	 * are fake
+	 * @param block the mapping
+	 * @param bytes the mapping size
+	 */
+	static void _place(char* block, std::size_t bytes)
+	{
+#ifdef __linux__
+		const NumaTopology& topology = NumaTopology::instance();
+		if (!topology.isFake())
+		{
+			const std::size_t pageSize = (std::size_t) sysconf(_SC_PAGESIZE);
+			_bind(block, pageSize, (bytes + pageSize - 1) / pageSize, topology);
+		}
+#else
+		(void) block;
+		(void) bytes;
+#endif
+	}
+
+#ifdef __linux__
+	/**
+	 * @brief applies the policy to the pages of a fresh mapping with mbind, failures are ignored
+	 * since the placement is only a hint
+	 * @param block the mapping
+	 * @param pageSize the page size
+	 * @param nPages the number of pages
+	 * @param topology the nodes
+	 */
+	static void _bind(char* block, std::size_t pageSize, std::size_t nPages, const NumaTopology& topology)
+	{
+		const unsigned int nodes = topology.nodes();
+		if (Policy == NUMA_INTERLEAVE)
+		{
+			unsigned long mask = nodes >= NUMA_MAX_NODES ? ~0UL : (1UL << nodes) - 1;
+			syscall(SYS_mbind, block, nPages * pageSize, NUMA_MPOL_INTERLEAVE, &mask, NUMA_MAX_NODES + 1, 0);
+			return;
+		}
+		std::size_t first = 0;
+		while (first < nPages)
+		{
+			const unsigned int node = topology.pageNode(Policy, first, nPages);
+			std::size_t last = first + 1;
+			while (last < nPages && topology.pageNode(Policy, last, nPages) == node)
+			{
+				++last;
+			}
+			unsigned long mask = 1UL << node;
+			syscall(SYS_mbind, block + first * pageSize, (last - first) * pageSize, NUMA_MPOL_PREFERRED, &mask,
+					NUMA_MAX_NODES + 1, 0);
+			first = last;
+		}
+	}
+#endif
+};
+
+/**
+ * @brief numa allocators with the same policy are interchangeable
+ * @return true
+ */
+template <typename T, typename U, NumaPolicy Policy>
+bool operator==(const NumaAllocator<T, Policy>&, const NumaAllocator<U, Policy>&)
+{
+	return true;
+}
+
+/**
+ * @brief numa allocators with the same policy are interchangeable
+ * @return false
+ */
+template <typename T, typename U, NumaPolicy Policy>
+bool operator!=(const NumaAllocator<T, Policy>&, const NumaAllocator<U, Policy>&)
+{
+	return false;
+}
+
+/**
+ * @brief a matrix whose row blocks are placed on the nodes that compute on them
+ */
+template <typename T>
+using NumaMatrix = Matrix<T, NumaAllocator<T>>;
+
+/**
+ * @brief a matrix whose pages are interleaved over the nodes
+ */
+template <typename T>
+using InterleavedMatrix = Matrix<T, NumaAllocator<T, NUMA_INTERLEAVE>>;
+
+#endif //MATRIX_NUMAALLOCATOR_HPP
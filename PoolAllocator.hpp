@@ -0,0 +1,299 @@
+#ifndef MATRIX_POOLALLOCATOR_HPP
+#define MATRIX_POOLALLOCATOR_HPP
+
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <unordered_map>
+#include <type_traits>
+#include "Matrix.hpp"
+
+/**
+ * @def POOL_MAX_BLOCKS_PER_SIZE 8
+ * @brief the number of free buffers of a single size a thread keeps for reuse
+ */
+#define POOL_MAX_BLOCKS_PER_SIZE 8
+/**
+ * @def POOL_MAX_CACHED_BYTES 256MiB
+ * @brief the number of bytes of free buffers a thread keeps for reuse
+ */
+#define POOL_MAX_CACHED_BYTES ((std::size_t) 256 << 20)
+/**
+ * @def POOL_MAX_SIZES 64
+ * @brief the number of buffer sizes a thread keeps an entry for, emptied entries are kept so
+ * reusing a buffer doesn't rebuild its entry, they are dropped when new sizes need the room
+ */
+#define POOL_MAX_SIZES 64
+
+/**
+ * @brief a per thread cache of freed buffers, keyed by their exact size in bytes
+ * A freed buffer is kept for the next allocation of the same size on the same thread, so a
+ * loop repeating operations of the same shape reuses its buffers and allocates nothing after
+ * the first iteration. Buffers of other sizes and buffers over the cache limits go to the
+ * global heap. A buffer may be freed on another thread than the one that allocated it, it's
+ * then cached by the freeing thread.
+ */
+class BufferPool
+{
+	/**
+	 * @brief the free buffers of every size
+	 */
+	std::unordered_map<std::size_t, std::vector<void*>> freeBlocks;
+
+	/**
+	 * @brief the total size of the free buffers
+	 */
+	std::size_t cachedSize;
+
+	/**
+	 * @brief returns the flag that's set once the pool of the calling thread is destroyed,
+	 * buffers freed later (e.g. by static matrices) go straight to the heap
+	 * @return the destroyed flag of the calling thread
+	 */
+	static bool& _destroyed()
+	{
+		static thread_local bool destroyed = false;
+		return destroyed;
+	}
+
+	/**
+	 * @brief creates an empty pool
+	 */
+	BufferPool() : cachedSize(0) {};
+
+public:
+
+	/**
+	 * @brief frees the cached buffers
+	 */
+	~BufferPool()
+	{
+		for (auto& blocks : freeBlocks)
+		{
+			for (void* block : blocks.second)
+			{
+				::operator delete(block);
+			}
+		}
+		_destroyed() = true;
+	}
+
+	/**
+	 * @brief the pool can't be copied
+	 */
+	BufferPool(const BufferPool&) = delete;
+
+	/**
+	 * @brief the pool can't be assigned
+	 */
+	BufferPool& operator=(const BufferPool&) = delete;
+
+	/**
+	 * @brief returns the pool of the calling thread
+	 * @return the pool of the calling thread, nullptr while the thread exits
+	 */
+	static BufferPool* local()
+	{
+		if (_destroyed())
+		{
+			return nullptr;
+		}
+		static thread_local BufferPool pool;
+		return &pool;
+	}
+
+	/**
+	 * @brief returns a buffer of the given size, a cached one if there is one
+	 * @param size the buffer size in bytes
+	 * @return the buffer
+	 * @throw std::bad_alloc if the buffer can't be allocated
+	 */
+	void* allocate(std::size_t size)
+	{
+		auto found = freeBlocks.find(size);
+		if (found == freeBlocks.end() || found->second.empty())
+		{
+			return ::operator new(size);
+		}
+		void* block = found->second.back();
+		found->second.pop_back();
+		cachedSize -= size;
+		return block;
+	}
+
+	/**
+	 * @brief keeps the given buffer for reuse, or frees it if the cache is full
+	 * @param block the buffer
+	 * @param size the buffer size in bytes
+	 */
+	void deallocate(void* block, std::size_t size) noexcept
+	{
+		if (cachedSize + size <= POOL_MAX_CACHED_BYTES)
+		{
+			try
+			{
+				if (freeBlocks.size() >= POOL_MAX_SIZES && freeBlocks.find(size) == freeBlocks.end() &&
+					!_dropEmptySizes())
+				{
+					::operator delete(block);
+					return;
+				}
+				std::vector<void*>& blocks = freeBlocks[size];
+				if (blocks.capacity() == 0)
+				{
+					blocks.reserve(POOL_MAX_BLOCKS_PER_SIZE);
+				}
+				if (blocks.size() < POOL_MAX_BLOCKS_PER_SIZE)
+				{
+					blocks.push_back(block);
+					cachedSize += size;
+					return;
+				}
+			}
+			catch (const std::bad_alloc&)
+			{
+			}
+		}
+		::operator delete(block);
+	}
+
+	/**
+	 * @brief returns the total size of the cached buffers
+	 * @return the cached size in bytes
+	 */
+	std::size_t cachedBytes() const
+	{
+		return cachedSize;
+	}
+
+	/**
+	 * @brief returns the number of buffer sizes the pool keeps an entry for, at most POOL_MAX_SIZES
+	 * @return the number of cached sizes
+	 */
+	std::size_t cachedSizes() const
+	{
+		return freeBlocks.size();
+	}
+
+private:
+
+	/**
+	 * @brief drops the entries of the sizes that have no cached buffer
+	 * @return false if every size has cached buffers
+	 */
+	bool _dropEmptySizes()
+	{
+		bool dropped = false;
+		auto entry = freeBlocks.begin();
+		while (entry != freeBlocks.end())
+		{
+			if (entry->second.empty())
+			{
+				entry = freeBlocks.erase(entry);
+				dropped = true;
+			}
+			else
+			{
+				++entry;
+			}
+		}
+		return dropped;
+	}
+};
+
+/**
+ * @brief a stateless allocator that takes its buffers from the BufferPool of the calling thread
+ * Matrices of the same shape use buffers of the same size, so Matrix<T, PoolAllocator<T>> reuses
+ * the storage of its temporaries instead of going to the global heap every operation, and
+ * threads don't contend on the heap for them.
+ */
+template <typename T>
+class PoolAllocator
+{
+	static_assert(alignof(T) <= alignof(std::max_align_t), "the pool buffers are aligned for max_align_t");
+
+public:
+
+	/**
+	 * @brief the allocated type
+	 */
+	typedef T value_type;
+
+	/**
+	 * @brief every pool allocator can free the buffers of every other
+	 */
+	typedef std::true_type is_always_equal;
+
+	/**
+	 * @brief creates an allocator
+	 */
+	PoolAllocator() noexcept {};
+
+	/**
+	 * @brief creates an allocator of T from an allocator of another type
+	 */
+	template <typename U>
+	PoolAllocator(const PoolAllocator<U>&) noexcept {};
+
+	/**
+	 * @brief allocates storage for n elements
+	 * @param n the number of elements
+	 * @return the storage
+	 * @throw std::bad_alloc if the storage can't be allocated
+	 */
+	T* allocate(std::size_t n)
+	{
+		if (n > (std::size_t) -1 / sizeof(T))
+		{
+			throw std::bad_alloc();
+		}
+		BufferPool* pool = BufferPool::local();
+		return static_cast<T*>(pool != nullptr ? pool->allocate(n * sizeof(T)) : ::operator new(n * sizeof(T)));
+	}
+
+	/**
+	 * @brief frees the storage of n elements
+	 * @param block the storage
+	 * @param n the number of elements
+	 */
+	void deallocate(T* block, std::size_t n) noexcept
+	{
+		BufferPool* pool = BufferPool::local();
+		if (pool != nullptr)
+		{
+			pool->deallocate(block, n * sizeof(T));
+		}
+		else
+		{
+			::operator delete(block);
+		}
+	}
+};
+
+/**
+ * @brief pool allocators are interchangeable
+ * @return true
+ */
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&)
+{
+	return true;
+}
+
+/**
+ * @brief pool allocators are interchangeable
+ * @return false
+ */
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&)
+{
+	return false;
+}
+
+/**
+ * @brief a matrix whose storage comes from the thread local buffer pool
+ */
+template <typename T>
+using PooledMatrix = Matrix<T, PoolAllocator<T>>;
+
+#endif //MATRIX_POOLALLOCATOR_HPP
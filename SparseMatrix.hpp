@@ -0,0 +1,404 @@
+#ifndef MATRIX_SPARSEMATRIX_HPP
+#define MATRIX_SPARSEMATRIX_HPP
+
+#include <cstddef>
+#include <algorithm>
+#include <vector>
+#include <stdexcept>
+#include <utility>
+#include "Matrix.hpp"
+
+/**
+ * @def SPARSE_MAX_DENSITY 0.1
+ * @brief the default fraction of non zero elements up to which a matrix is worth storing sparse
+ */
+#define SPARSE_MAX_DENSITY 0.1
+/**
+ * @def SPARSE_STRUCTURE_EXCEPTION_MSG "the row starts and column indices don't form a sparse matrix."
+ * @brief the message to add to a sparse matrix structure exception
+ */
+#define SPARSE_STRUCTURE_EXCEPTION_MSG "the row starts and column indices don't form a sparse matrix."
+
+/**
+ * @brief returns true if the element isn't exactly zero and so has to be stored
+ * @param element the element to check
+ * @return true if the element differs from T()
+ */
+template <typename T>
+bool _isStored(const T& element)
+{
+	return element != T();
+}
+
+/**
+ * @brief a complex element is stored unless both parts are exactly zero, Complex::operator!=
+ * compares with a tolerance and would drop tiny elements
+ * @param element the element to check
+ * @return true if either part isn't zero
+ */
+inline bool _isStored(const Complex& element)
+{
+	return element.getReal() != 0 || element.getImaginary() != 0;
+}
+
+/**
+ * @brief a sparse matrix in compressed sparse row (CSR) form
+ * Only the non zero elements are stored, row after row, each with its column index, and
+ * rowStarts[i] is the position of the first element of row i. The transpose of a CSR matrix
+ * holds the compressed sparse column (CSC) form of the matrix, so column wise access goes
+ * through trans(). Products and sums only visit the stored elements.
+ */
+template <typename T>
+class SparseMatrix
+{
+	/**
+	 * @brief the non zero elements, row major
+	 */
+	std::vector<T> values;
+
+	/**
+	 * @brief the column of every stored element, ascending within a row
+	 */
+	std::vector<unsigned int> colIndices;
+
+	/**
+	 * @brief the position of the first element of every row in values, followed by values.size()
+	 */
+	std::vector<std::size_t> rowStarts;
+
+	/**
+	 * @brief the number of columns in the matrix;
+	 */
+	unsigned int nCols;
+
+	/**
+	 * @brief the number of rows in the matrix;
+	 */
+	unsigned int nRows;
+
+public:
+
+	/**
+	 * @brief creates a matrix with the given row and column sizes, all zeroes
+	 * @param rows number of rows
+	 * @param cols number of columns
+	 */
+	SparseMatrix(unsigned int rows, unsigned int cols) : rowStarts((std::size_t) rows + 1, 0), nCols(cols),
+														 nRows(rows) {};
+
+	/**
+	 * @brief constructs a matrix that adopts the given compressed rows
+	 * @param rows number of rows
+	 * @param cols number of columns
+	 * @param starts the position of the first element of every row, followed by the number of elements
+	 * @param columns the column of every element, ascending within a row
+	 * @param elements the elements, row after row
+	 * @throw std::invalid_argument if the arrays don't form a rows x cols matrix
+	 */
+	SparseMatrix(unsigned int rows, unsigned int cols, std::vector<std::size_t> starts,
+				 std::vector<unsigned int> columns, std::vector<T> elements) :
+			values(std::move(elements)), colIndices(std::move(columns)), rowStarts(std::move(starts)),
+			nCols(cols), nRows(rows)
+	{
+		if (rowStarts.size() != (std::size_t) rows + 1 || rowStarts.front() != 0 ||
+			rowStarts.back() != values.size() || colIndices.size() != values.size())
+		{
+			throw std::invalid_argument(SPARSE_STRUCTURE_EXCEPTION_MSG);
+		}
+		unsigned int i;
+		for (i = 0; i < nRows; ++i)
+		{
+			if (rowStarts[i] > rowStarts[i + 1])
+			{
+				throw std::invalid_argument(SPARSE_STRUCTURE_EXCEPTION_MSG);
+			}
+			std::size_t k;
+			for (k = rowStarts[i]; k < rowStarts[i + 1]; ++k)
+			{
+				if (colIndices[k] >= nCols || (k > rowStarts[i] && colIndices[k] <= colIndices[k - 1]))
+				{
+					throw std::invalid_argument(SPARSE_STRUCTURE_EXCEPTION_MSG);
+				}
+			}
+		}
+	}
+
+	/**
+	 * @brief compresses the non zero elements of a dense matrix
+	 * @param dense the matrix to compress
+	 */
+	explicit SparseMatrix(const Matrix<T>& dense) : SparseMatrix(dense.rows(), dense.cols())
+	{
+		unsigned int i, j;
+		for (i = 0; i < nRows; ++i)
+		{
+			const T* row = &dense.matrix[dense._getIndex(i, 0)];
+			for (j = 0; j < nCols; ++j)
+			{
+				if (_isStored(row[j]))
+				{
+					values.push_back(row[j]);
+					colIndices.push_back(j);
+				}
+			}
+			rowStarts[i + 1] = values.size();
+		}
+	}
+
+	/**
+	 * @brief returns the dense matrix with the same elements
+	 * @return rows() x cols() matrix
+	 */
+	Matrix<T> toMatrix() const
+	{
+		Matrix<T> dense(nRows, nCols);
+		unsigned int i;
+		for (i = 0; i < nRows; ++i)
+		{
+			std::size_t k;
+			for (k = rowStarts[i]; k < rowStarts[i + 1]; ++k)
+			{
+				dense.matrix[dense._getIndex(i, colIndices[k])] = values[k];
+			}
+		}
+		return dense;
+	}
+
+	/**
+	 * @brief adds two sparse matrices, merging the stored elements row by row
+	 * @param rhs sparse matrix to add
+	 * @return the sum, with an element wherever either matrix stores one
+	 * @throw std::invalid_argument if the matrices sizes don't match
+	 */
+	SparseMatrix<T> operator+(const SparseMatrix<T>& rhs) const
+	{
+		if (nRows != rhs.nRows || nCols != rhs.nCols)
+		{
+			throw std::invalid_argument(ADDITION_EXCEPTION_MSG);
+		}
+		SparseMatrix<T> sum(nRows, nCols);
+		sum.values.reserve(std::max(values.size(), rhs.values.size()));
+		sum.colIndices.reserve(sum.values.capacity());
+		unsigned int i;
+		for (i = 0; i < nRows; ++i)
+		{
+			std::size_t k = rowStarts[i], l = rhs.rowStarts[i];
+			while (k < rowStarts[i + 1] || l < rhs.rowStarts[i + 1])
+			{
+				if (l == rhs.rowStarts[i + 1] || (k < rowStarts[i + 1] && colIndices[k] < rhs.colIndices[l]))
+				{
+					sum.values.push_back(values[k]);
+					sum.colIndices.push_back(colIndices[k++]);
+				}
+				else if (k == rowStarts[i + 1] || rhs.colIndices[l] < colIndices[k])
+				{
+					sum.values.push_back(rhs.values[l]);
+					sum.colIndices.push_back(rhs.colIndices[l++]);
+				}
+				else
+				{
+					sum.values.push_back(values[k++] + rhs.values[l]);
+					sum.colIndices.push_back(rhs.colIndices[l++]);
+				}
+			}
+			sum.rowStarts[i + 1] = sum.values.size();
+		}
+		return sum;
+	}
+
+	/**
+	 * @brief multiplies the matrix by a dense vector (SpMV)
+	 * @param vector the cols() elements to multiply by
+	 * @return the rows() elements of the product
+	 * @throw std::invalid_argument if the vector size doesn't match the columns
+	 */
+	std::vector<T> operator*(const std::vector<T>& vector) const
+	{
+		if (vector.size() != nCols)
+		{
+			throw std::invalid_argument(MULTIPLICATION_EXCEPTION_MSG);
+		}
+		std::vector<T> result(nRows);
+		Matrix<T>::_forEachRowBlock(nRows, _averageRowSize(), [&](unsigned int first, unsigned int last)
+		{
+			unsigned int i;
+			for (i = first; i < last; ++i)
+			{
+				T element = T();
+				std::size_t k;
+				for (k = rowStarts[i]; k < rowStarts[i + 1]; ++k)
+				{
+					element = element + values[k] * vector[colIndices[k]];
+				}
+				result[i] = element;
+			}
+		});
+		return result;
+	}
+
+	/**
+	 * @brief multiplies the matrix by a dense matrix (SpMM), every stored element scales a row of
+	 * rhs into a row of the result
+	 * @param rhs the dense matrix to multiply by
+	 * @return the dense product
+	 * @throw std::invalid_argument if the matrices sizes don't match
+	 */
+	Matrix<T> operator*(const Matrix<T>& rhs) const
+	{
+		if (nCols != rhs.rows())
+		{
+			throw std::invalid_argument(MULTIPLICATION_EXCEPTION_MSG);
+		}
+		const unsigned int m = rhs.cols();
+		Matrix<T> result(nRows, m);
+		if (m == 0)
+		{
+			return result;
+		}
+		Matrix<T>::_forEachRowBlock(nRows, (unsigned long) _averageRowSize() * m, [&](unsigned int first, unsigned int last)
+		{
+			unsigned int i, j;
+			for (i = first; i < last; ++i)
+			{
+				T* resultRow = &result.matrix[result._getIndex(i, 0)];
+				std::size_t k;
+				for (k = rowStarts[i]; k < rowStarts[i + 1]; ++k)
+				{
+					const T element = values[k];
+					const T* rhsRow = &rhs.matrix[rhs._getIndex(colIndices[k], 0)];
+					for (j = 0; j < m; ++j)
+					{
+						resultRow[j] = resultRow[j] + element * rhsRow[j];
+					}
+				}
+			}
+		});
+		return result;
+	}
+
+	/**
+	 * @brief returns the transpose of the matrix, conjugated over the complex field like
+	 * Matrix<T>::trans(). Its rows are the columns of this matrix, so it's also the CSC form
+	 * of this matrix.
+	 * @return transpose matrix
+	 */
+	SparseMatrix<T> trans() const
+	{
+		SparseMatrix<T> transMatrix(nCols, nRows);
+		transMatrix.values.resize(values.size());
+		transMatrix.colIndices.resize(values.size());
+		for (unsigned int col : colIndices)
+		{
+			++transMatrix.rowStarts[col + 1];
+		}
+		unsigned int i;
+		for (i = 0; i < nCols; ++i)
+		{
+			transMatrix.rowStarts[i + 1] += transMatrix.rowStarts[i];
+		}
+		// the rows are scattered in order, so the columns come out ascending
+		std::vector<std::size_t> next(transMatrix.rowStarts.begin(), transMatrix.rowStarts.end() - 1);
+		for (i = 0; i < nRows; ++i)
+		{
+			std::size_t k;
+			for (k = rowStarts[i]; k < rowStarts[i + 1]; ++k)
+			{
+				std::size_t position = next[colIndices[k]]++;
+				transMatrix.values[position] = _transElement(values[k]);
+				transMatrix.colIndices[position] = i;
+			}
+		}
+		return transMatrix;
+	}
+
+	/**
+	 * @brief returns the element at the given position, zero if it isn't stored
+	 * @param row element row
+	 * @param col element column
+	 * @return the element at the given position
+	 * @throw std::out_of_range if the position is outside the matrix
+	 */
+	T operator()(unsigned int row, unsigned int col) const
+	{
+		if (row >= nRows || col >= nCols)
+		{
+			throw std::out_of_range(OUT_OF_RANGE_MSG);
+		}
+		std::vector<unsigned int>::const_iterator first = colIndices.begin() + rowStarts[row];
+		std::vector<unsigned int>::const_iterator last = colIndices.begin() + rowStarts[row + 1];
+		std::vector<unsigned int>::const_iterator found = std::lower_bound(first, last, col);
+		return found != last && *found == col ? values[found - colIndices.begin()] : T();
+	}
+
+	/**
+	 * @brief returns the number of columns in the matrix
+	 * @return the number of columns in the matrix
+	 */
+	unsigned int cols() const
+	{
+		return nCols;
+	}
+
+	/**
+	 * @brief returns the number of rows in the matrix
+	 * @return the number of rows in the matrix
+	 */
+	unsigned int rows() const
+	{
+		return nRows;
+	}
+
+	/**
+	 * @brief returns the number of stored elements
+	 * @return the number of stored elements
+	 */
+	std::size_t nonZeros() const
+	{
+		return values.size();
+	}
+
+	/**
+	 * @brief returns the fraction of the elements that are stored
+	 * @return the number of stored elements divided by rows() * cols(), 0 for an empty matrix
+	 */
+	double density() const
+	{
+		std::size_t size = (std::size_t) nRows * nCols;
+		return size == 0 ? 0 : (double) values.size() / size;
+	}
+
+private:
+
+	/**
+	 * @brief returns the average number of stored elements in a row, at least 1
+	 * @return the average row size
+	 */
+	unsigned int _averageRowSize() const
+	{
+		return nRows == 0 ? 1 : (unsigned int) std::max<std::size_t>(1, values.size() / nRows);
+	}
+};
+
+/**
+ * @brief returns true if few enough elements of the matrix are non zero for SparseMatrix<T> to
+ * pay off, counting stops as soon as the limit is passed
+ * @param dense the matrix to check
+ * @param maxDensity the largest fraction of non zero elements of a sparse matrix
+ * @return true if at most maxDensity of the elements are non zero, otherwise false
+ */
+template <typename T>
+bool isSparse(const Matrix<T>& dense, double maxDensity = SPARSE_MAX_DENSITY)
+{
+	const std::size_t limit = (std::size_t) (maxDensity * ((double) dense.rows() * dense.cols()));
+	std::size_t nonZeros = 0;
+	for (const T& element : dense)
+	{
+		if (_isStored(element) && ++nonZeros > limit)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+#endif //MATRIX_SPARSEMATRIX_HPP
@@ -0,0 +1,550 @@
+#ifndef MATRIX_SPLITCOMPLEXMATRIX_HPP
+#define MATRIX_SPLITCOMPLEXMATRIX_HPP
+
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <utility>
+#include "Complex.h"
+#include "Matrix.hpp"
+
+/**
+ * @brief a complex matrix stored in split (structure of arrays) layout
+ * The real and imaginary parts are kept in two separate contiguous planes instead of the
+ * interleaved pairs of Matrix<Complex>, so every operation runs on plain double arrays.
+ * Element access, iteration and output behave like Matrix<Complex>, except that elements
+ * are returned by value (and assigned through a reference proxy) since no Complex object
+ * is stored. The planes are Matrix<double> objects, so the operations hand them to the real
+ * matrix operations without copying them.
+ */
+class SplitComplexMatrix
+{
+	/**
+	 * @brief bidirectional iterator class declaration
+	 */
+	class BidiConstIterator;
+
+	/**
+	 * @brief the real parts
+	 */
+	Matrix<double> realPlane;
+
+	/**
+	 * @brief the imaginary parts
+	 */
+	Matrix<double> imaginaryPlane;
+
+	/**
+	 * @brief the number of columns in the matrix;
+	 */
+	unsigned int nCols;
+
+	/**
+	 * @brief the number of rows in the matrix;
+	 */
+	unsigned int nRows;
+
+public:
+
+	/**
+	 * @brief iterator type definition
+	 */
+	typedef BidiConstIterator const_iterator;
+
+	/**
+	 * @brief reference to an element, assigning to it writes both planes
+	 */
+	class ElementRef
+	{
+		/**
+		 * @brief the real part of the element
+		 */
+		double& real;
+
+		/**
+		 * @brief the imaginary part of the element
+		 */
+		double& imaginary;
+
+	public:
+
+		/**
+		 * @brief constructs a reference to the element with the given parts
+		 * @param realPart the real part of the element
+		 * @param imaginaryPart the imaginary part of the element
+		 */
+		ElementRef(double& realPart, double& imaginaryPart) : real(realPart), imaginary(imaginaryPart) {};
+
+		/**
+		 * @brief assigns the given value to the element
+		 * @param value the value to assign
+		 * @return this
+		 */
+		ElementRef& operator=(const Complex& value)
+		{
+			real = value.getReal();
+			imaginary = value.getImaginary();
+			return *this;
+		}
+
+		/**
+		 * @brief assigns the value of another element to the element
+		 * @param other the element whose value to assign
+		 * @return this
+		 */
+		ElementRef& operator=(const ElementRef& other)
+		{
+			return *this = Complex(other);
+		}
+
+		/**
+		 * @brief returns the value of the element
+		 * @return the value of the element
+		 */
+		operator Complex() const
+		{
+			return Complex(real, imaginary);
+		}
+	};
+
+	/**
+	 * @brief default constructor
+	 * initializes a matrix of size 1x1 with a single element 0
+	 */
+	SplitComplexMatrix() : nCols(DEFAULT_CTOR_COLS), nRows(DEFAULT_CTOR_ROWS) {};
+
+	/**
+	 * @brief creates a matrix with the given row and column sizes initialized to zeroes
+	 * @param rows number of rows
+	 * @param cols number of columns
+	 */
+	SplitComplexMatrix(unsigned int rows, unsigned int cols) : realPlane(rows, cols), imaginaryPlane(rows, cols),
+															   nCols(cols), nRows(rows) {};
+
+	/**
+	 * @brief Constructs a matrix from a given vector and row and column numbers
+	 * @param rows number of rows
+	 * @param cols number of columns
+	 * @param cells the element to populate the matrix with
+	 */
+	SplitComplexMatrix(unsigned int rows, unsigned int cols, const std::vector<Complex>& cells) :
+		SplitComplexMatrix(rows, cols)
+	{
+		if (cells.size() != (std::size_t) rows * cols)
+		{
+			throw std::invalid_argument(CELLS_CTOR_EXCEPTION_MSG);
+		}
+		_split(cells.data());
+	}
+
+	/**
+	 * @brief Constructs a matrix from the given real and imaginary planes, which are adopted
+	 * @param rows number of rows
+	 * @param cols number of columns
+	 * @param real the real parts, row major
+	 * @param imaginary the imaginary parts, row major
+	 */
+	SplitComplexMatrix(unsigned int rows, unsigned int cols, std::vector<double>&& real,
+					   std::vector<double>&& imaginary) : realPlane(rows, cols, std::move(real)),
+														  imaginaryPlane(rows, cols, std::move(imaginary)),
+														  nCols(cols), nRows(rows) {};
+
+	/**
+	 * @brief Constructs a split matrix with the elements of the given matrix
+	 * @param other the matrix to convert
+	 */
+	explicit SplitComplexMatrix(const Matrix<Complex>& other) : SplitComplexMatrix(other.rows(), other.cols())
+	{
+		if (!realPlane.matrix.empty())
+		{
+			_split(&*other.begin());
+		}
+	}
+
+	/**
+	 * @brief returns the matrix in the interleaved layout
+	 * @return a Matrix<Complex> with the elements of this matrix
+	 */
+	Matrix<Complex> toMatrix() const
+	{
+		std::vector<Complex> cells;
+		cells.reserve(realPlane.matrix.size());
+		std::size_t i;
+		for (i = 0; i < realPlane.matrix.size(); ++i)
+		{
+			cells.push_back(Complex(realPlane.matrix[i], imaginaryPlane.matrix[i]));
+		}
+		return Matrix<Complex>(nRows, nCols, std::move(cells));
+	}
+
+	/**
+	 * @brief Binary addition operator
+	 * @param rhs the matrix to add to this
+	 * @return A matrix that equals (this + rhs)
+	 */
+	SplitComplexMatrix operator+(const SplitComplexMatrix& rhs) const
+	{
+		if (nRows != rhs.nRows || nCols != rhs.nCols)
+		{
+			throw std::invalid_argument(ADDITION_EXCEPTION_MSG);
+		}
+		return SplitComplexMatrix(realPlane + rhs.realPlane, imaginaryPlane + rhs.imaginaryPlane);
+	}
+
+	/**
+	 * @brief Binary subtraction operator
+	 * @param rhs the matrix to subtract from this
+	 * @return A matrix that equals (this - rhs)
+	 */
+	SplitComplexMatrix operator-(const SplitComplexMatrix& rhs) const
+	{
+		if (nRows != rhs.nRows || nCols != rhs.nCols)
+		{
+			throw std::invalid_argument(SUBTRACTION_EXCEPTION_MSG);
+		}
+		return SplitComplexMatrix(realPlane - rhs.realPlane, imaginaryPlane - rhs.imaginaryPlane);
+	}
+
+	/**
+	 * @brief Matrix multiplication operator
+	 * computed with 4 real matrix products of the planes on the double kernels:
+	 * real = Ar * Br - Ai * Bi, imaginary = Ar * Bi + Ai * Br,
+	 * the result equals the Matrix<Complex> product up to rounding
+	 * @param rhs the matrix to multiply with this
+	 * @return A matrix that equals (this * rhs)
+	 */
+	SplitComplexMatrix operator*(const SplitComplexMatrix& rhs) const
+	{
+		if (nCols != rhs.nRows)
+		{
+			throw std::invalid_argument(MULTIPLICATION_EXCEPTION_MSG);
+		}
+		return SplitComplexMatrix(realPlane * rhs.realPlane - imaginaryPlane * rhs.imaginaryPlane,
+								  realPlane * rhs.imaginaryPlane + imaginaryPlane * rhs.realPlane);
+	}
+
+	/**
+	 * @brief compare the contents of this matrix with the given matrix
+	 * elements are compared like Complex::operator==
+	 * @param rhs the matrix to compare its content to this matrix
+	 * @return true if all the elements are equal, otherwise false
+	 */
+	bool operator==(const SplitComplexMatrix& rhs) const
+	{
+		return nRows == rhs.nRows && nCols == rhs.nCols &&
+			   partsClose(realPlane.data(), rhs.realPlane.data(), realPlane.matrix.size()) &&
+			   partsClose(imaginaryPlane.data(), rhs.imaginaryPlane.data(), imaginaryPlane.matrix.size());
+	}
+
+	/**
+	 * @brief compare the contents of this matrix with the given matrix
+	 * @param rhs the matrix to compare its content to this matrix
+	 * @return false if all the elements are equal, otherwise true
+	 */
+	bool operator!=(const SplitComplexMatrix& rhs) const
+	{
+		return !(*this == rhs);
+	}
+
+	/**
+	 * @brief returns the conjugate transpose of this matrix
+	 * both planes are transposed with the tiled transpose of Matrix<double> and the imaginary
+	 * plane is negated with the element kernels
+	 * @return the conjugate transpose matrix
+	 */
+	SplitComplexMatrix trans() const
+	{
+		SplitComplexMatrix transMatrix(realPlane.trans(), imaginaryPlane.trans());
+		static const double zeros[EVALUATE_CHUNK] = {};
+		double* imaginaryParts = transMatrix.imaginaryPlane.matrix.data();
+		const std::size_t size = transMatrix.imaginaryPlane.matrix.size();
+		std::size_t i;
+		for (i = 0; i < size; i += EVALUATE_CHUNK)
+		{
+			ElementKernels<double>::sub(zeros, imaginaryParts + i, imaginaryParts + i,
+										std::min<std::size_t>(EVALUATE_CHUNK, size - i));
+		}
+		return transMatrix;
+	}
+
+	/**
+	 * @brief returns true if the matrix is square, otherwise false
+	 * @return true if the matrix is square, otherwise false
+	 */
+	bool isSquareMatrix() const
+	{
+		return (nCols == nRows);
+	}
+
+	/**
+	 * @brief returns the element in the given matrix position
+	 * @param row the row number
+	 * @param col the column number
+	 * @return the element in the given row and column number
+	 */
+	Complex operator()(unsigned int row, unsigned int col) const
+	{
+		_checkRange(row, col);
+		return Complex(realPlane.matrix[_getIndex(row, col)], imaginaryPlane.matrix[_getIndex(row, col)]);
+	}
+
+	/**
+	 * @brief returns a reference to the element in the given matrix position
+	 * @param row the row number
+	 * @param col the column number
+	 * @return reference to the element in the given row and column number
+	 */
+	ElementRef operator()(unsigned int row, unsigned int col)
+	{
+		_checkRange(row, col);
+		return ElementRef(realPlane.matrix[_getIndex(row, col)], imaginaryPlane.matrix[_getIndex(row, col)]);
+	}
+
+	/**
+	 * @brief Returns the iterator to the first element of the matrix
+	 * @return iterator to the first element of the matrix
+	 */
+	const_iterator begin() const;
+
+	/**
+	 * @brief Returns the iterator to the element following the last element of the matrix
+	 * @return iterator to the element following the last element of the matrix
+	 */
+	const_iterator end() const;
+
+	/**
+	 * @brief returns the number of columns in the matrix
+	 * @return the number of columns in the matrix
+	 */
+	unsigned int cols() const
+	{
+		return nCols;
+	}
+
+	/**
+	 * @brief returns the number of rows in the matrix
+	 * @return the number of rows in the matrix
+	 */
+	unsigned int rows() const
+	{
+		return nRows;
+	}
+
+	/**
+	 * @brief returns the real plane, rows() * cols() parts in row major order
+	 * @return the real plane
+	 */
+	const double* real() const
+	{
+		return realPlane.data();
+	}
+
+	/**
+	 * @brief returns the imaginary plane, rows() * cols() parts in row major order
+	 * @return the imaginary plane
+	 */
+	const double* imaginary() const
+	{
+		return imaginaryPlane.data();
+	}
+
+	/**
+	 * @brief output operator, same output as for the equal Matrix<Complex>
+	 * @param os output stream
+	 * @param matrix the matrix to output
+	 * @return output stream
+	 */
+	friend std::ostream& operator<<(std::ostream& os, const SplitComplexMatrix& matrix)
+	{
+		unsigned int i, j;
+		for (i = 0; i < matrix.nRows; ++i)
+		{
+			for (j = 0; j < matrix.nCols; ++j)
+			{
+				os << matrix(i, j) << TAB_CHAR;
+			}
+			os << NEWLINE_CHAR;
+		}
+		return os;
+	}
+
+private:
+
+	/**
+	 * @brief constructs a matrix that adopts the given planes
+	 * @param real the real parts
+	 * @param imaginary the imaginary parts, of the size of real
+	 */
+	SplitComplexMatrix(Matrix<double>&& real, Matrix<double>&& imaginary) : realPlane(std::move(real)),
+																			  imaginaryPlane(std::move(imaginary)),
+																			  nCols(realPlane.cols()),
+																			  nRows(realPlane.rows()) {};
+
+	/**
+	 * @brief returns the plane index of the given matrix position
+	 * @param row number of row
+	 * @param col number of column
+	 * @return the appropriate index of the element in the planes
+	 */
+	std::size_t _getIndex(unsigned int row, unsigned int col) const
+	{
+		return (std::size_t) row * nCols + col;
+	}
+
+	/**
+	 * @brief throws std::out_of_range if the given position is outside the matrix, when
+	 * MATRIX_CHECKED_ACCESS is 1
+	 * @param row the row number
+	 * @param col the column number
+	 */
+	void _checkRange(unsigned int row, unsigned int col) const
+	{
+		if (MATRIX_CHECKED_ACCESS && (row >= nRows || col >= nCols))
+		{
+			throw std::out_of_range(OUT_OF_RANGE_MSG);
+		}
+	}
+
+	/**
+	 * @brief fills the planes from the given interleaved elements
+	 * @param cells rows() * cols() elements in row major order
+	 */
+	void _split(const Complex* cells)
+	{
+		std::size_t i;
+		for (i = 0; i < realPlane.matrix.size(); ++i)
+		{
+			realPlane.matrix[i] = cells[i].getReal();
+			imaginaryPlane.matrix[i] = cells[i].getImaginary();
+		}
+	}
+};
+
+//-------------------------- Iterator class implementation ---------------------------
+
+/**
+ * @brief bidirectional const iterator class, yields the elements by value
+ */
+class SplitComplexMatrix::BidiConstIterator
+{
+	/**
+	 * @brief pointer to the real part of the element
+	 */
+	const double* _real;
+
+	/**
+	 * @brief pointer to the imaginary part of the element
+	 */
+	const double* _imaginary;
+
+public:
+
+	/**
+	 * @brief default constructor
+	 * initialized the pointers to nullptr
+	 */
+	BidiConstIterator() : _real(nullptr), _imaginary(nullptr) {};
+
+	/**
+	 * @brief Bidirectional iterator constructor
+	 * @param real the real part of the element the iterator should point to
+	 * @param imaginary the imaginary part of the element the iterator should point to
+	 */
+	BidiConstIterator(const double* real, const double* imaginary) : _real(real), _imaginary(imaginary) {};
+
+	/**
+	 * @brief equals operator
+	 * @param rhs the object to test this against
+	 * @return true if rhs equals this, otherwise false
+	 */
+	bool operator==(const BidiConstIterator& rhs) const
+	{
+		return (_real == rhs._real);
+	}
+
+	/**
+	 * @brief not-equals operator
+	 * @param rhs the object to test this against
+	 * @return true if rhs doesn't equal this, otherwise false
+	 */
+	bool operator!=(const BidiConstIterator& rhs) const
+	{
+		return !(*this == rhs);
+	}
+
+	/**
+	 * @brief accesses the contained value
+	 * @return the contained value
+	 */
+	Complex operator*() const
+	{
+		return Complex(*_real, *_imaginary);
+	}
+
+	/**
+	 * @brief pre increment the operator
+	 * elements aren't stored so the iterator is returned instead of the element
+	 * @return this after incrementing it
+	 */
+	BidiConstIterator& operator++()
+	{
+		++_real;
+		++_imaginary;
+		return *this;
+	}
+
+	/**
+	 * @brief post increment the operator
+	 * @return a copy of the iterator before incrementing it
+	 */
+	BidiConstIterator operator++(int)
+	{
+		BidiConstIterator tmp = *this;
+		++*this;
+		return tmp;
+	}
+
+	/**
+	 * @brief pre decrement the operator
+	 * elements aren't stored so the iterator is returned instead of the element
+	 * @return this after decrementing it
+	 */
+	BidiConstIterator& operator--()
+	{
+		--_real;
+		--_imaginary;
+		return *this;
+	}
+
+	/**
+	 * @brief post decrement the operator
+	 * @return a copy of the iterator before decrementing it
+	 */
+	BidiConstIterator operator--(int)
+	{
+		BidiConstIterator tmp = *this;
+		--*this;
+		return tmp;
+	}
+};
+
+/**
+ * @brief Returns the iterator to the first element of the matrix
+ * @return iterator to the first element of the matrix
+ */
+inline SplitComplexMatrix::const_iterator SplitComplexMatrix::begin() const
+{
+	return const_iterator(realPlane.data(), imaginaryPlane.data());
+}
+
+/**
+ * @brief Returns the iterator to the element following the last element of the matrix
+ * @return iterator to the element following the last element of the matrix
+ */
+inline SplitComplexMatrix::const_iterator SplitComplexMatrix::end() const
+{
+	return const_iterator(realPlane.data() + realPlane.matrix.size(),
+						  imaginaryPlane.data() + imaginaryPlane.matrix.size());
+}
+
+#endif //MATRIX_SPLITCOMPLEXMATRIX_HPP
@@ -0,0 +1,487 @@
+#ifndef MATRIX_THREADPOOL_HPP
+#define MATRIX_THREADPOOL_HPP
+
+#include <cstdlib>
+#include <algorithm>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <functional>
+
+/**
+ * @def POOL_THREADS_ENV "MATRIX_THREADS"
+ * @brief the environment variable setting the initial number of threads of the pool
+ */
+#define POOL_THREADS_ENV "MATRIX_THREADS"
+/**
+ * @def POOL_BLOCKS_PER_THREAD 8
+ * @brief parallelFor splits its range down to about this many blocks per thread, the spare blocks
+ * are stolen by the threads that finish early
+ */
+#define POOL_BLOCKS_PER_THREAD 8
+
+/**
+ * @brief process wide work-stealing pool of worker threads used by the parallel matrix operations
+ * The pool runs fork-join jobs: invoke(a, b) makes b available to the other threads, runs a and
+ * then runs b itself unless another thread stole it in the meantime. Every worker has its own
+ * deque of forked tasks, it pushes and pops at the back and idle workers steal the oldest (and
+ * so the largest) task from the front of another deque, so recursive algorithms balance
+ * themselves whatever the shape of the split.
+ * Threads outside the pool fork into a shared deque, and while a thread waits for a stolen task
+ * it runs other tasks instead of blocking. Jobs can be nested and can be submitted from any
+ * number of threads at once, they share the same workers, so a multithreaded caller never
+ * starts more threads than the pool size plus its own threads.
+ */
+class ThreadPool
+{
+	/**
+	 * @brief block function type, called with the half open range [first, last)
+	 */
+	typedef std::function<void(unsigned int, unsigned int)> BlockFunc;
+
+	/**
+	 * @brief a forked task, it lives on the stack of the forking thread until it's done
+	 */
+	struct _Task
+	{
+		/**
+		 * @brief calls the task function
+		 */
+		void (*call)(const void*);
+
+		/**
+		 * @brief the task function
+		 */
+		const void* func;
+
+		/**
+		 * @brief set once the task finished
+		 */
+		std::atomic<bool> done;
+
+		/**
+		 * @brief the exception thrown by the task function, if any
+		 */
+		std::exception_ptr error;
+
+		/**
+		 * @brief runs the task and marks it done
+		 */
+		void run()
+		{
+			try
+			{
+				call(func);
+			}
+			catch (...)
+			{
+				error = std::current_exception();
+			}
+			done.store(true, std::memory_order_release);
+		}
+	};
+
+	/**
+	 * @brief a deque of forked tasks
+	 */
+	struct _Queue
+	{
+		std::mutex mutex;
+		std::deque<_Task*> tasks;
+	};
+
+	/**
+	 * @brief the worker threads
+	 */
+	std::vector<std::thread> workers;
+
+	/**
+	 * @brief the deque of every worker, followed by the deque shared by the threads outside the pool
+	 */
+	std::vector<std::unique_ptr<_Queue>> queues;
+
+	/**
+	 * @brief the number of tasks waiting in the deques
+	 */
+	std::atomic<unsigned int> queued;
+
+	/**
+	 * @brief the number of workers sleeping on wakeCond
+	 */
+	std::atomic<unsigned int> sleepers;
+
+	/**
+	 * @brief guards the sleep of the workers
+	 */
+	std::mutex sleepMutex;
+
+	/**
+	 * @brief signaled when a task is forked or the pool is stopped
+	 */
+	std::condition_variable wakeCond;
+
+	/**
+	 * @brief true when the workers should exit
+	 */
+	bool stopping;
+
+public:
+
+	/**
+	 * @brief returns the process wide thread pool
+	 * the pool is created on first use with POOL_THREADS_ENV threads if it's set, otherwise with
+	 * a thread per hardware thread (the calling thread counts as one)
+	 * @return the thread pool
+	 */
+	static ThreadPool& instance()
+	{
+		static ThreadPool pool(_initialSize());
+		return pool;
+	}
+
+	/**
+	 * @brief returns the number of threads that run a job, including the caller
+	 * @return the number of threads that run a job
+	 */
+	unsigned int size() const
+	{
+		return (unsigned int) workers.size() + 1;
+	}
+
+	/**
+	 * @brief sets the number of threads that run a job, including the caller
+	 * the workers are stopped and restarted, so no job should be running
+	 * @param nThreads the number of threads, 1 runs every job on the caller
+	 */
+	void resize(unsigned int nThreads)
+	{
+		_stop();
+		_start(nThreads);
+	}
+
+	/**
+	 * @brief runs first and second, possibly in parallel, and returns after both finished
+	 * @param first the first function
+	 * @param second the second function, run by another thread if one is idle
+	 * @throw the exception thrown by first or second, if any
+	 */
+	template <typename First, typename Second>
+	void invoke(const First& first, const Second& second)
+	{
+		if (workers.empty())
+		{
+			first();
+			second();
+			return;
+		}
+		_Task task;
+		task.call = &_call<Second>;
+		task.func = &second;
+		task.done = false;
+		_Queue& queue = *queues[_ownQueue()];
+		_push(queue, task);
+		try
+		{
+			first();
+		}
+		catch (...)
+		{
+			_join(queue, task);
+			throw;
+		}
+		_join(queue, task);
+		if (task.error)
+		{
+			std::rethrow_exception(task.error);
+		}
+	}
+
+	/**
+	 * @brief calls func(first, last) on contiguous blocks covering [0, count)
+	 * the range is halved recursively with invoke, so idle threads steal the largest remaining
+	 * halves. Returns after all the blocks were processed.
+	 * @param count the size of the range
+	 * @param func the block function
+	 */
+	void parallelFor(unsigned int count, const BlockFunc& func)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+		if (workers.empty() || count == 1)
+		{
+			func(0, count);
+			return;
+		}
+		unsigned int grain = std::max(1U, count / (size() * POOL_BLOCKS_PER_THREAD));
+		_splitRange(func, 0, count, grain);
+	}
+
+	/**
+	 * @brief the pool can't be copied
+	 */
+	ThreadPool(const ThreadPool&) = delete;
+
+	/**
+	 * @brief the pool can't be assigned
+	 */
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+private:
+
+	/**
+	 * @brief starts the workers
+	 * @param nThreads the number of threads that should run a job, including the caller
+	 */
+	explicit ThreadPool(unsigned int nThreads) : queued(0), sleepers(0), stopping(false)
+	{
+		_start(nThreads);
+	}
+
+	/**
+	 * @brief stops and joins the workers
+	 */
+	~ThreadPool()
+	{
+		_stop();
+	}
+
+	/**
+	 * @brief returns the initial number of threads of the pool
+	 * @return POOL_THREADS_ENV if it's a positive number, otherwise the hardware concurrency
+	 */
+	static unsigned int _initialSize()
+	{
+		const char* threads = std::getenv(POOL_THREADS_ENV);
+		if (threads != nullptr && std::atoi(threads) > 0)
+		{
+			return (unsigned int) std::atoi(threads);
+		}
+		return std::thread::hardware_concurrency();
+	}
+
+	/**
+	 * @brief returns the index of the deque the calling thread forks into, the shared deque for
+	 * threads outside the pool
+	 * @return the deque index
+	 */
+	unsigned int _ownQueue() const
+	{
+		int index = _workerIndex();
+		return index < 0 ? (unsigned int) workers.size() : (unsigned int) index;
+	}
+
+	/**
+	 * @brief returns the worker index of the calling thread
+	 * @return the worker index, -1 for threads outside the pool
+	 */
+	static int& _workerIndex()
+	{
+		static thread_local int index = -1;
+		return index;
+	}
+
+	/**
+	 * @brief calls a task function of type Func
+	 * @param func the task function
+	 */
+	template <typename Func>
+	static void _call(const void* func)
+	{
+		(*static_cast<const Func*>(func))();
+	}
+
+	/**
+	 * @brief runs func on [first, last), forking the upper half until the blocks fit the grain
+	 * @param func the block function
+	 * @param first the first index of the range
+	 * @param last the index following the range
+	 * @param grain the largest block size
+	 */
+	void _splitRange(const BlockFunc& func, unsigned int first, unsigned int last, unsigned int grain)
+	{
+		if (last - first <= grain)
+		{
+			func(first, last);
+			return;
+		}
+		unsigned int mid = first + (last - first) / 2;
+		invoke([&] { _splitRange(func, first, mid, grain); },
+			   [&] { _splitRange(func, mid, last, grain); });
+	}
+
+	/**
+	 * @brief pushes a task at the back of the given deque and wakes a sleeping worker
+	 * @param queue the deque
+	 * @param task the task
+	 */
+	void _push(_Queue& queue, _Task& task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.tasks.push_back(&task);
+			++queued;
+		}
+		if (sleepers > 0)
+		{
+			{
+				std::lock_guard<std::mutex> lock(sleepMutex);
+			}
+			wakeCond.notify_one();
+		}
+	}
+
+	/**
+	 * @brief removes the given task from the deque it was pushed to, unless it was stolen
+	 * @param queue the deque
+	 * @param task the task
+	 * @return true if the task was removed and should be run by the caller
+	 */
+	bool _take(_Queue& queue, _Task& task)
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		std::deque<_Task*>::reverse_iterator found = std::find(queue.tasks.rbegin(), queue.tasks.rend(), &task);
+		if (found == queue.tasks.rend())
+		{
+			return false;
+		}
+		queue.tasks.erase(std::next(found).base());
+		--queued;
+		return true;
+	}
+
+	/**
+	 * @brief runs the given forked task if it wasn't stolen, otherwise runs other tasks until the
+	 * thief finished it
+	 * @param queue the deque the task was pushed to
+	 * @param task the task
+	 */
+	void _join(_Queue& queue, _Task& task)
+	{
+		if (_take(queue, task))
+		{
+			task.run();
+			return;
+		}
+		while (!task.done.load(std::memory_order_acquire))
+		{
+			_Task* other = _findTask();
+			if (other != nullptr)
+			{
+				other->run();
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	/**
+	 * @brief pops the newest task of the calling thread deque, or steals the oldest task of
+	 * another deque
+	 * @return the task, nullptr if every deque is empty
+	 */
+	_Task* _findTask()
+	{
+		if (queued == 0)
+		{
+			return nullptr;
+		}
+		const unsigned int own = _ownQueue(), nQueues = (unsigned int) queues.size();
+		unsigned int i;
+		for (i = 0; i < nQueues; ++i)
+		{
+			_Queue& queue = *queues[(own + i) % nQueues];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.tasks.empty())
+			{
+				_Task* task;
+				if (i == 0)
+				{
+					task = queue.tasks.back();
+					queue.tasks.pop_back();
+				}
+				else
+				{
+					task = queue.tasks.front();
+					queue.tasks.pop_front();
+				}
+				--queued;
+				return task;
+			}
+		}
+		return nullptr;
+	}
+
+	/**
+	 * @brief creates the deques and starts the workers
+	 * @param nThreads the number of threads that should run a job, including the caller
+	 */
+	void _start(unsigned int nThreads)
+	{
+		stopping = false;
+		unsigned int nWorkers = nThreads > 1 ? nThreads - 1 : 0;
+		unsigned int i;
+		for (i = 0; i <= nWorkers; ++i)
+		{
+			queues.push_back(std::unique_ptr<_Queue>(new _Queue()));
+		}
+		for (i = 0; i < nWorkers; ++i)
+		{
+			workers.push_back(std::thread(&ThreadPool::_workerLoop, this, (int) i));
+		}
+	}
+
+	/**
+	 * @brief stops and joins the workers and removes the deques
+	 */
+	void _stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			stopping = true;
+		}
+		wakeCond.notify_all();
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+		workers.clear();
+		queues.clear();
+	}
+
+	/**
+	 * @brief the worker thread main loop, runs tasks and sleeps while there are none
+	 * @param index the worker index
+	 */
+	void _workerLoop(int index)
+	{
+		_workerIndex() = index;
+		while (true)
+		{
+			_Task* task = _findTask();
+			if (task != nullptr)
+			{
+				task->run();
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			++sleepers;
+			wakeCond.wait(lock, [this] { return stopping || queued > 0; });
+			--sleepers;
+			if (stopping)
+			{
+				return;
+			}
+		}
+	}
+};
+
+#endif //MATRIX_THREADPOOL_HPP
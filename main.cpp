@@ -1,7 +1,63 @@
+// the tests run with the instrumentation compiled in, see testInstrumentation
+#define MATRIX_INSTRUMENT 1
 #include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <clocale>
 #include "Matrix.hpp"
+#include "SplitComplexMatrix.hpp"
+#include "PoolAllocator.hpp"
+#include "AlignedAllocator.hpp"
+#include "NumaAllocator.hpp"
+#include "MatrixFile.hpp"
+#include "MatrixStream.hpp"
+#include "SparseMatrix.hpp"
+#include "FixedMatrix.hpp"
+#include "MatrixBatch.hpp"
+#include "MatrixParser.hpp"
 #include "assert.h"
 
+/**
+ * @brief the number of calls to the global operator new, for the allocation tests
+ */
+static std::atomic<unsigned long> heapAllocations(0);
+
+/**
+ * @brief the global operator new, counting its calls
+ */
+void* operator new(std::size_t size)
+{
+	heapAllocations.fetch_add(1, std::memory_order_relaxed);
+	void* block = std::malloc(size != 0 ? size : 1);
+	if (block == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return block;
+}
+
+/**
+ * @brief the global operator delete, matching the counting operator new
+ */
+void operator delete(void* block) noexcept
+{
+	std::free(block);
+}
+
+/**
+ * @brief the global sized operator delete, matching the counting operator new
+ */
+void operator delete(void* block, std::size_t) noexcept
+{
+	std::free(block);
+}
+
 void testDefaultCtor()
 {
 	std::cout << "========DEFAULT CTOR TEST========" << std::endl;
@@ -286,6 +342,8 @@ void testFunctorException()
 {
 	std::cout << "========FUNCTOR THROW EXCEPTION TEST========" << std::endl;
 	Matrix<int> matrix;
+	assert(&matrix.unchecked(0, 0) == &matrix(0, 0));
+#if MATRIX_CHECKED_ACCESS
 	try
 	{
 		int i = matrix(100,100);
@@ -297,6 +355,7 @@ void testFunctorException()
 		assert(msg == e.what());
 		std::cout << "Exception msg is correct." << std::endl;
 	}
+#endif
 }
 
 void testZeroSizeMatrix()
@@ -306,6 +365,1348 @@ void testZeroSizeMatrix()
 	std::cout << "Zero size matrix initialized, test passed." << std::endl;
 }
 
+void testParallel()
+{
+	std::cout << "========PARALLEL MODE TEST========" << std::endl;
+	std::vector<Complex> vec;
+	int i;
+	for (i = 0; i < 200 * 200; ++i)
+	{
+		vec.push_back(Complex(i % 17 - 8.5, i % 13 * 0.25));
+	}
+	Matrix<Complex> matrix1(200, 200, vec);
+	Matrix<Complex> matrix2 = matrix1.trans();
+
+	Matrix<Complex>::setParallel(false);
+	Matrix<Complex> sum = matrix1 + matrix2;
+	Matrix<Complex> diff = matrix1 - matrix2;
+	Matrix<Complex> mult = matrix1 * matrix2;
+	Matrix<Complex> trans = mult.trans();
+
+	Matrix<Complex>::setParallel(true);
+	assert(Matrix<Complex>::isParallel());
+	assert((matrix1 + matrix2) == sum);
+	assert((matrix1 - matrix2) == diff);
+	assert((matrix1 * matrix2) == mult);
+	assert(mult.trans() == trans);
+	Matrix<Complex>::setParallel(false);
+	std::cout << "Parallel results equal the serial results" << std::endl;
+}
+
+void testBlockedMult()
+{
+	std::cout << "========BLOCKED MULTIPLICATION TEST========" << std::endl;
+	unsigned int rows = 150, inner = 270, cols = 90;
+	std::vector<double> vec1, vec2;
+	unsigned int i, j, k;
+	for (i = 0; i < rows * inner; ++i)
+	{
+		vec1.push_back((i % 31) * 0.37 - 4.1);
+	}
+	for (i = 0; i < inner * cols; ++i)
+	{
+		vec2.push_back((i % 23) * 1.13 - 11.9);
+	}
+	Matrix<double> matrix1(rows, inner, vec1);
+	Matrix<double> matrix2(inner, cols, vec2);
+	Matrix<double> matrix = matrix1 * matrix2;
+
+	for (i = 0; i < rows; ++i)
+	{
+		for (j = 0; j < cols; ++j)
+		{
+			double sum = 0;
+			for (k = 0; k < inner; ++k)
+			{
+				sum = sum + vec1[i * inner + k] * vec2[k * cols + j];
+			}
+			assert(matrix(i, j) == sum);
+		}
+	}
+	std::cout << "Blocked multiplication test passed" << std::endl;
+}
+
+void testElementKernels()
+{
+	std::cout << "========ELEMENT KERNELS TEST========" << std::endl;
+	std::vector<int> ints1, ints2;
+	std::vector<double> doubles1, doubles2;
+	std::vector<Complex> complex1, complex2;
+	int i;
+	for (i = 0; i < 37 * 3; ++i)
+	{
+		ints1.push_back(i * 7 - 100);
+		ints2.push_back(i % 5);
+		doubles1.push_back(i * 0.3 - 9.1);
+		doubles2.push_back(i % 7 * 1.7);
+		complex1.push_back(Complex(i * 0.5, -i * 0.25));
+		complex2.push_back(Complex(i % 3, i % 4 * 0.125));
+	}
+	Matrix<int> int1(37, 3, ints1), int2(37, 3, ints2);
+	Matrix<double> double1(37, 3, doubles1), double2(37, 3, doubles2);
+	Matrix<Complex> cpx1(37, 3, complex1), cpx2(37, 3, complex2);
+	Matrix<int> intSum = int1 + int2, intDiff = int1 - int2;
+	Matrix<double> doubleSum = double1 + double2, doubleDiff = double1 - double2;
+	Matrix<Complex> cpxSum = cpx1 + cpx2, cpxDiff = cpx1 - cpx2;
+	for (i = 0; i < 37 * 3; ++i)
+	{
+		assert(intSum(i / 3, i % 3) == ints1[i] + ints2[i]);
+		assert(intDiff(i / 3, i % 3) == ints1[i] - ints2[i]);
+		assert(doubleSum(i / 3, i % 3) == doubles1[i] + doubles2[i]);
+		assert(doubleDiff(i / 3, i % 3) == doubles1[i] - doubles2[i]);
+		assert(cpxSum(i / 3, i % 3) == complex1[i] + complex2[i]);
+		assert(cpxDiff(i / 3, i % 3) == complex1[i] - complex2[i]);
+	}
+
+	Matrix<double> doubleCopy = double1;
+	assert(doubleCopy == double1);
+	doubleCopy(36, 2) = doubleCopy(36, 2) + 1;
+	assert(doubleCopy != double1);
+
+	Matrix<Complex> cpxCopy = cpx1;
+	cpxCopy(36, 1) = cpxCopy(36, 1) + Complex(0, std::numeric_limits<double>::epsilon() / 4);
+	assert(cpxCopy == cpx1);
+	cpxCopy(36, 1) = cpxCopy(36, 1) + Complex(0, 1e-9);
+	assert(cpxCopy != cpx1);
+
+	try
+	{
+		Matrix<int> wrongSize(36, 3);
+		int1 - wrongSize;
+		assert(false);
+	}
+	catch (std::invalid_argument& e)
+	{
+		std::string msg = SUBTRACTION_EXCEPTION_MSG;
+		assert(msg == e.what());
+	}
+	std::cout << "Element kernels test passed" << std::endl;
+}
+
+void testMoveSemantics()
+{
+	std::cout << "========MOVE SEMANTICS TEST========" << std::endl;
+	std::vector<int> vec;
+	int i;
+	for (i = 0; i < 1000; ++i)
+	{
+		vec.push_back(i);
+	}
+	std::vector<int> cells = vec;
+	const int* cellsData = cells.data();
+	Matrix<int> matrix1(10, 100, std::move(cells));
+	assert(&*matrix1.begin() == cellsData);
+	std::cout << "Vector adopted without copying" << std::endl;
+
+	Matrix<int> matrix2;
+	matrix2 = std::move(matrix1);
+	assert(&*matrix2.begin() == cellsData);
+	assert(matrix1.rows() == 0 && matrix1.cols() == 0 && matrix1.begin() == matrix1.end());
+	std::cout << "Move assignment took over the elements" << std::endl;
+
+	Matrix<int> matrix3(10, 100, vec);
+	matrix2 += matrix3;
+	matrix2 += matrix3;
+	matrix2 -= matrix3;
+	assert(&*matrix2.begin() == cellsData);
+	for (i = 0; i < 1000; ++i)
+	{
+		assert(matrix2(i / 100, i % 100) == 2 * vec[i]);
+	}
+	std::cout << "In place addition and subtraction passed" << std::endl;
+
+	Matrix<int> ones(100, 2, std::vector<int>(200, 1));
+	matrix3 *= ones;
+	assert(matrix3.rows() == 10 && matrix3.cols() == 2);
+	assert(matrix3(0, 0) == 4950 && matrix3(9, 1) == 94950);
+	std::cout << "Multiplication assignment passed" << std::endl;
+}
+
+void testExpressions()
+{
+	std::cout << "========EXPRESSIONS TEST========" << std::endl;
+	std::vector<double> vec;
+	int i;
+	for (i = 0; i < 12; ++i)
+	{
+		vec.push_back(i * 1.5);
+	}
+	Matrix<double> a(3, 4, vec), b = a + a, c(3, 4);
+	Matrix<double> result = a + b - a + b;
+	for (i = 0; i < 12; ++i)
+	{
+		assert(result(i / 4, i % 4) == vec[i] * 4);
+	}
+	std::cout << "Chained expression evaluated" << std::endl;
+
+	const double* storage = &*result.begin();
+	result = a - b + c;
+	assert(&*result.begin() == storage);
+	assert(result == (c - a));
+	result += a + a;
+	assert(result == a);
+	std::cout << "Assignment reused the matrix storage" << std::endl;
+
+	Matrix<double> d(4, 3, vec);
+	Matrix<double> square = (a + a) * (d - Matrix<double>(4, 3));
+	assert(square == b * d);
+	assert(a * (d + d) == (a + a) * d);
+	assert(square.rows() == 3 && square.cols() == 3);
+	std::cout << "Multiplication of expressions passed" << std::endl;
+
+	try
+	{
+		result = a + b + square;
+		assert(false);
+	}
+	catch (std::invalid_argument& e)
+	{
+		std::string msg = ADDITION_EXCEPTION_MSG;
+		assert(msg == e.what());
+	}
+	std::cout << "Expressions test passed" << std::endl;
+}
+
+void testStrassen()
+{
+	std::cout << "========STRASSEN MULTIPLICATION TEST========" << std::endl;
+	unsigned int n = 75;
+	std::vector<int> vec;
+	unsigned int i;
+	for (i = 0; i < n * n; ++i)
+	{
+		vec.push_back((int) (i % 19) - 9);
+	}
+	Matrix<int> matrix1(n, n, vec);
+	Matrix<int> matrix2 = matrix1.trans();
+	Matrix<int> classic = matrix1 * matrix2;
+
+	Matrix<int>::setStrassen(true);
+	Matrix<int>::setStrassenCutoff(8);
+	Matrix<int> fast = matrix1 * matrix2;
+	Matrix<int>::setStrassen(false);
+	Matrix<int>::setStrassenCutoff(STRASSEN_DEFAULT_CUTOFF);
+
+	assert(fast == classic);
+	std::cout << "Strassen multiplication test passed" << std::endl;
+}
+
+void testGaussMultiply()
+{
+	std::cout << "========GAUSS COMPLEX MULTIPLICATION TEST========" << std::endl;
+	std::vector<Complex> vec1, vec2;
+	int i;
+	for (i = 0; i < 40 * 70; ++i)
+	{
+		vec1.push_back(Complex(i % 7 - 3, i % 5 - 2));
+		vec2.push_back(Complex(i % 3 - 1, i % 11 - 5));
+	}
+	Matrix<Complex> matrix1(40, 70, vec1);
+	Matrix<Complex> matrix2(70, 40, vec2);
+	Matrix<Complex> classic = matrix1 * matrix2;
+
+	Matrix<Complex>::setGaussMultiply(true);
+	Matrix<Complex> gauss = matrix1 * matrix2;
+	Matrix<Complex>::setGaussMultiply(false);
+
+	// small integer parts keep every intermediate value exact
+	assert(gauss == classic);
+	std::cout << "Gauss complex multiplication test passed" << std::endl;
+}
+
+void testPoolAllocator()
+{
+	std::cout << "========POOL ALLOCATOR TEST========" << std::endl;
+	std::vector<Complex> vec1, vec2;
+	int i;
+	for (i = 0; i < 40 * 70; ++i)
+	{
+		vec1.push_back(Complex(i % 7 - 3, i % 5 - 2));
+		vec2.push_back(Complex(i % 3 - 1, i % 11 - 5));
+	}
+	Matrix<Complex> matrix1(40, 70, vec1), matrix2(70, 40, vec2);
+	PooledMatrix<Complex> pooled1(40, 70, vec1), pooled2(70, 40, vec2);
+	assert(pooled1 == matrix1);
+	assert(pooled1 * pooled2 == matrix1 * matrix2);
+	assert(pooled1.trans() == matrix1.trans());
+	assert(pooled1.transView() * pooled1 == matrix1.transView() * matrix1);
+	assert(pooled1 + pooled1 - pooled1 == matrix1);
+	assert(pooled1 * (pooled2 + pooled2) == matrix1 * (matrix2 + matrix2));
+
+	// the algorithm settings are shared by the matrices of every allocator
+	Matrix<Complex>::setGaussMultiply(true);
+	PooledMatrix<Complex> gauss = pooled1 * pooled2;
+	Matrix<Complex>::setGaussMultiply(false);
+	assert(gauss == matrix1 * matrix2);
+
+	// repeating the same operations reuses the same buffers
+	std::size_t cached = 0;
+	for (i = 0; i < 4; ++i)
+	{
+		{
+			PooledMatrix<Complex> product = pooled1 * pooled2;
+			PooledMatrix<Complex> sum = product + product.trans();
+			assert(sum.rows() == 40);
+		}
+		if (i == 0)
+		{
+			cached = BufferPool::local()->cachedBytes();
+			assert(cached > 0);
+		}
+		assert(BufferPool::local()->cachedBytes() == cached);
+	}
+
+	// repeated operations of the same small shape don't touch the global heap once warm
+	std::vector<double> small(16);
+	for (i = 0; i < 16; ++i)
+	{
+		small[i] = (double) i - 7.5;
+	}
+	PooledMatrix<double> smallLhs(4, 4, small), smallRhs = smallLhs.trans();
+	unsigned long allocations = 0;
+	for (i = 0; i < 4; ++i)
+	{
+		if (i == 2)
+		{
+			allocations = heapAllocations.load();
+		}
+		PooledMatrix<double> sum = smallLhs + smallRhs;
+		PooledMatrix<double> trans = smallLhs.trans();
+		assert(sum(1, 2) == smallLhs(1, 2) + smallLhs(2, 1) && trans(1, 2) == smallLhs(2, 1));
+		// small products take the iterative kernels, which build their rows in a stack chunk
+		PooledMatrix<double> product = smallLhs * smallRhs;
+		PooledMatrix<double> viewProduct = smallLhs * smallLhs.transView();
+		assert(product == viewProduct);
+	}
+	assert(heapAllocations.load() == allocations);
+
+	// the entries of varying sizes are bounded, the buffers of the cached sizes are kept
+	BufferPool& pool = *BufferPool::local();
+	const std::size_t bytes = pool.cachedBytes();
+	std::size_t size;
+	for (size = 1; size <= 2 * POOL_MAX_SIZES; ++size)
+	{
+		pool.deallocate(::operator new(size * 8 + 3), size * 8 + 3);
+		::operator delete(pool.allocate(size * 8 + 3));
+	}
+	assert(pool.cachedSizes() <= POOL_MAX_SIZES && pool.cachedBytes() == bytes);
+
+	std::vector<double, PoolAllocator<double>> pooledCells(6, 1.5);
+	PooledMatrix<double> adopted(2, 3, std::move(pooledCells));
+	assert(adopted(1, 2) == 1.5 && pooledCells.empty());
+	std::cout << "Pool allocator test passed" << std::endl;
+}
+
+void testAlignedStorage()
+{
+	std::cout << "========ALIGNED STORAGE TEST========" << std::endl;
+	std::vector<Complex> vec1, vec2;
+	std::vector<double> reals;
+	int i;
+	for (i = 0; i < 37 * 21; ++i)
+	{
+		vec1.push_back(Complex(i % 7 - 3, i % 5 - 2));
+		vec2.push_back(Complex(i % 3 - 1, i % 11 - 5));
+		reals.push_back(i % 13 - 6.5);
+	}
+	Matrix<Complex> matrix1(37, 21, vec1), matrix2(21, 37, vec2);
+	AlignedMatrix<Complex> aligned1(37, 21, vec1);
+	PaddedMatrix<Complex> padded1(37, 21, vec1), padded2(21, 37, vec2);
+	assert((reinterpret_cast<std::uintptr_t>(aligned1.data()) % MATRIX_ALIGNMENT) == 0);
+	assert(aligned1.stride() == 21 && aligned1 == matrix1);
+
+	// every row of a padded matrix starts on a cache line, the padding isn't part of the matrix
+	assert(padded1.stride() == 24 && padded2.stride() == 40);
+	for (i = 0; i < 37; ++i)
+	{
+		assert((reinterpret_cast<std::uintptr_t>(&padded1(i, 0)) % MATRIX_ALIGNMENT) == 0);
+	}
+	assert(padded1 == matrix1);
+	Matrix<Complex>::const_iterator it = matrix1.begin();
+	int count = 0;
+	for (const Complex& element : padded1)
+	{
+		assert(element == *it);
+		++it;
+		++count;
+	}
+	assert(count == 37 * 21);
+	PaddedMatrix<Complex>::const_iterator last = padded1.end();
+	--last;
+	assert(*last == matrix1(36, 20));
+
+	assert(padded1 + padded1 - padded1 == matrix1);
+	assert(padded1 * padded2 == matrix1 * matrix2);
+	assert(padded1.trans() == matrix1.trans());
+	assert(padded1.transView() * padded1 == matrix1.transView() * matrix1);
+	assert(padded1 * (padded2 + padded2) == matrix1 * (matrix2 + matrix2));
+	PaddedMatrix<Complex> transposed(21, 37);
+	transposed = padded1.transView();
+	assert(transposed == matrix1.trans());
+	Matrix<Complex>::setGaussMultiply(true);
+	assert(padded1 * padded2 == matrix1 * matrix2);
+	Matrix<Complex>::setGaussMultiply(false);
+
+	std::vector<double, AlignedAllocator<double, MATRIX_ALIGNMENT, true>> cells(reals.begin(), reals.end());
+	PaddedMatrix<double> adopted(37, 21, std::move(cells));
+	assert(adopted.stride() == 24 && adopted == Matrix<double>(37, 21, reals));
+
+	const std::string path = "aligned_file_test.bin";
+	writeMatrixFile(path, adopted);
+	assert(readMatrixFile<double>(path) == Matrix<double>(37, 21, reals));
+	std::remove(path.c_str());
+	std::cout << "Aligned storage test passed" << std::endl;
+}
+
+void testFixedMatrix()
+{
+	std::cout << "========FIXED SIZE MATRIX TEST========" << std::endl;
+	std::vector<Complex> vec1, vec2, vec3;
+	int i;
+	for (i = 0; i < 12; ++i)
+	{
+		vec1.push_back(Complex(i % 7 - 3, i % 5 - 2));
+		vec2.push_back(Complex(i % 3 - 1, i % 11 - 5));
+		vec3.push_back(Complex(i % 4, -i));
+	}
+	Matrix<Complex> matrix1(3, 4, vec1), matrix2(4, 3, vec2), matrix3(3, 4, vec3);
+	FixedMatrix<Complex, 3, 4> fixed1(vec1), fixed3(matrix3);
+	FixedMatrix<Complex, 4, 3> fixed2(matrix2);
+	static_assert(FixedMatrix<Complex, 3, 4>::rows() == 3 && FixedMatrix<Complex, 3, 4>::cols() == 4,
+				  "the dimensions are compile time constants");
+	assert(fixed1.toMatrix() == matrix1);
+	assert((fixed1 + fixed3).toMatrix() == matrix1 + matrix3);
+	assert((fixed1 - fixed3).toMatrix() == matrix1 - matrix3);
+	FixedMatrix<Complex, 3, 3> product = fixed1 * fixed2;
+	assert(product.toMatrix() == matrix1 * matrix2);
+	assert((fixed2 * fixed1).toMatrix() == matrix2 * matrix1);
+	assert(fixed1.trans().toMatrix() == matrix1.trans());
+	assert(fixed1.trans().trans() == fixed1 && fixed1 != fixed3);
+	assert(fixed1(2, 3) == matrix1(2, 3) && *(fixed1.end() - 1) == matrix1(2, 3));
+
+	std::ostringstream fixedText, text;
+	fixedText << fixed1;
+	text << matrix1;
+	assert(fixedText.str() == text.str());
+
+	FixedMatrix<double, 4, 4> identity;
+	for (i = 0; i < 4; ++i)
+	{
+		identity(i, i) = 1;
+	}
+	FixedMatrix<double, 4, 4> rotation(std::vector<double>{0, -1, 0, 0, 1, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1});
+	assert(rotation * rotation.trans() == identity && identity * rotation == rotation);
+
+	// 1024 elements unroll without exceeding the template instantiation depth
+	std::vector<double> large;
+	for (i = 0; i < 32 * 32; ++i)
+	{
+		large.push_back(i % 9 - 4);
+	}
+	FixedMatrix<double, 32, 32> fixedLarge(large);
+	assert((fixedLarge + fixedLarge).toMatrix() == Matrix<double>(32, 32, large) + Matrix<double>(32, 32, large));
+
+	bool thrown = false;
+	try
+	{
+		FixedMatrix<Complex, 4, 4> wrong(matrix1);
+	}
+	catch (const std::invalid_argument& e)
+	{
+		thrown = std::string(e.what()) == FIXED_SIZE_EXCEPTION_MSG;
+	}
+	assert(thrown);
+	std::cout << "Fixed size matrix test passed" << std::endl;
+}
+
+void testMatrixBatch()
+{
+	std::cout << "========MATRIX BATCH TEST========" << std::endl;
+	std::vector<Matrix<Complex>> lhs, rhs, other;
+	unsigned int b;
+	int i;
+	for (b = 0; b < 37; ++b)
+	{
+		std::vector<Complex> vec1, vec2, vec3;
+		for (i = 0; i < 12; ++i)
+		{
+			vec1.push_back(Complex((i + b) % 7 - 3, i % 5 - 2));
+			vec2.push_back(Complex(i % 3 - 1, (i * b) % 11 - 5));
+			vec3.push_back(Complex(b, -i));
+		}
+		lhs.push_back(Matrix<Complex>(3, 4, vec1));
+		rhs.push_back(Matrix<Complex>(4, 3, vec2));
+		other.push_back(Matrix<Complex>(3, 4, vec3));
+	}
+	MatrixBatch<Complex> lhsBatch(lhs), rhsBatch(rhs), otherBatch(other);
+	assert(lhsBatch.size() == 37 && lhsBatch.stride() == 12);
+	MatrixBatch<Complex> products = lhsBatch * rhsBatch, sums = lhsBatch + otherBatch;
+	MatrixBatch<Complex> differences = lhsBatch - otherBatch, transposed = lhsBatch.trans();
+	assert(products.rows() == 3 && products.cols() == 3 && transposed.rows() == 4);
+	for (b = 0; b < 37; ++b)
+	{
+		assert(products.matrix(b) == lhs[b] * rhs[b]);
+		assert(sums.matrix(b) == lhs[b] + other[b]);
+		assert(differences.matrix(b) == lhs[b] - other[b]);
+		assert(transposed.matrix(b) == lhs[b].trans());
+	}
+	assert(transposed.trans() == lhsBatch && sums != lhsBatch);
+
+	// a large double batch runs on the thread pool in parallel mode
+	const std::size_t count = 5003;
+	std::vector<double> cells1(count * 16), cells2(count * 16);
+	std::size_t e;
+	for (e = 0; e < cells1.size(); ++e)
+	{
+		cells1[e] = (double) (e % 13) - 6;
+		cells2[e] = (double) (e % 7) - 3;
+	}
+	MatrixBatch<double> batch1(count, 4, 4, cells1), batch2(count, 4, 4, cells2);
+	Matrix<double>::setParallel(true);
+	MatrixBatch<double> parallelProducts = batch1 * batch2, parallelSums = batch1 + batch2;
+	Matrix<double>::setParallel(false);
+	assert(parallelProducts == batch1 * batch2 && parallelSums == batch1 + batch2);
+	assert(parallelProducts.matrix(count - 1) == batch1.matrix(count - 1) * batch2.matrix(count - 1));
+	assert(parallelSums.matrix(1234) == batch1.matrix(1234) + batch2.matrix(1234));
+
+	// strided batches may leave gaps between the matrices
+	std::vector<double> out(3 * 20, -1);
+	batchMultiply(cells1.data(), 16, cells2.data(), 32, out.data(), 20, 4, 4, 4, 3);
+	Matrix<double> strided(4, 4, std::vector<double>(out.begin() + 20, out.begin() + 36));
+	assert(strided == batch1.matrix(1) * batch2.matrix(2) && out[16] == -1);
+
+	bool thrown = false;
+	try
+	{
+		lhsBatch * lhsBatch;
+	}
+	catch (const std::invalid_argument& e)
+	{
+		thrown = true;
+	}
+	assert(thrown);
+	std::cout << "Matrix batch test passed" << std::endl;
+}
+
+void testInstrumentation()
+{
+	std::cout << "========INSTRUMENTATION TEST========" << std::endl;
+	std::vector<double> cells(12, 1.5);
+	Matrix<double> matrix1(3, 4, cells), matrix2(4, 3, cells);
+	MatrixInstrumentation& record = MatrixInstrumentation::instance();
+	record.reset();
+
+	Matrix<double> sum = matrix1 + matrix1 - matrix1;
+	Matrix<double> product = matrix1 * matrix2;
+	product = matrix1 * matrix2;
+	Matrix<double> transposed = matrix1.trans();
+	Matrix<double> copy(transposed);
+	assert(sum == matrix1 && copy.rows() == 4);
+
+	assert(record.statistics(INSTRUMENT_PLUS).calls == 1 && record.statistics(INSTRUMENT_MINUS).calls == 1);
+	assert(record.statistics(INSTRUMENT_EVALUATE).calls == 1);
+	InstrumentStats multiply = record.statistics(INSTRUMENT_MULTIPLY);
+	assert(multiply.calls == 2 && multiply.shapes.size() == 1 && multiply.shapes["3x4x3"] == 2);
+	assert(multiply.minNs <= multiply.maxNs && multiply.totalNs >= multiply.maxNs);
+	unsigned long bucketed = 0;
+	for (unsigned long count : multiply.latency)
+	{
+		bucketed += count;
+	}
+	assert(bucketed == 2);
+	// the result matrices a product or a transpose builds aren't counted as constructor calls
+	assert(record.statistics(INSTRUMENT_TRANS).calls == 1 && record.statistics(INSTRUMENT_TRANS).shapes["4x3"] == 1);
+	assert(record.statistics(INSTRUMENT_CONSTRUCT).calls == 1);
+	assert(record.bytesAllocated() >= (3 * 12 + 2 * 9) * sizeof(double));
+
+	std::ostringstream text, json;
+	record.writeText(text);
+	record.writeJson(json);
+	assert(text.str().find("multiply: 2 calls") != std::string::npos);
+	assert(json.str().find("\"multiply\": {\"calls\": 2") != std::string::npos);
+	assert(json.str().find("\"shapes\": {\"3x4x3\": 2}") != std::string::npos);
+
+	// a construction rejected by the size check allocates nothing
+	const unsigned long long allocated = record.bytesAllocated();
+	try
+	{
+		Matrix<double> wrongSize(5, 5, cells);
+		assert(false);
+	}
+	catch (const std::invalid_argument&)
+	{
+	}
+	assert(record.bytesAllocated() == allocated);
+	record.reset();
+	assert(record.statistics(INSTRUMENT_MULTIPLY).calls == 0 && record.bytesAllocated() == 0);
+	std::cout << "Instrumentation test passed" << std::endl;
+}
+
+void testSplitComplex()
+{
+	std::cout << "========SPLIT COMPLEX MATRIX TEST========" << std::endl;
+	std::vector<Complex> vec1, vec2;
+	int i;
+	for (i = 0; i < 40 * 40; ++i)
+	{
+		vec1.push_back(Complex(i % 7 - 3, i % 5 - 2));
+		vec2.push_back(Complex(i % 3 - 1, i % 11 - 5));
+	}
+	Matrix<Complex> matrix1(40, 40, vec1), matrix2(40, 40, vec2);
+	SplitComplexMatrix split1(matrix1), split2(40, 40, vec2);
+	assert(split1.toMatrix() == matrix1);
+	assert(split1 != split2);
+	assert((split1 + split2).toMatrix() == matrix1 + matrix2);
+	assert((split1 - split2).toMatrix() == matrix1 - matrix2);
+	assert(split1.trans().toMatrix() == matrix1.trans());
+	Matrix<Complex> wide(8, 200, vec1);
+	SplitComplexMatrix splitWide(wide);
+	assert(splitWide.trans().rows() == 200 && splitWide.trans().toMatrix() == wide.trans());
+	assert((splitWide * splitWide.trans()).toMatrix() == wide * wide.trans());
+
+	// small integer parts keep every intermediate value exact
+	Matrix<Complex> product = matrix1 * matrix2.trans();
+	assert((split1 * split2.trans()).toMatrix() == product);
+
+	split1(2, 3) = Complex(1.5, -2.5);
+	assert(Complex(split1(2, 3)) == Complex(1.5, -2.5));
+	matrix1(2, 3) = Complex(1.5, -2.5);
+	std::ostringstream splitOut, matrixOut;
+	splitOut << split1;
+	matrixOut << matrix1;
+	assert(splitOut.str() == matrixOut.str());
+
+	Matrix<Complex>::const_iterator it = matrix1.begin();
+	for (Complex element : split1)
+	{
+		assert(element == *it);
+		++it;
+	}
+	std::cout << "Split complex matrix test passed" << std::endl;
+}
+
+void testBlockedTrans()
+{
+	std::cout << "========BLOCKED TRANSPOSE TEST========" << std::endl;
+	unsigned int rows = 150, cols = 77, i, j;
+	std::vector<int> vec;
+	for (i = 0; i < rows * cols; ++i)
+	{
+		vec.push_back((int) i);
+	}
+	Matrix<int> matrix(rows, cols, vec);
+	Matrix<int> trans = matrix.trans();
+	assert(trans.rows() == cols && trans.cols() == rows);
+	for (i = 0; i < rows; ++i)
+	{
+		for (j = 0; j < cols; ++j)
+		{
+			assert(trans(j, i) == matrix(i, j));
+		}
+	}
+	assert(trans.trans() == matrix);
+
+	Matrix<int>::setParallel(true);
+	assert(matrix.trans() == trans);
+	Matrix<int>::setParallel(false);
+
+	std::vector<Complex> cells;
+	for (i = 0; i < 100 * 100; ++i)
+	{
+		cells.push_back(Complex(i % 13, (double) i - 5000));
+	}
+	Matrix<Complex> square(100, 100, cells);
+	Matrix<Complex> inPlace = square;
+	inPlace.transInPlace();
+	assert(inPlace == square.trans());
+	inPlace.transInPlace();
+	assert(inPlace == square);
+
+	bool thrown = false;
+	try
+	{
+		matrix.transInPlace();
+	}
+	catch (const std::logic_error& e)
+	{
+		thrown = true;
+	}
+	assert(thrown);
+	std::cout << "Blocked transpose test passed" << std::endl;
+}
+
+void testTransView()
+{
+	std::cout << "========TRANSPOSED VIEW TEST========" << std::endl;
+	std::vector<Complex> vec1, vec2;
+	int i;
+	for (i = 0; i < 90 * 60; ++i)
+	{
+		vec1.push_back(Complex(i % 7 - 3, i % 5 - 2));
+		vec2.push_back(Complex(i % 3 - 1, i % 11 - 5));
+	}
+	Matrix<Complex> matrix1(90, 60, vec1), matrix2(90, 60, vec2);
+
+	// small integer parts keep every intermediate value exact
+	assert(matrix1.transView() * matrix2 == matrix1.trans() * matrix2);
+	assert(matrix1 * matrix2.transView() == matrix1 * matrix2.trans());
+	Matrix<Complex> trans2 = matrix2.trans();
+	assert(matrix1.transView() * trans2.transView() == matrix1.trans() * matrix2);
+	Matrix<Complex>::setParallel(true);
+	assert(matrix1.transView() * matrix1 == matrix1.trans() * matrix1);
+	assert(matrix1 * matrix1.transView() == matrix1 * matrix1.trans());
+	Matrix<Complex>::setParallel(false);
+
+	Matrix<Complex> trans = matrix1.transView();
+	assert(trans == matrix1.trans());
+	assert(matrix1.transView() + matrix2.transView() == (matrix1 + matrix2).trans());
+
+	// assigning a view of the matrix itself must not read overwritten elements
+	Matrix<Complex> square = matrix1 * matrix1.transView();
+	Matrix<Complex> expected = square.trans();
+	Matrix<Complex> sum = square + expected;
+	Matrix<Complex> copy = square;
+	copy += copy.transView();
+	assert(copy == sum);
+	copy = square;
+	copy = copy.transView();
+	assert(copy == expected);
+	copy = square;
+	copy = copy.transView() - square;
+	assert(copy == expected - square);
+	std::cout << "Transposed view test passed" << std::endl;
+}
+
+void testMatrixFile()
+{
+	std::cout << "========BINARY MATRIX FILE TEST========" << std::endl;
+	std::vector<Complex> cells;
+	int i;
+	for (i = 0; i < 37 * 21; ++i)
+	{
+		cells.push_back(Complex(i * 0.25, -i / 3.0));
+	}
+	Matrix<Complex> matrix(37, 21, cells);
+	const std::string path = "matrix_file_test.bin";
+	writeMatrixFile(path, matrix);
+	assert(isMatrixFile(path));
+
+	Matrix<Complex> read = readMatrixFile<Complex>(path);
+	assert(read.rows() == 37 && read.cols() == 21);
+	Matrix<Complex>::const_iterator it = read.begin();
+	for (const Complex& element : matrix)
+	{
+		assert(it->getReal() == element.getReal() && it->getImaginary() == element.getImaginary());
+		++it;
+	}
+	{
+		MappedMatrix<Complex> mapped(path);
+		Matrix<Complex> sum = mapped + matrix;
+		assert(sum == matrix + matrix);
+	}
+
+	bool thrown = false;
+	try
+	{
+		MappedMatrix<double> mapped(path);
+	}
+	catch (const std::runtime_error& e)
+	{
+		thrown = true;
+	}
+	assert(thrown);
+	std::remove(path.c_str());
+	assert(!isMatrixFile(path));
+
+	Matrix<int> empty(0, 5);
+	writeMatrixFile(path, empty);
+	Matrix<int> readEmpty = readMatrixFile<int>(path);
+	assert(readEmpty.rows() == 0 && readEmpty.cols() == 5);
+	std::remove(path.c_str());
+	std::cout << "Binary matrix file test passed" << std::endl;
+}
+
+void testStreamMultiply()
+{
+	std::cout << "========STREAMING MULTIPLY TEST========" << std::endl;
+	std::vector<Complex> lhsCells, rhsCells;
+	int i;
+	for (i = 0; i < 53 * 19; ++i)
+	{
+		lhsCells.push_back(Complex(i % 7 - 3, i % 5 * 0.5));
+		rhsCells.push_back(Complex(i % 3, 2 - i % 11));
+	}
+	Matrix<Complex> lhs(53, 19, lhsCells);
+	Matrix<Complex> rhs(19, 53, rhsCells);
+	Matrix<Complex> rhsRows(53, 19, rhsCells);
+	const std::string lhsPath = "stream_lhs_test.bin";
+	const std::string rhsPath = "stream_rhs_test.bin";
+	const std::string resultPath = "stream_result_test.bin";
+	writeMatrixFile(lhsPath, lhs);
+	writeMatrixFile(rhsPath, rhsRows);
+
+	// from a single row at a time to the whole matrix in one panel
+	// panels of 40 rows take the blocked kernel with rhs packed once, the last 13 rows don't
+	std::size_t limits[] = {1, 40 * sizeof(Complex), 1000 * sizeof(Complex), 40 * (19 + 53) * sizeof(Complex),
+							STREAM_DEFAULT_MEMORY_LIMIT};
+	for (std::size_t limit : limits)
+	{
+		streamMultiply(lhsPath, rhs, resultPath, limit);
+		assert(readMatrixFile<Complex>(resultPath) == lhs * rhs);
+		streamMultiplyTrans<Complex>(lhsPath, rhsPath, resultPath, limit);
+		assert(readMatrixFile<Complex>(resultPath) == lhs * rhsRows.trans());
+		streamMultiplyTrans<Complex>(lhsPath, lhsPath, resultPath, limit);
+		assert(readMatrixFile<Complex>(resultPath) == lhs * lhs.trans());
+		assert(streamTransMultiply<Complex>(lhsPath, rhsPath, limit) == lhs.trans() * rhsRows);
+	}
+
+	// the Gram matrix of a tall matrix keeps only the small product in memory
+	std::vector<Complex> tallCells;
+	for (i = 0; i < 301 * 7; ++i)
+	{
+		tallCells.push_back(Complex((i % 9) * 0.37 - 1.1, (i % 4) * 0.13));
+	}
+	Matrix<Complex> tall(301, 7, tallCells);
+	writeMatrixFile(lhsPath, tall);
+	std::size_t tallLimits[] = {1, 50 * 7 * sizeof(Complex), STREAM_DEFAULT_MEMORY_LIMIT};
+	for (std::size_t limit : tallLimits)
+	{
+		Matrix<Complex> gram = streamTransMultiply<Complex>(lhsPath, lhsPath, limit);
+		assert(gram.rows() == 7 && gram.cols() == 7);
+		assert(gram == tall.trans() * tall && gram == tall.transView() * tall);
+	}
+	writeMatrixFile(lhsPath, lhs);
+
+	MatrixFileReader<Complex> reader(lhsPath);
+	assert(reader.rows() == 53 && reader.cols() == 19);
+	Matrix<Complex> panel = reader.readRows(50, 3);
+	assert(panel.rows() == 3 && panel(2, 18) == lhs(52, 18));
+	bool thrown = false;
+	try
+	{
+		reader.readRows(50, 4);
+	}
+	catch (const std::out_of_range& e)
+	{
+		thrown = true;
+	}
+	assert(thrown);
+
+	thrown = false;
+	try
+	{
+		streamMultiply(lhsPath, lhs, resultPath);
+	}
+	catch (const std::invalid_argument& e)
+	{
+		thrown = true;
+	}
+	assert(thrown);
+
+	thrown = false;
+	try
+	{
+		writeMatrixFile(resultPath, tall);
+		streamTransMultiply<Complex>(lhsPath, resultPath);
+	}
+	catch (const std::invalid_argument& e)
+	{
+		thrown = true;
+	}
+	assert(thrown);
+
+	thrown = false;
+	try
+	{
+		MatrixFileWriter<Complex> writer(resultPath, 4, 19);
+		writer.write(panel);
+		writer.close();
+	}
+	catch (const std::invalid_argument& e)
+	{
+		thrown = true;
+	}
+	assert(thrown);
+	std::remove(lhsPath.c_str());
+	std::remove(rhsPath.c_str());
+	std::remove(resultPath.c_str());
+	std::cout << "Streaming multiply test passed" << std::endl;
+}
+
+void testSparseMatrix()
+{
+	std::cout << "========SPARSE MATRIX TEST========" << std::endl;
+	std::vector<Complex> cells(23 * 31), otherCells(23 * 31), rhsCells(31 * 17);
+	int i;
+	for (i = 0; i < 23 * 31; ++i)
+	{
+		if (i % 7 == 0)
+		{
+			cells[i] = Complex(i % 5 - 2, i % 3);
+		}
+		if (i % 11 == 0)
+		{
+			otherCells[i] = Complex(1, -(i % 4));
+		}
+	}
+	for (i = 0; i < 31 * 17; ++i)
+	{
+		rhsCells[i] = Complex(i % 9 - 4, i % 2);
+	}
+	Matrix<Complex> dense(23, 31, cells);
+	Matrix<Complex> otherDense(23, 31, otherCells);
+	Matrix<Complex> rhs(31, 17, rhsCells);
+	assert(isSparse(dense, 0.2) && !isSparse(dense, 0.1));
+
+	SparseMatrix<Complex> sparse(dense);
+	SparseMatrix<Complex> other(otherDense);
+	assert(sparse.rows() == 23 && sparse.cols() == 31);
+	assert(sparse.toMatrix() == dense);
+	assert(sparse(0, 7) == dense(0, 7) && sparse(0, 1) == Complex(0));
+	assert(sparse.nonZeros() < 23 * 31 / 7 + 1 && sparse.density() < 0.15);
+
+	// elements below the Complex comparison tolerance are still non zero
+	Matrix<Complex> tiny(2, 2);
+	tiny(0, 1) = Complex(1e-20, 0);
+	tiny(1, 0) = Complex(0, -1e-20);
+	SparseMatrix<Complex> tinySparse(tiny);
+	assert(tinySparse.nonZeros() == 2 && !isSparse(tiny, 0.25));
+	Matrix<Complex> tinyDense = tinySparse.toMatrix();
+	assert(tinyDense(0, 1).getReal() == 1e-20 && tinyDense(1, 0).getImaginary() == -1e-20);
+
+	assert(sparse * rhs == dense * rhs);
+	assert((sparse + other).toMatrix() == dense + otherDense);
+	assert(sparse.trans().toMatrix() == dense.trans());
+	assert(sparse.trans().trans().toMatrix() == dense);
+
+	std::vector<Complex> vector(31);
+	for (i = 0; i < 31; ++i)
+	{
+		vector[i] = Complex(i, 1);
+	}
+	std::vector<Complex> product = sparse * vector;
+	Matrix<Complex> expected = dense * Matrix<Complex>(31, 1, vector);
+	for (i = 0; i < 23; ++i)
+	{
+		assert(product[i] == expected(i, 0));
+	}
+
+	SparseMatrix<int> structured(2, 3, {0, 2, 3}, {0, 2, 1}, {4, 5, 6});
+	assert(structured(0, 2) == 5 && structured(1, 1) == 6 && structured(1, 0) == 0);
+	bool thrown = false;
+	try
+	{
+		SparseMatrix<int> unsorted(2, 3, {0, 2, 3}, {2, 0, 1}, {4, 5, 6});
+	}
+	catch (const std::invalid_argument& e)
+	{
+		thrown = true;
+	}
+	assert(thrown);
+	thrown = false;
+	try
+	{
+		sparse * dense;
+	}
+	catch (const std::invalid_argument& e)
+	{
+		thrown = true;
+	}
+	assert(thrown);
+
+	SparseMatrix<double> empty(0, 4);
+	assert(empty.toMatrix().rows() == 0 && empty.trans().rows() == 4 && empty.density() == 0);
+	std::cout << "Sparse matrix test passed" << std::endl;
+}
+
+void testMatrixParser()
+{
+	std::cout << "========MATRIX TEXT PARSER TEST========" << std::endl;
+	const char* numbers[] = {"0", "-0", "1.5", "-2.25e3", "3.", ".5", "1e22", "1e23", "123456789012345678901",
+							 "0.1000000000000000055511151231257827", "4.9e-324", "1e-300", "0x1p3", "inf",
+							 "2.2250738585072014e-308", "9007199254740993", "+7.125E-2"};
+	for (const char* number : numbers)
+	{
+		const char* pos = number;
+		double value = 1;
+		assert(parseNumber(pos, number + std::strlen(number), value));
+		double expected = std::strtod(number, nullptr);
+		assert(std::memcmp(&value, &expected, sizeof(double)) == 0 && *pos == '\0');
+	}
+	int integer;
+	const char* text = "-42,";
+	assert(parseNumber(text, text + 4, integer) && integer == -42 && *text == ',');
+
+	text = "2 3\n1 2 3\n-4 5 6\n";
+	Matrix<int> ints = parseMatrixText<int>(text, std::strlen(text));
+	assert(ints.rows() == 2 && ints.cols() == 3 && ints(1, 0) == -4 && ints(1, 2) == 6);
+	text = "1 2\r\n1.5 -2 0.25 3\r\n";
+	Matrix<Complex> complexes = parseMatrixText<Complex>(text, std::strlen(text));
+	assert(complexes(0, 0) == Complex(1.5, -2) && complexes(0, 1) == Complex(0.25, 3));
+
+	bool thrown = false;
+	try
+	{
+		text = "2 2\n1 2 3\n";
+		parseMatrixText<double>(text, std::strlen(text));
+	}
+	catch (const std::invalid_argument& e)
+	{
+		thrown = true;
+	}
+	assert(thrown);
+
+	// large enough to be parsed in chunks on the thread pool
+	unsigned int rows = 300, cols = 400, i, j;
+	std::string large = std::to_string(rows) + " " + std::to_string(cols) + "\n";
+	std::vector<double> cells;
+	char buffer[32];
+	for (i = 0; i < rows; ++i)
+	{
+		for (j = 0; j < cols; ++j)
+		{
+			cells.push_back((i * 7919.0 + j) / 977.0 - 60);
+			std::snprintf(buffer, sizeof(buffer), "%.17g ", cells.back());
+			large += buffer;
+		}
+		large += "\n";
+	}
+	Matrix<double> parsed = parseMatrixText<double>(large.data(), large.size());
+	Matrix<double>::const_iterator it = parsed.begin();
+	for (double cell : cells)
+	{
+		assert(*it == cell);
+		++it;
+	}
+
+	// full precision and tiny numbers take the strtod fallback, which reads a '.' decimal point
+	// even when LC_NUMERIC uses a comma
+	const char* precise[] = {"0.10000000000000001", "-1.2345678901234567e-30", "1e-30", "3.1415926535897931",
+							 "6.0221407599999999e+23", "9007199254740993"};
+	double expectedPrecise[6];
+	for (i = 0; i < 6; ++i)
+	{
+		expectedPrecise[i] = std::strtod(precise[i], nullptr);
+	}
+	const char* commaLocales[] = {"de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "fr_FR.utf8", "ru_RU.UTF-8"};
+	bool commaLocale = false;
+	for (const char* name : commaLocales)
+	{
+		if (!commaLocale && std::setlocale(LC_NUMERIC, name) != nullptr)
+		{
+			commaLocale = std::localeconv()->decimal_point[0] == ',';
+		}
+	}
+	for (i = 0; i < 6; ++i)
+	{
+		const char* pos = precise[i];
+		double value = 0;
+		assert(parseNumber(pos, precise[i] + std::strlen(precise[i]), value) && *pos == '\0');
+		assert(std::memcmp(&value, &expectedPrecise[i], sizeof(double)) == 0);
+	}
+	text = "1 2\n0.10000000000000001 -1.2345678901234567e-30\n";
+	Matrix<double> precisePair = parseMatrixText<double>(text, std::strlen(text));
+	assert(precisePair(0, 0) == expectedPrecise[0] && precisePair(0, 1) == expectedPrecise[1]);
+	std::setlocale(LC_NUMERIC, "C");
+	std::cout << "Full precision numbers parsed " << (commaLocale ? "under a comma LC_NUMERIC" : "in the C locale")
+			  << std::endl;
+	std::cout << "Matrix text parser test passed" << std::endl;
+}
+
+template <typename T>
+std::string streamedText(const Matrix<T>& matrix, int precision)
+{
+	std::ostringstream stream;
+	stream.precision(precision);
+	unsigned int i, j;
+	for (i = 0; i < matrix.rows(); ++i)
+	{
+		for (j = 0; j < matrix.cols(); ++j)
+		{
+			stream << matrix(i, j) << '\t';
+		}
+		stream << '\n';
+	}
+	return stream.str();
+}
+
+void testFormatMatrixText()
+{
+	std::cout << "========MATRIX TEXT FORMAT TEST========" << std::endl;
+	std::vector<double> doubles = {0, -0.0, 1, -1, 2.5, 1e-7, 123456, 1234567, -999999.5, 1.0 / 3, 1e300,
+								   -2147483648.0, 0.1, 100, 1e15, 1e16, 12345678901234567.0, 7, 8, 9.5};
+	std::vector<int> ints = {0, -1, 2147483647, -2147483647 - 1, 42, 7};
+	std::vector<Complex> complexes = {Complex(1, 2), Complex(-1.5, -2.25), Complex(0, -0.0), Complex(1e-9, 3),
+									  Complex(-0.0, 1e10), Complex(2, -7)};
+	Matrix<double> doubleMatrix(4, 5, doubles);
+	Matrix<int> intMatrix(2, 3, ints);
+	Matrix<Complex> complexMatrix(3, 2, complexes);
+	int precision;
+	for (precision = 0; precision <= 20; ++precision)
+	{
+		std::string text;
+		formatMatrixText(doubleMatrix, text, precision);
+		assert(text == streamedText(doubleMatrix, precision));
+		text.clear();
+		formatMatrixText(complexMatrix, text, precision);
+		assert(text == streamedText(complexMatrix, precision));
+	}
+
+	std::ostringstream out;
+	out << intMatrix << doubleMatrix << complexMatrix;
+	assert(out.str() == streamedText(intMatrix, 6) + streamedText(doubleMatrix, 6) + streamedText(complexMatrix, 6));
+
+	// non default formatting goes through the stream
+	std::ostringstream fixed, fixedExpected;
+	fixed << std::fixed << doubleMatrix;
+	fixedExpected << std::fixed;
+	unsigned int i, j;
+	for (i = 0; i < doubleMatrix.rows(); ++i)
+	{
+		for (j = 0; j < doubleMatrix.cols(); ++j)
+		{
+			fixedExpected << doubleMatrix(i, j) << '\t';
+		}
+		fixedExpected << '\n';
+	}
+	assert(fixed.str() == fixedExpected.str());
+	std::cout << "Matrix text format test passed" << std::endl;
+}
+
+void testWorkStealing()
+{
+	std::cout << "========WORK STEALING TEST========" << std::endl;
+	const unsigned int defaultThreads = Matrix<int>::threadCount();
+	Matrix<int>::setThreadCount(4);
+	assert(Matrix<int>::threadCount() == 4);
+	ThreadPool& pool = ThreadPool::instance();
+
+	// every index is visited once, also by nested loops
+	std::vector<std::atomic<unsigned int>> visits(1000);
+	pool.parallelFor(100, [&](unsigned int first, unsigned int last)
+	{
+		unsigned int i;
+		for (i = first; i < last; ++i)
+		{
+			pool.parallelFor(10, [&, i](unsigned int innerFirst, unsigned int innerLast)
+			{
+				unsigned int j;
+				for (j = innerFirst; j < innerLast; ++j)
+				{
+					++visits[i * 10 + j];
+				}
+			});
+		}
+	});
+	for (std::atomic<unsigned int>& count : visits)
+	{
+		assert(count == 1);
+	}
+	std::cout << "Nested parallel loops cover their ranges once" << std::endl;
+
+	std::atomic<bool> thrown(false);
+	try
+	{
+		pool.invoke([] {}, [] { throw std::out_of_range(OUT_OF_RANGE_MSG); });
+	}
+	catch (const std::out_of_range&)
+	{
+		thrown = true;
+	}
+	assert(thrown);
+	std::cout << "A forked task exception reaches the caller" << std::endl;
+
+	// tall and wide matrices, multiplied and transposed from several threads at once
+	std::vector<double> cells;
+	unsigned int i;
+	for (i = 0; i < 20000 * 10; ++i)
+	{
+		cells.push_back((double) (i % 23) - 11);
+	}
+	Matrix<double> tall(20000, 10, cells), wide(10, 20000, cells);
+	Matrix<double> tallTrans = tall.trans(), wideTrans = wide.trans(), product = wide * tall;
+	Matrix<double> square = tall.trans() * tall;
+	Matrix<double> inPlace(300, 300, std::vector<double>(cells.begin(), cells.begin() + 300 * 300));
+	Matrix<double> inPlaceTrans = inPlace.trans();
+
+	Matrix<double>::setParallel(true);
+	std::vector<std::thread> callers;
+	std::atomic<unsigned int> matches(0);
+	for (i = 0; i < 3; ++i)
+	{
+		callers.push_back(std::thread([&]
+		{
+			if (tall.trans() == tallTrans && wide.trans() == wideTrans && tall.trans() * tall == square)
+			{
+				++matches;
+			}
+		}));
+	}
+	assert(wide * tall == product);
+	for (std::thread& caller : callers)
+	{
+		caller.join();
+	}
+	assert(matches == 3);
+	inPlace.transInPlace();
+	assert(inPlace == inPlaceTrans);
+	std::cout << "Parallel results from several threads equal the serial results" << std::endl;
+
+	// the forked Strassen products aren't recorded as separate operations
+	Matrix<int>::setStrassen(true);
+	Matrix<int>::setStrassenCutoff(16);
+	std::vector<int> intCells(100 * 100, 3);
+	Matrix<int> intMatrix(100, 100, intCells);
+	MatrixInstrumentation::instance().reset();
+	Matrix<int> strassen = intMatrix * intMatrix;
+	assert(MatrixInstrumentation::instance().statistics(INSTRUMENT_MULTIPLY).calls == 1);
+	assert(MatrixInstrumentation::instance().statistics(INSTRUMENT_PLUS).calls == 0);
+	assert(strassen == Matrix<int>(100, 100, std::vector<int>(100 * 100, 900)));
+	Matrix<int>::setStrassen(false);
+	Matrix<int>::setStrassenCutoff(STRASSEN_DEFAULT_CUTOFF);
+	std::cout << "Parallel Strassen products equal the classic product" << std::endl;
+
+	Matrix<double>::setParallel(false);
+	Matrix<int>::setThreadCount(defaultThreads);
+}
+
+void testNumaAllocation()
+{
+	std::cout << "========NUMA ALLOCATION TEST========" << std::endl;
+	NumaTopology& topology = NumaTopology::instance();
+	topology.setFakeNodes(2);
+	assert(topology.nodes() == 2 && topology.isFake());
+	assert(topology.pageNode(NUMA_FIRST_TOUCH, 0, 8) == 0 && topology.pageNode(NUMA_FIRST_TOUCH, 3, 8) == 0);
+	assert(topology.pageNode(NUMA_FIRST_TOUCH, 4, 8) == 1 && topology.pageNode(NUMA_FIRST_TOUCH, 7, 8) == 1);
+	assert(topology.pageNode(NUMA_INTERLEAVE, 4, 8) == 0 && topology.pageNode(NUMA_INTERLEAVE, 5, 8) == 1);
+
+	// fake nodes split the storage but don't bind it
+	const std::size_t pageSize = (std::size_t) sysconf(_SC_PAGESIZE);
+	int mode;
+	unsigned long mask;
+	NumaMatrix<double> unbound(512, 512);
+	const bool policies = NumaTopology::pagePolicy(unbound.data(), mode, mask);
+	assert(!policies || mode != NUMA_MPOL_PREFERRED);
+	topology.setFakeNodes(0);
+	assert(!topology.isFake() && topology.nodes() >= 1);
+
+	// on the detected nodes the kernel reports the binding of every page of the 2MiB storage
+	NumaMatrix<double> firstTouch(512, 512);
+	InterleavedMatrix<double> interleaved(512, 512);
+	NumaMatrix<double> small(3, 3);
+	const std::size_t nPages = (512 * 512 * sizeof(double) + pageSize - 1) / pageSize;
+	const unsigned long allNodes = topology.nodes() >= NUMA_MAX_NODES ? ~0UL : (1UL << topology.nodes()) - 1;
+	std::size_t page;
+	for (page = 0; policies && page < nPages; ++page)
+	{
+		const char* firstTouchPage = reinterpret_cast<const char*>(firstTouch.data()) + page * pageSize;
+		assert(NumaTopology::pagePolicy(firstTouchPage, mode, mask));
+		assert(mode == NUMA_MPOL_PREFERRED && mask == 1UL << topology.pageNode(NUMA_FIRST_TOUCH, page, nPages));
+		const char* interleavedPage = reinterpret_cast<const char*>(interleaved.data()) + page * pageSize;
+		assert(NumaTopology::pagePolicy(interleavedPage, mode, mask));
+		assert(mode == NUMA_MPOL_INTERLEAVE && mask == allNodes);
+	}
+	std::cout << (policies ? "The kernel binds the pages by the policy" :
+				  "The kernel doesn't report memory policies, binding not checked") << std::endl;
+
+	std::vector<double> cells;
+	unsigned int i;
+	for (i = 0; i < 512 * 512; ++i)
+	{
+		cells.push_back((double) (i % 29) - 14);
+	}
+	Matrix<double> dense(512, 512, cells);
+	NumaMatrix<double> numa(512, 512, cells);
+	Matrix<double>::setParallel(true);
+	NumaMatrix<double> product = numa * numa;
+	Matrix<double> denseProduct = dense * dense;
+	Matrix<double>::setParallel(false);
+	unsigned int j;
+	for (i = 0; i < 512; ++i)
+	{
+		for (j = 0; j < 512; ++j)
+		{
+			assert(firstTouch(i, j) == 0 && interleaved(i, j) == 0 && unbound(i, j) == 0);
+			assert(product(i, j) == denseProduct(i, j));
+		}
+	}
+	assert(small(2, 2) == 0);
+	std::cout << "NUMA matrices compute like dense matrices" << std::endl;
+}
+
+void testSingleWriteEvaluation()
+{
+	std::cout << "========SINGLE WRITE EVALUATION TEST========" << std::endl;
+	// 40 x 37 elements span several evaluation chunks, the padded rows are shorter than a chunk
+	std::vector<double> reals1, reals2;
+	std::vector<int> ints;
+	unsigned int i, j;
+	for (i = 0; i < 40 * 37; ++i)
+	{
+		reals1.push_back((double) (i % 13) - 6.5);
+		reals2.push_back((double) (i % 7) * 0.5);
+		ints.push_back((int) (i % 11) - 5);
+	}
+	Matrix<double> dense1(40, 37, reals1), dense2(40, 37, reals2);
+	PaddedMatrix<double> padded1(40, 37, reals1), padded2(40, 37, reals2);
+	Matrix<double> sum(dense1 + dense2 - dense1 + dense2);
+	PaddedMatrix<double> paddedSum(padded1 + padded2 - padded1 + padded2);
+	assert(paddedSum.stride() == 40);
+	for (i = 0; i < 40; ++i)
+	{
+		for (j = 0; j < 37; ++j)
+		{
+			double expected = reals2[i * 37 + j] * 2;
+			assert(sum(i, j) == expected && paddedSum(i, j) == expected);
+		}
+		for (j = 37; j < 40; ++j)
+		{
+			assert((&paddedSum(i, 0))[j] == 0);
+		}
+	}
+	assert(Matrix<double>(dense1.transView()) == dense1.trans());
+	assert(PaddedMatrix<double>(padded1.transView()) == dense1.trans());
+	std::cout << "Expressions evaluated into new storage match the element values" << std::endl;
+
+	// the Strassen blocks of a 40 x 37 operand are copied with zero rows and columns around them
+	Matrix<int> lhs(40, 37, ints), rhs(37, 40, ints);
+	Matrix<int> classic = lhs * rhs;
+	Matrix<int>::setStrassen(true);
+	Matrix<int>::setStrassenCutoff(8);
+	assert(lhs * rhs == classic);
+	Matrix<int>::setStrassen(false);
+	Matrix<int>::setStrassenCutoff(STRASSEN_DEFAULT_CUTOFF);
+	std::cout << "Strassen blocks copied without a zero pass keep the product" << std::endl;
+
+	// 20 x 37 operands take the classic kernel, in parallel mode the row blocks write their rows
+	std::vector<int> topInts(ints.begin(), ints.begin() + 20 * 37), bottomInts(ints.end() - 20 * 37, ints.end());
+	Matrix<int> top(20, 37, topInts), bottom(20, 37, bottomInts);
+	PaddedMatrix<int> paddedTop(20, 37, topInts), paddedBottom(20, 37, bottomInts);
+	int parallel;
+	for (parallel = 0; parallel < 2; ++parallel)
+	{
+		Matrix<int>::setParallel(parallel != 0);
+		Matrix<int> product = top * bottom.trans(), viewProduct = top * bottom.transView();
+		PaddedMatrix<int> paddedProduct = paddedTop * paddedBottom.trans();
+		PaddedMatrix<int> paddedViewProduct = paddedTop * paddedBottom.transView();
+		for (i = 0; i < 20; ++i)
+		{
+			for (j = 0; j < 20; ++j)
+			{
+				int expected = 0, k;
+				for (k = 0; k < 37; ++k)
+				{
+					expected += topInts[i * 37 + k] * bottomInts[j * 37 + k];
+				}
+				assert(product(i, j) == expected && viewProduct(i, j) == expected);
+				assert(paddedProduct(i, j) == expected && paddedViewProduct(i, j) == expected);
+			}
+		}
+	}
+	Matrix<int>::setParallel(false);
+	std::cout << "Product rows written without a zero pass match the element values" << std::endl;
+}
+
 int main() {
 	testVectorCtor();
 	testDefaultCtor();
@@ -323,5 +1724,28 @@ int main() {
 	testStreamOp();
 	testZeroSizeMatrix();
 	testFunctorException();
+	testParallel();
+	testBlockedMult();
+	testElementKernels();
+	testMoveSemantics();
+	testExpressions();
+	testStrassen();
+	testGaussMultiply();
+	testPoolAllocator();
+	testAlignedStorage();
+	testSplitComplex();
+	testBlockedTrans();
+	testTransView();
+	testMatrixFile();
+	testStreamMultiply();
+	testSparseMatrix();
+	testFixedMatrix();
+	testMatrixBatch();
+	testMatrixParser();
+	testFormatMatrixText();
+	testInstrumentation();
+	testWorkStealing();
+	testNumaAllocation();
+	testSingleWriteEvaluation();
 	return 0;
 }
\ No newline at end of file